@@ -0,0 +1,155 @@
+/*
+ * @file AAlmanac.cpp 多年日出日落与晨昏时刻表
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include "ATimeSpace.h"
+#include "AAlmanac.h"
+
+using namespace AstroUtil;
+
+static_assert(sizeof(almanac_head) == 64, "almanac_head must be 64 bytes");
+static_assert(sizeof(almanac_day) == 40, "almanac_day must be 40 bytes");
+
+AAlmanac::AAlmanac() {
+	addr_ = NULL;
+	size_ = 0;
+	head_ = NULL;
+	days_ = NULL;
+}
+
+AAlmanac::~AAlmanac() {
+	Close();
+}
+
+int AAlmanac::Generate(const char *filepath, double lgt, double lat, double alt, int timezone,
+		int mjd0, int days, int nthread) {
+	if (!filepath || days <= 0) return -1;
+	if (nthread <= 0) nthread = boost::thread::hardware_concurrency();
+	if (nthread <= 0) nthread = 1;
+	if (nthread > days) nthread = days;
+
+	almanac_head head;
+	std::vector<almanac_day> table(days);
+	boost::thread_group group;
+	int i;
+
+	memset(&head, 0, sizeof(head));
+	memcpy(head.magic, ALM_MAGIC, sizeof(head.magic));
+	head.version  = ALM_VERSION;
+	head.count    = days;
+	head.mjd0     = mjd0;
+	head.timezone = timezone;
+	head.lgt      = lgt;
+	head.lat      = lat;
+	head.alt      = alt;
+	memset(&table[0], 0, sizeof(almanac_day) * days);
+	// 各线程计算互不重叠的记录, 无需互斥
+	for (i = 0; i < nthread; ++i)
+		group.create_thread(boost::bind(&AAlmanac::thread_generate, &head, &table[0], i, nthread));
+	group.join_all();
+
+	std::string tmppath = std::string(filepath) + ".tmp";
+	FILE *fp = fopen(tmppath.c_str(), "wb");
+	bool success;
+
+	if (!fp) return -2;
+	success = fwrite(&head, sizeof(head), 1, fp) == 1
+			&& fwrite(&table[0], sizeof(almanac_day), days, fp) == size_t(days);
+	success = !fclose(fp) && success;
+	if (!success || rename(tmppath.c_str(), filepath)) {
+		remove(tmppath.c_str());
+		return -2;
+	}
+	return 0;
+}
+
+void AAlmanac::thread_generate(const almanac_head *head, almanac_day *days, int first, int stride) {
+	ATimeSpace ats;
+	double rise, set;
+	int i, type;
+
+	ats.SetSite(head->lgt, head->lat, head->alt, head->timezone);
+	for (i = first; i < head->count; i += stride) {
+		almanac_day &day = days[i];
+		ats.SetMJD(head->mjd0 + i);
+		for (type = 0; type < ALM_TYPE_NUM; ++type) {
+			rise = set = 0.0;
+			day.flag[type] = ats.TwilightTime(rise, set, type);
+			day.rise[type] = rise;
+			day.set[type]  = set;
+		}
+	}
+}
+
+int AAlmanac::Open(const char *filepath) {
+	struct stat st;
+	int fd;
+	void *addr;
+
+	Close();
+	if ((fd = open(filepath, O_RDONLY)) < 0) return -1;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+	if (st.st_size < (off_t) sizeof(almanac_head)) {
+		close(fd);
+		return -2;
+	}
+	addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) return -1;
+
+	const almanac_head *head = (const almanac_head *) addr;
+	if (memcmp(head->magic, ALM_MAGIC, sizeof(head->magic)) || head->version != ALM_VERSION
+			|| head->count <= 0
+			|| size_t(st.st_size) != sizeof(almanac_head) + sizeof(almanac_day) * head->count) {
+		munmap(addr, st.st_size);
+		return -2;
+	}
+
+	addr_ = addr;
+	size_ = st.st_size;
+	head_ = head;
+	days_ = (const almanac_day *) (head + 1);
+	return 0;
+}
+
+void AAlmanac::Close() {
+	if (addr_) {
+		munmap(addr_, size_);
+		addr_ = NULL;
+		size_ = 0;
+		head_ = NULL;
+		days_ = NULL;
+	}
+}
+
+bool AAlmanac::IsOpen() {
+	return addr_ != NULL;
+}
+
+const almanac_head *AAlmanac::Head() {
+	return head_;
+}
+
+int AAlmanac::Lookup(double mjd, int type, double& sunrise, double& sunset) {
+	if (!head_ || type < 0 || type >= ALM_TYPE_NUM) return -2;
+	int i = int(mjd) - head_->mjd0;
+	if (i < 0 || i >= head_->count) return -2;
+
+	const almanac_day &day = days_[i];
+	sunrise = day.rise[type];
+	sunset  = day.set[type];
+	return day.flag[type];
+}
@@ -0,0 +1,134 @@
+/*!
+ * @file AAlmanac.h 多年日出日落与晨昏时刻表
+ * @date Oct 19, 2026
+ * @version 0.1
+ * @note
+ * - Generate()按日将TwilightTime()计算分配到多个线程, 生成紧凑二进制文件
+ * - 每个测站对应一个文件. 文件头记录测站位置与起始日期
+ * - Open()以只读方式将文件映射至内存, Lookup()以日期为下标直接读取记录
+ * @note
+ * 文件格式:
+ * - almanac_head, 64字节
+ * - almanac_day[count], 每条40字节, 按修正儒略日递增排列
+ */
+
+#ifndef AALMANAC_H_
+#define AALMANAC_H_
+
+#include <stdint.h>
+
+namespace AstroUtil {
+///////////////////////////////////////////////////////////////////////////////
+#define ALM_MAGIC		"ANNAESAL"	//< 文件标志
+#define ALM_VERSION		1			//< 文件格式版本
+#define ALM_TYPE_NUM	4			//< 时刻类型数量. 与TwilightTime()的type对应
+
+enum {// 时刻类型
+	ALM_HORIZON,		//< 太阳中心位于地平线
+	ALM_CIVIL,			//< 民用晨昏, 地平线下6度
+	ALM_NAUTICAL,		//< 海上晨昏, 地平线下12度
+	ALM_ASTRONOMICAL	//< 天文晨昏, 地平线下18度
+};
+
+struct almanac_head {// 文件头
+	char    magic[8];	//< 文件标志
+	int32_t version;	//< 文件格式版本
+	int32_t count;		//< 记录数量
+	int32_t mjd0;		//< 首条记录对应的修正儒略日
+	int32_t timezone;	//< 时区, 量纲: 小时
+	double  lgt;		//< 地理经度, 量纲: 角度
+	double  lat;		//< 地理纬度, 量纲: 角度
+	double  alt;		//< 海拔高度, 量纲: 米
+	char    reserved[16];
+};
+
+struct almanac_day {// 单日记录
+	float  rise[ALM_TYPE_NUM];	//< 升起时间, 时区时, 量纲: 小时
+	float  set[ALM_TYPE_NUM];	//< 降落时间, 时区时, 量纲: 小时
+	int8_t flag[ALM_TYPE_NUM];	//< TwilightTime()返回值. -1: 极昼; 0: 正常; 1: 极夜
+	char   reserved[4];
+};
+
+class AAlmanac {
+public:
+	AAlmanac();
+	virtual ~AAlmanac();
+
+public:
+	/*!
+	 * @brief 生成测站的时刻表文件
+	 * @param filepath 文件路径
+	 * @param lgt      地理经度, 量纲: 角度. 东经为正
+	 * @param lat      地理纬度, 量纲: 角度. 北纬为正
+	 * @param alt      海拔高度, 量纲: 米
+	 * @param timezone 时区, 量纲: 小时
+	 * @param mjd0     首日对应的修正儒略日
+	 * @param days     天数
+	 * @param nthread  线程数量. 0: 使用处理器核数
+	 * @return
+	 *  0: 成功
+	 * -1: 参数错误
+	 * -2: 文件写入失败
+	 * @note
+	 * 先写入临时文件, 再替换filepath, 已映射该文件的进程不受影响
+	 */
+	static int Generate(const char *filepath, double lgt, double lat, double alt, int timezone,
+			int mjd0, int days, int nthread = 0);
+	/*!
+	 * @brief 映射时刻表文件
+	 * @param filepath 文件路径
+	 * @return
+	 *  0: 成功
+	 * -1: 打开或映射文件失败
+	 * -2: 文件格式错误
+	 */
+	int Open(const char *filepath);
+	/*!
+	 * @brief 解除映射
+	 */
+	void Close();
+	/*!
+	 * @brief 检查是否已映射时刻表
+	 */
+	bool IsOpen();
+	/*!
+	 * @brief 查看文件头
+	 * @return
+	 * 文件头. 未映射时为NULL
+	 */
+	const almanac_head *Head();
+	/*!
+	 * @brief 查找日期对应的升起、降落时间
+	 * @param mjd     修正儒略日, 取整数部分
+	 * @param type    时刻类型
+	 * @param sunrise 升起时间, 时区时, 量纲: 小时
+	 * @param sunset  降落时间, 时区时, 量纲: 小时
+	 * @return
+	 * -2: 未映射或日期超出时刻表
+	 * -1: 极昼
+	 *  0: 正常
+	 * +1: 极夜
+	 */
+	int Lookup(double mjd, int type, double& sunrise, double& sunset);
+
+protected:
+	/* 成员变量 */
+	void  *addr_;	//< 映射地址
+	size_t size_;	//< 映射长度
+	const almanac_head *head_;	//< 文件头
+	const almanac_day  *days_;	//< 单日记录
+
+protected:
+	/*!
+	 * @brief 线程: 计算时刻表中的一部分日期
+	 * @param head   文件头
+	 * @param days   记录
+	 * @param first  首条记录的序号
+	 * @param stride 序号间隔
+	 */
+	static void thread_generate(const almanac_head *head, almanac_day *days, int first, int stride);
+};
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif /* AALMANAC_H_ */
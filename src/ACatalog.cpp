@@ -0,0 +1,305 @@
+/*
+ * @file ACatalog.cpp 目标星表加载与六十进制坐标快速解析、格式化
+ */
+
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ADefine.h"
+#include "ACatalog.h"
+
+using namespace AstroUtil;
+
+#define CAT_MAX_DIGITS	19		//< uint64_t可容纳的十进制有效位数
+
+static const double pow10pos[] = {
+	1E0, 1E1, 1E2, 1E3, 1E4, 1E5, 1E6, 1E7, 1E8, 1E9,
+	1E10, 1E11, 1E12, 1E13, 1E14, 1E15, 1E16, 1E17, 1E18, 1E19
+};
+
+static const uint64_t pow10int[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL
+};
+
+/*
+ * 将p开始的n(1~8)个数字字符转换为整数
+ * 小端字节序且可读取8字节时, 以64位整数并行转换; 否则逐字符转换
+ */
+static inline uint64_t digits_value(const char *p, int n, bool whole) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (whole) {
+		uint64_t v;
+		memcpy(&v, p, 8);
+		v -= 0x3030303030303030ULL;	// 数字之后的字节可能借位, 但只影响被移出的高位字节
+		v <<= 8 * (8 - n);			// 首字符位于最低字节, 左移后空出的低位字节等效于前导0
+		v = (v * 10) + (v >> 8);
+		v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+				+ (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+		return v;
+	}
+#endif
+	uint64_t v(0);
+	for (int i = 0; i < n; ++i) v = v * 10 + (p[i] - '0');
+	return v;
+}
+
+/*
+ * 解析连续数字. n为数字个数, v为前CAT_MAX_DIGITS个数字的数值
+ * 返回值为数字之后的字符地址
+ */
+static inline const char *parse_digits(const char *p, const char *end, uint64_t& v, int& n) {
+	const char *q = p;
+	int left, m;
+
+	while (q < end && (unsigned char) (*q - '0') < 10) ++q;
+	n = int(q - p);
+	left = n > CAT_MAX_DIGITS ? CAT_MAX_DIGITS : n;
+	for (v = 0; left > 0; left -= m, p += m) {
+		m = left > 8 ? 8 : left;
+		v = v * pow10int[m] + digits_value(p, m, p + 8 <= end);
+	}
+	return q;
+}
+
+static inline bool is_separator(char ch) {
+	return ch == ' ' || ch == '\t' || ch == ',' || ch == '\r';
+}
+
+/* 写入两位数字 */
+static inline char *put2(char *p, int v) {
+	p[0] = char('0' + v / 10);
+	p[1] = char('0' + v % 10);
+	return p + 2;
+}
+
+ACatalog::ACatalog() {
+	errline_ = 0;
+}
+
+ACatalog::~ACatalog() {
+}
+
+int ACatalog::Load(const char *filepath) {
+	struct stat st;
+	int fd, n;
+	void *addr;
+
+	Clear();
+	if ((fd = open(filepath, O_RDONLY)) < 0) return -1;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+	if (!st.st_size) {
+		close(fd);
+		return 0;
+	}
+	addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) return -1;
+	madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+	n = Parse((const char *) addr, st.st_size);
+	munmap(addr, st.st_size);
+	return n;
+}
+
+int ACatalog::Parse(const char *text, size_t size) {
+	const char *p = text, *end = text + size;
+	const char *eol;
+	size_t rows(offset_.size()), chars(names_.size());
+	int line(0);
+
+	// 以平均每行40字节预分配
+	ra_.reserve(ra_.size() + size / 40);
+	dec_.reserve(dec_.size() + size / 40);
+	mag_.reserve(mag_.size() + size / 40);
+	offset_.reserve(offset_.size() + size / 40);
+	for (errline_ = 0; p < end; p = eol + 1) {
+		++line;
+		if (!(eol = (const char *) memchr(p, '\n', end - p))) eol = end;
+		if (!parse_line(p, eol)) {// 撤销本次追加的数据
+			offset_.resize(rows);
+			names_.resize(chars);
+			ra_.resize(rows);
+			dec_.resize(rows);
+			mag_.resize(rows);
+			errline_ = line;
+			return -2;
+		}
+	}
+	return Size();
+}
+
+bool ACatalog::parse_line(const char *p, const char *eol) {
+	const char *name;
+	double ra, dec, mag;
+	bool sexa;
+	int nlen;
+
+	while (p < eol && is_separator(*p)) ++p;
+	if (p == eol || *p == '#') return true;
+
+	// 名称
+	for (name = p; p < eol && !is_separator(*p); ++p);
+	nlen = int(p - name);
+	// 赤经
+	while (p < eol && is_separator(*p)) ++p;
+	if (!(p = ParseSexagesimal(p, eol, ra, sexa)) || (p < eol && !is_separator(*p))) return false;
+	if (sexa) ra *= 15.0;
+	// 赤纬
+	while (p < eol && is_separator(*p)) ++p;
+	if (!(p = ParseSexagesimal(p, eol, dec, sexa)) || (p < eol && !is_separator(*p))) return false;
+	// 星等
+	while (p < eol && is_separator(*p)) ++p;
+	if (p == eol) mag = 99.0;
+	else if (!(p = ParseSexagesimal(p, eol, mag, sexa)) || sexa) return false;
+	while (p < eol && is_separator(*p)) ++p;
+	if (p != eol || ra < 0.0 || ra >= 360.0 || dec < -90.0 || dec > 90.0) return false;
+
+	offset_.push_back(int(names_.size()));
+	names_.append(name, nlen);
+	names_.push_back('\0');
+	ra_.push_back(ra * D2R);
+	dec_.push_back(dec * D2R);
+	mag_.push_back(mag);
+	return true;
+}
+
+void ACatalog::Clear() {
+	names_.clear();
+	offset_.clear();
+	ra_.clear();
+	dec_.clear();
+	mag_.clear();
+	errline_ = 0;
+}
+
+int ACatalog::Size() {
+	return int(ra_.size());
+}
+
+int ACatalog::ErrorLine() {
+	return errline_;
+}
+
+const char *ACatalog::Name(int i) {
+	return names_.c_str() + offset_[i];
+}
+
+const double *ACatalog::RA() {
+	return ra_.empty() ? NULL : &ra_[0];
+}
+
+const double *ACatalog::Dec() {
+	return dec_.empty() ? NULL : &dec_[0];
+}
+
+const double *ACatalog::Mag() {
+	return mag_.empty() ? NULL : &mag_[0];
+}
+
+const char *ACatalog::ParseSexagesimal(const char *str, const char *end, double& value, bool& sexa) {
+	const char *p = str;
+	double sign(1.0), scale(1.0), part;
+	uint64_t iv, fv;
+	int n, m, nsep(0);
+
+	value = 0.0;
+	sexa  = false;
+	if (p < end && (*p == '+' || *p == '-')) {
+		if (*p == '-') sign = -1.0;
+		++p;
+	}
+	while (true) {
+		p = parse_digits(p, end, iv, n);
+		if (!n || n > CAT_MAX_DIGITS) return NULL;	// 整数部分超出uint64_t范围时视为格式错误
+		part = double(iv);
+		if (p < end && *p == '.') {// 小数部分, 之后不允许再出现分隔符. 超出有效位数的数字被舍去
+			p = parse_digits(p + 1, end, fv, m);
+			part += fv / pow10pos[m > CAT_MAX_DIGITS ? CAT_MAX_DIGITS : m];
+			if (nsep && part >= 60.0) return NULL;	// 分、秒超出范围
+			value += part * scale;
+			break;
+		}
+		if (nsep && part >= 60.0) return NULL;
+		value += part * scale;
+		if (p == end || *p != ':' || nsep == 2) break;
+		++p;
+		++nsep;
+		scale /= 60.0;
+	}
+	value *= sign;
+	sexa = nsep > 0;
+	return p;
+}
+
+int ACatalog::FormatHour(double hour, char str[]) {
+	hour = cyclemod(hour, 24.0);
+	int64_t ms = (int64_t) (hour * 3600000.0 + 0.5);	// 毫秒
+	if (ms >= 86400000) ms -= 86400000;
+	int h = int(ms / 3600000);
+	int m = int(ms / 60000 % 60);
+	int s = int(ms / 1000 % 60);
+	int f = int(ms % 1000);
+	char *p = str;
+
+	p = put2(p, h);
+	*p++ = ':';
+	p = put2(p, m);
+	*p++ = ':';
+	p = put2(p, s);
+	*p++ = '.';
+	*p++ = char('0' + f / 100);
+	p = put2(p, f % 100);
+	*p = 0;
+	return int(p - str);
+}
+
+int ACatalog::FormatDeg(double degree, char str[]) {
+	degree = cyclemod(degree, 360.0);
+	int64_t cs = (int64_t) (degree * 360000.0 + 0.5);	// 0.01角秒
+	if (cs >= 129600000) cs -= 129600000;
+	int d = int(cs / 360000);
+	int m = int(cs / 6000 % 60);
+	int s = int(cs / 100 % 60);
+	int f = int(cs % 100);
+	char *p = str;
+
+	*p++ = char('0' + d / 100);
+	p = put2(p, d % 100);
+	*p++ = ':';
+	p = put2(p, m);
+	*p++ = ':';
+	p = put2(p, s);
+	*p++ = '.';
+	p = put2(p, f);
+	*p = 0;
+	return int(p - str);
+}
+
+int ACatalog::FormatDec(double dec, char str[]) {
+	if (dec < -90.0 || dec > 90.0) return -1;
+
+	char *p = str;
+	*p++ = dec < 0.0 ? '-' : '+';
+	int64_t cs = (int64_t) (fabs(dec) * 360000.0 + 0.5);	// 0.01角秒
+	int d = int(cs / 360000);
+	int m = int(cs / 6000 % 60);
+	int s = int(cs / 100 % 60);
+	int f = int(cs % 100);
+
+	p = put2(p, d);
+	*p++ = ':';
+	p = put2(p, m);
+	*p++ = ':';
+	p = put2(p, s);
+	*p++ = '.';
+	p = put2(p, f);
+	*p = 0;
+	return int(p - str);
+}
@@ -0,0 +1,139 @@
+/*!
+ * @file ACatalog.h 目标星表加载与六十进制坐标快速解析、格式化
+ * @date Oct 19, 2026
+ * @version 0.1
+ * @note
+ * 星表文件为文本格式, 每行一个目标:
+ * - 名称 赤经 赤纬 [星等]
+ * - 字段以空格、制表符或逗号分隔; 以'#'开头的行为注释
+ * - 赤经: hh:mm:ss.ss格式为小时; 不含冒号时为角度
+ * - 赤纬: sdd:mm:ss.s格式或十进制角度
+ * @note
+ * - 文件以只读方式映射至内存后逐行解析, 不复制行缓冲区
+ * - 数字串一次按8字节整体转换(SWAR), 避免逐字符调用atof
+ * - 解析结果按列存储(structure of arrays), 赤经、赤纬量纲为弧度, 可直接用于ASkyIndex::Build()
+ */
+
+#ifndef ACATALOG_H_
+#define ACATALOG_H_
+
+#include <vector>
+#include <string>
+
+namespace AstroUtil {
+///////////////////////////////////////////////////////////////////////////////
+class ACatalog {
+public:
+	ACatalog();
+	virtual ~ACatalog();
+
+public:
+	/*!
+	 * @brief 加载星表文件, 替换已加载的数据
+	 * @param filepath 文件路径
+	 * @return
+	 * >=0: 目标数量
+	 *  -1: 打开或映射文件失败
+	 *  -2: 格式错误, 出错行号由ErrorLine()查看
+	 */
+	int Load(const char *filepath);
+	/*!
+	 * @brief 解析内存中的星表文本, 追加至已加载的数据
+	 * @param text 文本
+	 * @param size 文本长度
+	 * @return
+	 * >=0: 目标数量
+	 *  -2: 格式错误, 出错行号由ErrorLine()查看. 已加载的数据保持不变
+	 */
+	int Parse(const char *text, size_t size);
+	/*!
+	 * @brief 清除已加载的数据
+	 */
+	void Clear();
+	/*!
+	 * @brief 查看目标数量
+	 */
+	int Size();
+	/*!
+	 * @brief 查看最近一次格式错误的行号, 从1开始
+	 */
+	int ErrorLine();
+	/*!
+	 * @brief 查看目标名称
+	 * @param i 序号
+	 */
+	const char *Name(int i);
+	/*!
+	 * @brief 查看赤经列, 量纲: 弧度
+	 */
+	const double *RA();
+	/*!
+	 * @brief 查看赤纬列, 量纲: 弧度
+	 */
+	const double *Dec();
+	/*!
+	 * @brief 查看星等列. 缺省星等为99.0
+	 */
+	const double *Mag();
+
+public:
+	/*!
+	 * @brief 解析六十进制或十进制数值
+	 * @param str   字符串起始地址
+	 * @param end   字符串结束地址
+	 * @param value 数值. 六十进制时为首段单位, 例如hh:mm:ss对应小时
+	 * @param sexa  是否为六十进制格式
+	 * @return
+	 * 数值之后的字符地址. 格式错误时返回NULL
+	 * @note
+	 * 支持格式: [+-]d[:m[:s]][.f]. 段间分隔符为冒号. 各段整数部分不超过19位, 分、秒小于60
+	 */
+	static const char *ParseSexagesimal(const char *str, const char *end, double& value, bool& sexa);
+	/*!
+	 * @brief 将小时数格式化为字符串
+	 * @param hour 小时数. 当超出[0, 24)范围时被调制到该范围
+	 * @param str  存储字符串的数组, 长度不小于13
+	 * @return
+	 * 字符串长度. 格式: hh:mm:ss.sss
+	 */
+	static int FormatHour(double hour, char str[]);
+	/*!
+	 * @brief 将角度格式化为字符串
+	 * @param degree 角度. 当超出[0, 360)范围时被调制到该范围
+	 * @param str    存储字符串的数组, 长度不小于13
+	 * @return
+	 * 字符串长度. 格式: ddd:mm:ss.ss
+	 */
+	static int FormatDeg(double degree, char str[]);
+	/*!
+	 * @brief 将赤纬格式化为字符串
+	 * @param dec 赤纬, 量纲: 角度
+	 * @param str 存储字符串的数组, 长度不小于13
+	 * @return
+	 * 字符串长度. 格式: sdd:mm:ss.ss. 当超出[-90, +90]范围时返回-1
+	 */
+	static int FormatDec(double dec, char str[]);
+
+protected:
+	/* 成员变量 */
+	std::string names_;			//< 目标名称, 以'\0'分隔
+	std::vector<int> offset_;	//< 目标名称在names_中的偏移量
+	std::vector<double> ra_;	//< 赤经, 量纲: 弧度
+	std::vector<double> dec_;	//< 赤纬, 量纲: 弧度
+	std::vector<double> mag_;	//< 星等
+	int errline_;				//< 格式错误的行号
+
+protected:
+	/*!
+	 * @brief 解析一行文本
+	 * @param p   行起始地址
+	 * @param eol 行结束地址
+	 * @return
+	 * 格式正确或为空行、注释行时返回true
+	 */
+	bool parse_line(const char *p, const char *eol);
+};
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif /* ACATALOG_H_ */
@@ -36,6 +36,9 @@ namespace AstroUtil {
 #define DAYS_JM		365250.0	//< 儒略历每千年天数
 #define DAYSEC		86400.0		//< 每日秒数
 
+// 距离常数
+#define AU			149597870.7	//< 天文单位, 量纲: 千米
+
 // 极限阈值
 #define EPS		1E-6			//< 最小值
 
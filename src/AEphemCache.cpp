@@ -0,0 +1,133 @@
+/*
+ * @file AEphemCache.cpp 分段切比雪夫多项式缓存太阳与月亮位置
+ */
+
+#include <math.h>
+#include "ADefine.h"
+#include "AEphemCache.h"
+
+using namespace AstroUtil;
+
+AEphemCache::AEphemCache(double span, int order) {
+	span_  = span > 0.0 ? span : 1.0;
+	order_ = order < 2 ? 2 : (order > EPH_ORDER_MAX ? EPH_ORDER_MAX : order);
+	Reset();
+}
+
+AEphemCache::~AEphemCache() {
+}
+
+void AEphemCache::Reset() {
+	for (int i = 0; i < EPH_SEGMENT_NUM; ++i) segs_[i].index = -1;
+	next_ = 0;
+}
+
+void AEphemCache::SetLeapSecond(const ATimeSpace &other) {
+	ats_.CopyLeapSecond(other);
+	Reset();
+}
+
+void AEphemCache::SunPosition(double mjd, double& ra, double& dec) {
+	double val[EPH_END];
+
+	evaluate(mjd, val);
+	ra = atan2(val[EPH_SUN_Y], val[EPH_SUN_X]);
+	if (ra < 0) ra += A2PI;
+	dec = atan2(val[EPH_SUN_Z], sqrt(val[EPH_SUN_X] * val[EPH_SUN_X] + val[EPH_SUN_Y] * val[EPH_SUN_Y]));
+}
+
+void AEphemCache::MoonPosition(double mjd, double& ra, double& dec, double& dist) {
+	double val[EPH_END];
+	double x, y, z, rxy;
+
+	evaluate(mjd, val);
+	x = val[EPH_MOON_X];
+	y = val[EPH_MOON_Y];
+	z = val[EPH_MOON_Z];
+	rxy = sqrt(x * x + y * y);
+	ra = atan2(y, x);
+	if (ra < 0) ra += A2PI;
+	dec = atan2(z, rxy);
+	dist = sqrt(rxy * rxy + z * z);
+}
+
+double AEphemCache::MoonIllumination(double mjd) {
+	double val[EPH_END];
+	double k;
+
+	evaluate(mjd, val);
+	k = val[EPH_MOON_ILLUM];
+	return k < 0.0 ? 0.0 : (k > 1.0 ? 1.0 : k);
+}
+
+void AEphemCache::evaluate(double mjd, double val[EPH_END]) {
+	long index = (long) floor(mjd / span_);
+	segment *seg = NULL;
+	int i, j;
+
+	for (i = 0; i < EPH_SEGMENT_NUM && segs_[i].index != index; ++i);
+	if (i < EPH_SEGMENT_NUM) seg = &segs_[i];
+	else {
+		seg = &segs_[next_];
+		next_ = (next_ + 1) % EPH_SEGMENT_NUM;
+		fit_segment(*seg, index);
+	}
+
+	// Clenshaw递推
+	double x = 2.0 * (mjd / span_ - index) - 1.0;
+	double x2 = 2.0 * x;
+	double b0, b1, b2;
+	double *c;
+
+	for (j = 0; j < EPH_END; ++j) {
+		c = seg->coef[j];
+		b1 = b2 = 0.0;
+		for (i = order_ - 1; i > 0; --i) {
+			b0 = x2 * b1 - b2 + c[i];
+			b2 = b1;
+			b1 = b0;
+		}
+		val[j] = x * b1 - b2 + 0.5 * c[0];
+	}
+}
+
+void AEphemCache::fit_segment(segment& seg, long index) {
+	int n = order_;
+	double node[EPH_END][EPH_ORDER_MAX];
+	double mjd0 = index * span_;
+	double mjd, t, theta;
+	double ra, dec, dist, cdec;
+	int i, j, k;
+
+	// 在切比雪夫节点上计算完整级数
+	for (k = 0; k < n; ++k) {
+		theta = API * (k + 0.5) / n;
+		mjd = mjd0 + 0.5 * span_ * (1.0 + cos(theta));
+		t = ats_.JulianCentury(ats_.UTC2TAI(mjd) + TTMTAI / DAYSEC);
+
+		ats_.SunPosition(t, ra, dec);
+		cdec = cos(dec);
+		node[EPH_SUN_X][k] = cdec * cos(ra);
+		node[EPH_SUN_Y][k] = cdec * sin(ra);
+		node[EPH_SUN_Z][k] = sin(dec);
+
+		ats_.MoonPosition(t, ra, dec, dist);
+		cdec = dist * cos(dec);
+		node[EPH_MOON_X][k] = cdec * cos(ra);
+		node[EPH_MOON_Y][k] = cdec * sin(ra);
+		node[EPH_MOON_Z][k] = dist * sin(dec);
+
+		node[EPH_MOON_ILLUM][k] = ats_.MoonIllumination(t);
+	}
+
+	// 离散切比雪夫变换
+	double sum;
+	for (j = 0; j < EPH_END; ++j) {
+		for (i = 0; i < n; ++i) {
+			for (k = 0, sum = 0.0; k < n; ++k)
+				sum += node[j][k] * cos(API * i * (k + 0.5) / n);
+			seg.coef[j][i] = 2.0 * sum / n;
+		}
+	}
+	seg.index = index;
+}
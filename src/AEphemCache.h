@@ -0,0 +1,112 @@
+/*!
+ * @file AEphemCache.h 分段切比雪夫多项式缓存太阳与月亮位置
+ * @date Oct 19, 2026
+ * @version 0.1
+ * @note
+ * - 以UTC日为分段, 首次查询时在切比雪夫节点上计算ATimeSpace完整级数并拟合多项式
+ * - 后续查询只计算多项式, 不再计算级数
+ * - 太阳和月亮按直角坐标拟合, 避免赤经在0/360度处不连续
+ * - 仅缓存最近使用的少数分段, 超出时替换最早拟合的分段
+ * - 接口参数为UTC, 拟合节点按闰秒表换算为TT(UTC+ΔAT+32.184秒)后计算级数.
+ *   ATimeSpace::SunPosition()以UTC儒略世纪代替TT, 二者相差约69秒, 太阳位置相差约3角秒
+ * @note
+ * 16阶多项式拟合1天分段, 与直接计算结果的差异小于0.001角秒
+ */
+
+#ifndef AEPHEMCACHE_H_
+#define AEPHEMCACHE_H_
+
+#include "ATimeSpace.h"
+
+namespace AstroUtil {
+///////////////////////////////////////////////////////////////////////////////
+#define EPH_ORDER_MAX	24	//< 多项式最大阶数
+#define EPH_SEGMENT_NUM	4	//< 缓存分段数量
+
+class AEphemCache {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param span  分段时长, 量纲: 天
+	 * @param order 多项式阶数, 不超过EPH_ORDER_MAX
+	 */
+	AEphemCache(double span = 1.0, int order = 16);
+	virtual ~AEphemCache();
+
+public:
+	/*!
+	 * @brief 太阳地心赤道坐标
+	 * @param mjd UTC对应的修正儒略日
+	 * @param ra  赤经, 量纲: 弧度
+	 * @param dec 赤纬, 量纲: 弧度
+	 */
+	void SunPosition(double mjd, double& ra, double& dec);
+	/*!
+	 * @brief 月亮地心视位置
+	 * @param mjd  UTC对应的修正儒略日
+	 * @param ra   赤经, 量纲: 弧度
+	 * @param dec  赤纬, 量纲: 弧度
+	 * @param dist 地心距离, 量纲: 千米
+	 */
+	void MoonPosition(double mjd, double& ra, double& dec, double& dist);
+	/*!
+	 * @brief 月面照亮比例
+	 * @param mjd UTC对应的修正儒略日
+	 * @return
+	 * 照亮比例, 范围: [0, 1]
+	 */
+	double MoonIllumination(double mjd);
+	/*!
+	 * @brief 清除已拟合分段
+	 */
+	void Reset();
+	/*!
+	 * @brief 采用其它对象的闰秒表, 并清除已拟合分段
+	 * @param other 已加载闰秒表的对象
+	 */
+	void SetLeapSecond(const ATimeSpace &other);
+
+protected:
+	/* 数据类型 */
+	enum {// 拟合分量
+		EPH_SUN_X,	//< 太阳方向矢量
+		EPH_SUN_Y,
+		EPH_SUN_Z,
+		EPH_MOON_X,	//< 月亮地心矢量, 量纲: 千米
+		EPH_MOON_Y,
+		EPH_MOON_Z,
+		EPH_MOON_ILLUM,	//< 月面照亮比例
+		EPH_END		//< 分量数量
+	};
+
+	struct segment {// 拟合分段
+		long index;	//< 分段序号: floor(mjd / span). 无效时为-1
+		double coef[EPH_END][EPH_ORDER_MAX];	//< 切比雪夫系数
+	};
+
+protected:
+	/* 成员变量 */
+	ATimeSpace ats_;	//< 计算拟合节点
+	double span_;		//< 分段时长, 量纲: 天
+	int    order_;		//< 多项式阶数
+	int    next_;		//< 下一个被替换的分段
+	segment segs_[EPH_SEGMENT_NUM];	//< 分段缓存
+
+protected:
+	/*!
+	 * @brief 查找或拟合包含mjd的分段, 并计算所有分量
+	 * @param mjd UTC对应的修正儒略日
+	 * @param val 各分量数值
+	 */
+	void evaluate(double mjd, double val[EPH_END]);
+	/*!
+	 * @brief 拟合分段
+	 * @param seg   分段
+	 * @param index 分段序号
+	 */
+	void fit_segment(segment& seg, long index);
+};
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif /* AEPHEMCACHE_H_ */
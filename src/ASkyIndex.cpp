@@ -0,0 +1,161 @@
+/*
+ * @file ASkyIndex.cpp 天球位置空间索引
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include "ADefine.h"
+#include "ASkyIndex.h"
+
+using namespace AstroUtil;
+
+/* 比较两个节点在指定轴上的坐标 */
+struct node_less {
+	int axis;
+	node_less(int a) : axis(a) {}
+	template <class T> bool operator()(const T& a, const T& b) const {
+		return a.v[axis] < b.v[axis];
+	}
+};
+
+static inline double chord2(const double a[3], const double b[3]) {
+	double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+static inline void unit_vector(double ra, double dec, double v[3]) {
+	double cd = cos(dec);
+	v[0] = cd * cos(ra);
+	v[1] = cd * sin(ra);
+	v[2] = sin(dec);
+}
+
+ASkyIndex::ASkyIndex() {
+}
+
+ASkyIndex::~ASkyIndex() {
+}
+
+void ASkyIndex::Build(int n, const double ra[], const double dec[], int nthread) {
+	int i, split;
+
+	nodes_.resize(n > 0 ? n : 0);
+	for (i = 0; i < n; ++i) {
+		unit_vector(ra[i], dec[i], nodes_[i].v);
+		nodes_[i].index = i;
+	}
+	if (nthread <= 0) nthread = boost::thread::hardware_concurrency();
+	for (split = 0; (1 << split) < nthread; ++split);
+	build(0, n, split);
+}
+
+void ASkyIndex::Clear() {
+	nodes_.clear();
+}
+
+int ASkyIndex::Size() {
+	return int(nodes_.size());
+}
+
+int ASkyIndex::ConeSearch(double ra, double dec, double radius, std::vector<int>& index) {
+	double q[3];
+	double h = sin(0.5 * radius);
+	double r2 = 4.0 * h * h;	// 弦长平方. 避免2-2cos(r)在小半径时的相消误差
+
+	unit_vector(ra, dec, q);
+	index.clear();
+	cone_search(0, Size(), q, r2, index);
+	return int(index.size());
+}
+
+int ASkyIndex::Nearest(double ra, double dec, double& sep) {
+	if (nodes_.empty()) return -1;
+
+	double q[3], d2(4.1);
+	int best(-1);
+
+	unit_vector(ra, dec, q);
+	nearest(0, Size(), q, best, d2);
+	sep = d2 >= 4.0 ? API : 2.0 * asin(0.5 * sqrt(d2));
+	return nodes_[best].index;
+}
+
+void ASkyIndex::build(int lo, int hi, int split) {
+	if (hi - lo < 2) {
+		if (hi > lo) nodes_[lo].axis = 0;
+		return;
+	}
+
+	// 选择坐标范围最大的轴
+	double vmin[3], vmax[3], span, smax(-1.0);
+	int i, j, axis(0), mid = (lo + hi) / 2;
+
+	for (j = 0; j < 3; ++j) vmin[j] = vmax[j] = nodes_[lo].v[j];
+	for (i = lo + 1; i < hi; ++i) {
+		for (j = 0; j < 3; ++j) {
+			if (nodes_[i].v[j] < vmin[j]) vmin[j] = nodes_[i].v[j];
+			else if (nodes_[i].v[j] > vmax[j]) vmax[j] = nodes_[i].v[j];
+		}
+	}
+	for (j = 0; j < 3; ++j) {
+		if ((span = vmax[j] - vmin[j]) > smax) {
+			smax = span;
+			axis = j;
+		}
+	}
+
+	std::nth_element(nodes_.begin() + lo, nodes_.begin() + mid, nodes_.begin() + hi, node_less(axis));
+	nodes_[mid].axis = axis;
+	if (split > 0 && hi - lo > 4096) {// 左子树交由新线程构建
+		boost::thread thrd(boost::bind(&ASkyIndex::build, this, lo, mid, split - 1));
+		build(mid + 1, hi, split - 1);
+		thrd.join();
+	}
+	else {
+		build(lo, mid, 0);
+		build(mid + 1, hi, 0);
+	}
+}
+
+void ASkyIndex::cone_search(int lo, int hi, const double q[3], double r2, std::vector<int>& index) {
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		const node& x = nodes_[mid];
+		double diff = q[x.axis] - x.v[x.axis];
+
+		if (chord2(q, x.v) <= r2) index.push_back(x.index);
+		// 近侧子树循环处理, 远侧子树仅当分割面与检索球相交时递归
+		if (diff < 0.0) {
+			if (diff * diff <= r2) cone_search(mid + 1, hi, q, r2, index);
+			hi = mid;
+		}
+		else {
+			if (diff * diff <= r2) cone_search(lo, mid, q, r2, index);
+			lo = mid + 1;
+		}
+	}
+}
+
+void ASkyIndex::nearest(int lo, int hi, const double q[3], int& best, double& d2) {
+	if (lo >= hi) return;
+
+	int mid = (lo + hi) / 2;
+	const node& x = nodes_[mid];
+	double diff = q[x.axis] - x.v[x.axis];
+	double d = chord2(q, x.v);
+
+	if (d < d2) {
+		d2   = d;
+		best = mid;
+	}
+	if (diff < 0.0) {
+		nearest(lo, mid, q, best, d2);
+		if (diff * diff < d2) nearest(mid + 1, hi, q, best, d2);
+	}
+	else {
+		nearest(mid + 1, hi, q, best, d2);
+		if (diff * diff < d2) nearest(lo, mid, q, best, d2);
+	}
+}
@@ -0,0 +1,98 @@
+/*!
+ * @file ASkyIndex.h 天球位置空间索引
+ * @date Oct 19, 2026
+ * @version 0.1
+ * @note
+ * - 以单位矢量构建平衡kd树, 用于锥形检索与最近邻检索, 查询复杂度为O(logN)
+ * - 弦长与角距单调对应: chord^2 = 2 - 2cos(sep), 查询过程中无需三角函数
+ * - 树以隐式数组存储: 区间[lo, hi)的中点为根, 左右子树分别为[lo, mid)和[mid+1, hi)
+ * - 构建时顶层子树分配到多个线程
+ */
+
+#ifndef ASKYINDEX_H_
+#define ASKYINDEX_H_
+
+#include <vector>
+
+namespace AstroUtil {
+///////////////////////////////////////////////////////////////////////////////
+class ASkyIndex {
+public:
+	ASkyIndex();
+	virtual ~ASkyIndex();
+
+public:
+	/*!
+	 * @brief 由星表构建索引
+	 * @param n       星表条目数量
+	 * @param ra      赤经, 量纲: 弧度
+	 * @param dec     赤纬, 量纲: 弧度
+	 * @param nthread 线程数量. 0: 使用处理器核数
+	 * @note
+	 * 查询结果中的序号为条目在ra/dec数组中的序号
+	 */
+	void Build(int n, const double ra[], const double dec[], int nthread = 0);
+	/*!
+	 * @brief 清除索引
+	 */
+	void Clear();
+	/*!
+	 * @brief 查看索引条目数量
+	 */
+	int Size();
+	/*!
+	 * @brief 锥形检索
+	 * @param ra     中心赤经, 量纲: 弧度
+	 * @param dec    中心赤纬, 量纲: 弧度
+	 * @param radius 半径, 量纲: 弧度
+	 * @param index  角距不大于radius的条目序号. 不排序
+	 * @return
+	 * 符合条件的条目数量
+	 */
+	int ConeSearch(double ra, double dec, double radius, std::vector<int>& index);
+	/*!
+	 * @brief 最近邻检索
+	 * @param ra  赤经, 量纲: 弧度
+	 * @param dec 赤纬, 量纲: 弧度
+	 * @param sep 最近条目的角距, 量纲: 弧度
+	 * @return
+	 * 最近条目的序号. 索引为空时返回-1
+	 */
+	int Nearest(double ra, double dec, double& sep);
+
+protected:
+	/* 数据类型 */
+	struct node {// 树节点
+		double v[3];	//< 单位矢量
+		int index;		//< 星表序号
+		int axis;		//< 分割轴
+	};
+	typedef std::vector<node> nodevec;
+
+protected:
+	/* 成员变量 */
+	nodevec nodes_;	//< 隐式kd树
+
+protected:
+	/*!
+	 * @brief 构建区间[lo, hi)对应的子树
+	 * @param lo    区间起点
+	 * @param hi    区间终点
+	 * @param split 可继续分配给新线程的层数
+	 */
+	void build(int lo, int hi, int split);
+	/*!
+	 * @brief 在区间[lo, hi)对应的子树中检索弦长平方不大于r2的条目
+	 */
+	void cone_search(int lo, int hi, const double q[3], double r2, std::vector<int>& index);
+	/*!
+	 * @brief 在区间[lo, hi)对应的子树中检索最近条目
+	 * @param best 当前最近条目在nodes_中的位置
+	 * @param d2   当前最近条目的弦长平方
+	 */
+	void nearest(int lo, int hi, const double q[3], int& best, double& d2);
+};
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif /* ASKYINDEX_H_ */
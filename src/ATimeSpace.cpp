@@ -11,10 +11,146 @@
 
 using namespace AstroUtil;
 
+/*
+ * IAU 2000B章动序列, 按列存储. 数据来源: sofa/iauNut00b
+ * 正弦与余弦系数的量纲为0.1微角秒, 及其每儒略世纪变化率
+ */
+#define NUT_NLS		77		//< 章动序列项数
+#define NUT_MULT	4		//< 基本幅角的最大倍数
+
+static constexpr struct {
+	signed char nl[NUT_NLS], nlp[NUT_NLS], nf[NUT_NLS], nd[NUT_NLS], nom[NUT_NLS];	/* coefficients of l,l',F,D,Om */
+	double ps[NUT_NLS], pst[NUT_NLS], pc[NUT_NLS];	/* longitude sin, t*sin, cos coefficients */
+	double ec[NUT_NLS], ect[NUT_NLS], es[NUT_NLS];	/* obliquity cos, t*cos, sin coefficients */
+} nut00b = {
+	/* l, 月亮平近点角 */
+	{
+		 0,  0,  0,  0,  0,  0,  1,  0,  1,  0,  0, -1, -1,  1, -1, -1,  1, -2,  0,  0,
+		 0, -2,  2,  1, -1,  2,  0,  0, -1,  0,  0,  1,  0, -1,  0,  1, -2,  0,  0,  0,
+		 0,  1,  2, -2,  2,  0,  0, -1,  2,  1,  0,  1, -2,  3,  0,  1,  0, -1, -1,  0,
+		-2,  1,  2, -1,  1,  1, -1,  1, -1,  0, -1, -1,  0,  1, -2, -1,  1
+	},
+	/* l', 太阳平近点角 */
+	{
+		 0,  0,  0,  0,  1,  1,  0,  0,  0, -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+		-2,  0,  0,  0,  0,  0,  0,  1,  0,  2,  0,  0, -1,  0,  2,  0,  0,  1,  0, -1,
+		 0,  0,  0,  0,  0, -1,  0, -1,  0,  0,  1, -1,  0,  0, -1, -1,  0, -1,  0, -1,
+		 0,  1,  0,  1,  1,  0,  0,  0,  0,  0,  0,  1, -2,  0,  0,  0,  1
+	},
+	/* F, 月亮升交点角距 */
+	{
+		 0,  2,  2,  0,  0,  2,  0,  2,  2,  2,  2,  2,  0,  0,  0,  2,  2,  2,  0,  2,
+		 2,  0,  2,  2,  2,  0,  2,  0,  0,  2, -2,  0,  0,  2,  0,  2,  2,  2,  2,  2,
+		 0,  2,  2,  0,  2,  2,  0,  0,  0,  0,  2,  0,  2,  2,  0,  2,  0,  2,  2,  2,
+		 0,  2,  0,  0,  0,  2,  2,  0,  0,  2,  2,  0,  2,  2,  2,  0,  2
+	},
+	/* D, 日月平角距 */
+	{
+		 0, -2,  0,  0,  0, -2,  0,  0,  0, -2, -2,  0,  2,  0,  0,  2,  0,  0,  2,  2,
+		-2,  2,  0, -2,  0,  0,  0,  0,  2, -2,  2, -2,  0,  2,  0,  2,  0,  0,  2,  0,
+		 2, -2, -2,  2,  0, -2, -2,  2, -2,  2, -2,  0,  0,  0,  2,  0,  1,  2,  0,  2,
+		 0,  0,  0,  1,  0,  0, -2,  0,  1,  1,  4,  1, -2,  2,  2,  0, -2
+	},
+	/* Om, 月亮升交点平黄经 */
+	{
+		 1,  2,  2,  2,  0,  2,  0,  1,  2,  2,  1,  2,  0,  1,  1,  2,  1,  1,  0,  2,
+		 2,  0,  2,  2,  1,  0,  0,  1,  1,  2,  0,  1,  1,  1,  0,  2,  0,  2,  1,  2,
+		 1,  1,  2,  1,  1,  1,  1,  0,  1,  0,  1,  0,  2,  2,  0,  2,  0,  2,  0,  2,
+		 1,  2,  1,  0,  0,  0,  1,  2,  0,  2,  2,  1,  1,  1,  2,  2,  2
+	},
+	/* 黄经章动: sin系数 */
+	{
+		-172064161.0,  -13170906.0,   -2276413.0,    2074554.0,    1475877.0,    -516821.0,     711159.0,
+		   -387298.0,    -301461.0,     215829.0,     128227.0,     123457.0,     156994.0,      63110.0,
+		    -57976.0,     -59641.0,     -51613.0,      45893.0,      63384.0,     -38571.0,      32481.0,
+		    -47722.0,     -31046.0,      28593.0,      20441.0,      29243.0,      25887.0,     -14053.0,
+		     15164.0,     -15794.0,      21783.0,     -12873.0,     -12654.0,     -10204.0,      16707.0,
+		     -7691.0,     -11024.0,       7566.0,      -6637.0,      -7141.0,      -6302.0,       5800.0,
+		      6443.0,      -5774.0,      -5350.0,      -4752.0,      -4940.0,       7350.0,       4065.0,
+		      6579.0,       3579.0,       4725.0,      -3075.0,      -2904.0,       4348.0,      -2878.0,
+		     -4230.0,      -2819.0,      -4056.0,      -2647.0,      -2294.0,       2481.0,       2179.0,
+		      3276.0,      -3389.0,       3339.0,      -1987.0,      -1981.0,       4026.0,       1660.0,
+		     -1521.0,       1314.0,      -1283.0,      -1331.0,       1383.0,       1405.0,       1290.0
+	},
+	/* 黄经章动: t*sin系数 */
+	{
+		-174666.0,   -1675.0,    -234.0,     207.0,   -3633.0,    1226.0,      73.0,
+		   -367.0,     -36.0,    -494.0,     137.0,      11.0,      10.0,      63.0,
+		    -63.0,     -11.0,     -42.0,      50.0,      11.0,      -1.0,       0.0,
+		      0.0,      -1.0,       0.0,      21.0,       0.0,       0.0,     -25.0,
+		     10.0,      72.0,       0.0,     -10.0,      11.0,       0.0,     -85.0,
+		      0.0,       0.0,     -21.0,     -11.0,      21.0,     -11.0,      10.0,
+		      0.0,     -11.0,       0.0,     -11.0,     -11.0,       0.0,       0.0,
+		      0.0,       0.0,       0.0,       0.0,       0.0,       0.0,       0.0,
+		      0.0,       0.0,       0.0,       0.0,       0.0,       0.0,       0.0,
+		      0.0,       0.0,       0.0,       0.0,       0.0,       0.0,       0.0,
+		      0.0,       0.0,       0.0,       0.0,       0.0,       0.0,       0.0
+	},
+	/* 黄经章动: cos系数 */
+	{
+		 33386.0, -13696.0,   2796.0,   -698.0,  11817.0,   -524.0,   -872.0,
+		   380.0,    816.0,    111.0,    181.0,     19.0,   -168.0,     27.0,
+		  -189.0,    149.0,    129.0,     31.0,   -150.0,    158.0,      0.0,
+		   -18.0,    131.0,     -1.0,     10.0,    -74.0,    -66.0,     79.0,
+		    11.0,    -16.0,     13.0,    -37.0,     63.0,     25.0,    -10.0,
+		    44.0,    -14.0,    -11.0,     25.0,      8.0,      2.0,      2.0,
+		    -7.0,    -15.0,     21.0,     -3.0,    -21.0,     -8.0,      6.0,
+		   -24.0,      5.0,     -6.0,     -2.0,     15.0,    -10.0,      8.0,
+		     5.0,      7.0,      5.0,     11.0,    -10.0,     -7.0,     -2.0,
+		     1.0,      5.0,    -13.0,     -6.0,      0.0,   -353.0,     -5.0,
+		     9.0,      0.0,      0.0,      8.0,     -2.0,      4.0,      0.0
+	},
+	/* 交角章动: cos系数 */
+	{
+		92052331.0,  5730336.0,   978459.0,  -897492.0,    73871.0,   224386.0,    -6750.0,
+		  200728.0,   129025.0,   -95929.0,   -68982.0,   -53311.0,    -1235.0,   -33228.0,
+		   31429.0,    25543.0,    26366.0,   -24236.0,    -1220.0,    16452.0,   -13870.0,
+		     477.0,    13238.0,   -12338.0,   -10758.0,     -609.0,     -550.0,     8551.0,
+		   -8001.0,     6850.0,     -167.0,     6953.0,     6415.0,     5222.0,      168.0,
+		    3268.0,      104.0,    -3250.0,     3353.0,     3070.0,     3272.0,    -3045.0,
+		   -2768.0,     3041.0,     2695.0,     2719.0,     2720.0,      -51.0,    -2206.0,
+		    -199.0,    -1900.0,      -41.0,     1313.0,     1233.0,      -81.0,     1232.0,
+		     -20.0,     1207.0,       40.0,     1129.0,     1266.0,    -1062.0,    -1129.0,
+		      -9.0,       35.0,     -107.0,     1073.0,      854.0,     -553.0,     -710.0,
+		     647.0,     -700.0,      672.0,      663.0,     -594.0,     -610.0,     -556.0
+	},
+	/* 交角章动: t*cos系数 */
+	{
+		 9086.0, -3015.0,  -485.0,   470.0,  -184.0,  -677.0,     0.0,
+		   18.0,   -63.0,   299.0,    -9.0,    32.0,     0.0,     0.0,
+		    0.0,   -11.0,     0.0,   -10.0,     0.0,   -11.0,     0.0,
+		    0.0,   -11.0,    10.0,     0.0,     0.0,     0.0,    -2.0,
+		    0.0,   -42.0,     0.0,     0.0,     0.0,     0.0,    -1.0,
+		    0.0,     0.0,     0.0,     0.0,     0.0,     0.0,     0.0,
+		    0.0,     0.0,     0.0,     0.0,     0.0,     0.0,     0.0,
+		    0.0,     0.0,     0.0,     0.0,     0.0,     0.0,     0.0,
+		    0.0,     0.0,     0.0,     0.0,     0.0,     0.0,     0.0,
+		    0.0,     0.0,     0.0,     0.0,     0.0,     0.0,     0.0,
+		    0.0,     0.0,     0.0,     0.0,     0.0,     0.0,     0.0
+	},
+	/* 交角章动: sin系数 */
+	{
+		15377.0, -4587.0,  1374.0,  -291.0, -1924.0,  -174.0,   358.0,
+		  318.0,   367.0,   132.0,    39.0,    -4.0,    82.0,    -9.0,
+		  -75.0,    66.0,    78.0,    20.0,    29.0,    68.0,     0.0,
+		  -25.0,    59.0,    -3.0,    -3.0,    13.0,    11.0,   -45.0,
+		   -1.0,    -5.0,    13.0,   -14.0,    26.0,    15.0,    10.0,
+		   19.0,     2.0,    -5.0,    14.0,     4.0,     4.0,    -1.0,
+		   -4.0,    -5.0,    12.0,    -3.0,    -9.0,     4.0,     1.0,
+		    2.0,     1.0,     3.0,    -1.0,     7.0,     2.0,     4.0,
+		   -2.0,     3.0,    -2.0,     5.0,    -4.0,    -3.0,    -2.0,
+		    0.0,    -2.0,     1.0,    -2.0,     0.0,  -139.0,    -2.0,
+		    4.0,     0.0,     0.0,     4.0,    -2.0,     2.0,     0.0
+	}
+
+};
+
 ATimeSpace::ATimeSpace() {
 	lgt_ = lat_ = alt_ = 0.0;
 	tz_  = 0;
+	mjdset_ = elapsed_ = 0.0;
 	invalid_values();
+	init_leap_second();
 }
 
 ATimeSpace::~ATimeSpace() {
@@ -43,6 +179,8 @@ int ATimeSpace::SetUTC(int iy, int im, int id, double fd) {
 	invalid_values();
 	values_[ATS_MJD] = ModifiedJulianDay(iy, im, id, fd);
 	values_[ATS_DAT] = DeltaAT(iy, im, id, fd);
+	mjdset_  = values_[ATS_MJD];
+	elapsed_ = 0.0;
 
 	return 0;
 }
@@ -69,6 +207,57 @@ void ATimeSpace::SetMJD(double mjd) {
 	SetUTC(iy, im, id, fd);
 }
 
+void ATimeSpace::Advance(double dt) {
+	/*
+	 * 慢变量的有效期与线性变化率. 未列出的数值在推进后失效
+	 * 有效期按误差不超过1毫角秒选取
+	 */
+	static const struct {
+		int slot;		// 数值索引
+		double horizon;	// 有效期, 量纲: 日
+		double rate;	// 变化率, 量纲: 弧度/日
+	} slow[] = {
+		{ ATS_MO,                 10.0,    -46.836769 * AS2R / 36525 },
+		{ ATS_NL,                 600.0 / DAYSEC, 0.0 },	// 半月项使章动变化约0.1角秒/日
+		{ ATS_NO,                 600.0 / DAYSEC, 0.0 },
+		{ ATS_MASUN,              1.0,     129596581.0481 * AS2R / 36525 },
+		{ ATS_MAMOON,             1.0,     1717915923.2178 * AS2R / 36525 },
+		{ ATS_MELONG_MOON_SUN,    1.0,     1602961601.209 * AS2R / 36525 },
+		{ ATS_MLAN_MOON,          1.0,     -6962890.5432 * AS2R / 36525 },
+		{ ATS_RLONG_MOON,         1.0,     1739527262.8478 * AS2R / 36525 },
+		{ ATS_ML_SUN,             1.0,     36000.76983 * D2R / 36525 },
+		{ ATS_ECCENTRICITY_EARTH, 30.0,    0.0 },
+		{ ATS_PL_EARTH,           30.0,    0.0 },
+		{ ATS_PN_MATRIX,          240.0 / DAYSEC, 0.0 }	// 光行差矢量变化约0.4角秒/日
+	};
+	bool keep[ATS_END];
+	double ddt = dt / DAYSEC;
+	double mjd, fd;
+	int iy, im, id, i, j;
+
+	memset(keep, 0, sizeof(keep));
+	for (i = 0; i < int(sizeof(slow) / sizeof(slow[0])); ++i) {
+		j = slow[i].slot;
+		if (!valid_[j]) continue;
+		age_[j] += fabs(ddt);
+		if (age_[j] > slow[i].horizon) continue;
+		if (slow[i].rate != 0.0) values_[j] = cyclemod(values_[j] + slow[i].rate * ddt, A2PI);
+		keep[j] = true;
+	}
+	for (i = 0; i < ATS_END; ++i) {
+		if (!keep[i]) {
+			valid_[i] = false;
+			age_[i]   = 0.0;
+		}
+	}
+
+	elapsed_ += dt;
+	mjd = mjdset_ + elapsed_ / DAYSEC;
+	Mjd2Cal(mjd, iy, im, id, fd);
+	values_[ATS_MJD] = mjd;
+	values_[ATS_DAT] = DeltaAT(iy, im, id, fd);
+}
+
 void ATimeSpace::Mjd2Cal(double mjd, int& iy, int& im, int& id, double& fd) {
 	int jdn = int(mjd + MJD0 + 0.5);
 	int A, B, C, D, E, t;
@@ -180,8 +369,18 @@ double ATimeSpace::TrueObliquity(double t) {
 }
 
 void ATimeSpace::Nutation(double t, double& nl, double& no) {
-	double arg, sarg, carg;
+	nutation_series(t, MeanAnomalyMoon(t), MeanAnomalySun(t),
+			RelLongMoon(t), MeanElongationMoonSun(t), MeanLongAscNodeMoon(t), nl, no);
+}
 
+/*
+ * 章动序列求和. 算法来源: sofa/iauNut00b
+ * 各项幅角为基本幅角的整数倍组合, 预先计算基本幅角各倍数的正弦与余弦,
+ * 再由和角公式合成各项幅角, 避免逐项调用sin/cos.
+ * 与逐项调用sin/cos的结果相比, 在1900-2100年间偏差小于1E-16弧度
+ */
+void ATimeSpace::nutation_series(double t, double el, double elp, double f, double d, double om,
+		double& nl, double& no) {
 	/* Units of 0.1 microarcsecond to radians */
 	static const double U2R = AS2R * 1e-7;
 	/* ---------------------------------------- */
@@ -189,136 +388,49 @@ void ATimeSpace::Nutation(double t, double& nl, double& no) {
 	/* ---------------------------------------- */
 	static const double DPPLAN = -0.135E-6 * AS2R;
 	static const double DEPLAN =  0.388E-6 * AS2R;
-	/* The units for the sine and cosine coefficients are */
-	/* 0.1 microarcsec and the same per Julian century    */
-	static const struct {
-		int nl, nlp, nf, nd, nom; /* coefficients of l,l',F,D,Om */
-		double ps, pst, pc;     /* longitude sin, t*sin, cos coefficients */
-		double ec, ect, es;     /* obliquity cos, t*cos, sin coefficients */
-	} x[] = {
-			/* 1-10 */
-			{ 0, 0, 0, 0, 1, -172064161.0, -174666.0,  33386.0, 92052331.0,  9086.0, 15377.0},
-			{ 0, 0, 2,-2, 2,  -13170906.0,   -1675.0, -13696.0,  5730336.0, -3015.0, -4587.0},
-			{ 0, 0, 2, 0, 2,   -2276413.0,    -234.0,   2796.0,   978459.0,  -485.0,  1374.0},
-			{ 0, 0, 0, 0, 2,    2074554.0,     207.0,   -698.0,  -897492.0,   470.0,  -291.0},
-			{ 0, 1, 0, 0, 0,    1475877.0,   -3633.0,  11817.0,    73871.0,  -184.0, -1924.0},
-			{ 0, 1, 2,-2, 2,    -516821.0,    1226.0,   -524.0,   224386.0,  -677.0,  -174.0},
-			{ 1, 0, 0, 0, 0,     711159.0,      73.0,   -872.0,    -6750.0,     0.0,   358.0},
-			{ 0, 0, 2, 0, 1,    -387298.0,    -367.0,    380.0,   200728.0,    18.0,   318.0},
-			{ 1, 0, 2, 0, 2,    -301461.0,     -36.0,    816.0,   129025.0,   -63.0,   367.0},
-			{ 0,-1, 2,-2, 2,     215829.0,    -494.0,    111.0,   -95929.0,   299.0,   132.0},
-
-			/* 11-20 */
-			{ 0, 0, 2,-2,1, 128227.0,  137.0,  181.0, -68982.0,  -9.0,  39.0},
-			{-1, 0, 2, 0,2, 123457.0,   11.0,   19.0, -53311.0,  32.0,  -4.0},
-			{-1, 0, 0, 2,0, 156994.0,   10.0, -168.0,  -1235.0,   0.0,  82.0},
-			{ 1, 0, 0, 0,1,  63110.0,   63.0,   27.0, -33228.0,   0.0,  -9.0},
-			{-1, 0, 0, 0,1, -57976.0,  -63.0, -189.0,  31429.0,   0.0, -75.0},
-			{-1, 0, 2, 2,2, -59641.0,  -11.0,  149.0,  25543.0, -11.0,  66.0},
-			{ 1, 0, 2, 0,1, -51613.0,  -42.0,  129.0,  26366.0,   0.0,  78.0},
-			{-2, 0, 2, 0,1,  45893.0,   50.0,   31.0, -24236.0, -10.0,  20.0},
-			{ 0, 0, 0, 2,0,  63384.0,   11.0, -150.0,  -1220.0,   0.0,  29.0},
-			{ 0, 0, 2, 2,2, -38571.0,   -1.0,  158.0,  16452.0, -11.0,  68.0},
-
-			/* 21-30 */
-			{ 0,-2, 2,-2,2,  32481.0,    0.0,    0.0, -13870.0,   0.0,   0.0},
-			{-2, 0, 0, 2,0, -47722.0,    0.0,  -18.0,    477.0,   0.0, -25.0},
-			{ 2, 0, 2, 0,2, -31046.0,   -1.0,  131.0,  13238.0, -11.0,  59.0},
-			{ 1, 0, 2,-2,2,  28593.0,    0.0,   -1.0, -12338.0,  10.0,  -3.0},
-			{-1, 0, 2, 0,1,  20441.0,   21.0,   10.0, -10758.0,   0.0,  -3.0},
-			{ 2, 0, 0, 0,0,  29243.0,    0.0,  -74.0,   -609.0,   0.0,  13.0},
-			{ 0, 0, 2, 0,0,  25887.0,    0.0,  -66.0,   -550.0,   0.0,  11.0},
-			{ 0, 1, 0, 0,1, -14053.0,  -25.0,   79.0,   8551.0,  -2.0, -45.0},
-			{-1, 0, 0, 2,1,  15164.0,   10.0,   11.0,  -8001.0,   0.0,  -1.0},
-			{ 0, 2, 2,-2,2, -15794.0,   72.0,  -16.0,   6850.0, -42.0,  -5.0},
-
-			/* 31-40 */
-			{ 0, 0,-2, 2,0,  21783.0,    0.0,   13.0,   -167.0,   0.0,  13.0},
-			{ 1, 0, 0,-2,1, -12873.0,  -10.0,  -37.0,   6953.0,   0.0, -14.0},
-			{ 0,-1, 0, 0,1, -12654.0,   11.0,   63.0,   6415.0,   0.0,  26.0},
-			{-1, 0, 2, 2,1, -10204.0,    0.0,   25.0,   5222.0,   0.0,  15.0},
-			{ 0, 2, 0, 0,0,  16707.0,  -85.0,  -10.0,    168.0,  -1.0,  10.0},
-			{ 1, 0, 2, 2,2,  -7691.0,    0.0,   44.0,   3268.0,   0.0,  19.0},
-			{-2, 0, 2, 0,0, -11024.0,    0.0,  -14.0,    104.0,   0.0,   2.0},
-			{ 0, 1, 2, 0,2,   7566.0,  -21.0,  -11.0,  -3250.0,   0.0,  -5.0},
-			{ 0, 0, 2, 2,1,  -6637.0,  -11.0,   25.0,   3353.0,   0.0,  14.0},
-			{ 0,-1, 2, 0,2,  -7141.0,   21.0,    8.0,   3070.0,   0.0,   4.0},
-
-			/* 41-50 */
-			{ 0, 0, 0, 2,1,  -6302.0,  -11.0,    2.0,   3272.0,   0.0,   4.0},
-			{ 1, 0, 2,-2,1,   5800.0,   10.0,    2.0,  -3045.0,   0.0,  -1.0},
-			{ 2, 0, 2,-2,2,   6443.0,    0.0,   -7.0,  -2768.0,   0.0,  -4.0},
-			{-2, 0, 0, 2,1,  -5774.0,  -11.0,  -15.0,   3041.0,   0.0,  -5.0},
-			{ 2, 0, 2, 0,1,  -5350.0,    0.0,   21.0,   2695.0,   0.0,  12.0},
-			{ 0,-1, 2,-2,1,  -4752.0,  -11.0,   -3.0,   2719.0,   0.0,  -3.0},
-			{ 0, 0, 0,-2,1,  -4940.0,  -11.0,  -21.0,   2720.0,   0.0,  -9.0},
-			{-1,-1, 0, 2,0,   7350.0,    0.0,   -8.0,    -51.0,   0.0,   4.0},
-			{ 2, 0, 0,-2,1,   4065.0,    0.0,    6.0,  -2206.0,   0.0,   1.0},
-			{ 1, 0, 0, 2,0,   6579.0,    0.0,  -24.0,   -199.0,   0.0,   2.0},
-
-			/* 51-60 */
-			{ 0, 1, 2,-2,1,   3579.0,    0.0,    5.0,  -1900.0,   0.0,   1.0},
-			{ 1,-1, 0, 0,0,   4725.0,    0.0,   -6.0,    -41.0,   0.0,   3.0},
-			{-2, 0, 2, 0,2,  -3075.0,    0.0,   -2.0,   1313.0,   0.0,  -1.0},
-			{ 3, 0, 2, 0,2,  -2904.0,    0.0,   15.0,   1233.0,   0.0,   7.0},
-			{ 0,-1, 0, 2,0,   4348.0,    0.0,  -10.0,    -81.0,   0.0,   2.0},
-			{ 1,-1, 2, 0,2,  -2878.0,    0.0,    8.0,   1232.0,   0.0,   4.0},
-			{ 0, 0, 0, 1,0,  -4230.0,    0.0,    5.0,    -20.0,   0.0,  -2.0},
-			{-1,-1, 2, 2,2,  -2819.0,    0.0,    7.0,   1207.0,   0.0,   3.0},
-			{-1, 0, 2, 0,0,  -4056.0,    0.0,    5.0,     40.0,   0.0,  -2.0},
-			{ 0,-1, 2, 2,2,  -2647.0,    0.0,   11.0,   1129.0,   0.0,   5.0},
-
-			/* 61-70 */
-			{-2, 0, 0, 0,1,  -2294.0,    0.0,  -10.0,   1266.0,   0.0,  -4.0},
-			{ 1, 1, 2, 0,2,   2481.0,    0.0,   -7.0,  -1062.0,   0.0,  -3.0},
-			{ 2, 0, 0, 0,1,   2179.0,    0.0,   -2.0,  -1129.0,   0.0,  -2.0},
-			{-1, 1, 0, 1,0,   3276.0,    0.0,    1.0,     -9.0,   0.0,   0.0},
-			{ 1, 1, 0, 0,0,  -3389.0,    0.0,    5.0,     35.0,   0.0,  -2.0},
-			{ 1, 0, 2, 0,0,   3339.0,    0.0,  -13.0,   -107.0,   0.0,   1.0},
-			{-1, 0, 2,-2,1,  -1987.0,    0.0,   -6.0,   1073.0,   0.0,  -2.0},
-			{ 1, 0, 0, 0,2,  -1981.0,    0.0,    0.0,    854.0,   0.0,   0.0},
-			{-1, 0, 0, 1,0,   4026.0,    0.0, -353.0,   -553.0,   0.0,-139.0},
-			{ 0, 0, 2, 1,2,   1660.0,    0.0,   -5.0,   -710.0,   0.0,  -2.0},
-
-			/* 71-77 */
-			{-1, 0, 2, 4,2,  -1521.0,    0.0,    9.0,    647.0,   0.0,   4.0},
-			{-1, 1, 0, 1,1,   1314.0,    0.0,    0.0,   -700.0,   0.0,   0.0},
-			{ 0,-2, 2,-2,1,  -1283.0,    0.0,    0.0,    672.0,   0.0,   0.0},
-			{ 1, 0, 2, 2,1,  -1331.0,    0.0,    8.0,    663.0,   0.0,   4.0},
-			{-2, 0, 2, 2,2,   1383.0,    0.0,   -2.0,   -594.0,   0.0,  -2.0},
-			{-1, 0, 0, 0,2,   1405.0,    0.0,    4.0,   -610.0,   0.0,   2.0},
-			{ 1, 1, 2,-2,2,   1290.0,    0.0,    0.0,   -556.0,   0.0,   0.0}
-	};
+	const signed char *mul[] = { nut00b.nl, nut00b.nlp, nut00b.nf, nut00b.nd, nut00b.nom };
+	const double fa[] = { el, elp, f, d, om };
+	double cm[5][2 * NUT_MULT + 1], sm[5][2 * NUT_MULT + 1];	// 基本幅角倍数[-NUT_MULT, NUT_MULT]的余弦与正弦
+	double carg[NUT_NLS], sarg[NUT_NLS];	// 各项幅角的余弦与正弦
+	double c, s, ct, st, x;
+	int i, j, k;
+
+	for (j = 0; j < 5; ++j) {
+		double *cj = cm[j] + NUT_MULT;
+		double *sj = sm[j] + NUT_MULT;
+		ct = cos(fa[j]);
+		st = sin(fa[j]);
+		cj[0] = 1.0;
+		sj[0] = 0.0;
+		for (k = 1; k <= NUT_MULT; ++k) {
+			cj[k]  = cj[k - 1] * ct - sj[k - 1] * st;
+			sj[k]  = sj[k - 1] * ct + cj[k - 1] * st;
+			cj[-k] = cj[k];
+			sj[-k] = -sj[k];
+		}
+	}
 
-	/* Number of terms in the series */
-	const int NLS = (int) (sizeof x / sizeof x[0]);
-	/* Mean anomaly of the Moon. */
-	double el = MeanAnomalyMoon(t);
-	/* Mean anomaly of the Sun. */
-	double elp = MeanAnomalySun(t);
-	/* Mean argument of the latitude of the Moon. */
-	double f = RelLongMoon(t);
-	/* Mean elongation of the Moon from the Sun. */
-	double d = MeanElongationMoonSun(t);
-	/* Mean longitude of the ascending node of the Moon. */
-	double om = MeanLongAscNodeMoon(t);
+	/* 由和角公式合成各项幅角. 循环内无超越函数和累加依赖, 可被向量化 */
+	for (i = 0; i < NUT_NLS; ++i) {
+		c = cm[0][NUT_MULT + mul[0][i]];
+		s = sm[0][NUT_MULT + mul[0][i]];
+		for (j = 1; j < 5; ++j) {
+			ct = cm[j][NUT_MULT + mul[j][i]];
+			st = sm[j][NUT_MULT + mul[j][i]];
+			x = c * ct - s * st;
+			s = s * ct + c * st;
+			c = x;
+		}
+		carg[i] = c;
+		sarg[i] = s;
+	}
 
 	nl = no = 0.0;
-
 	/* Summation of luni-solar nutation series (smallest terms first). */
-	for (int i = NLS-1; i >= 0; --i) {
-		/* Argument and functions. */
-		arg =   (double)x[i].nl  * el  +
-				(double)x[i].nlp * elp +
-				(double)x[i].nf  * f   +
-				(double)x[i].nd  * d   +
-				(double)x[i].nom * om;
-		sarg = sin(arg);
-		carg = cos(arg);
-	   /* Term. */
-	      nl += (x[i].ps + x[i].pst * t) * sarg + x[i].pc * carg;
-	      no += (x[i].ec + x[i].ect * t) * carg + x[i].es * sarg;
-	   }
+	for (i = NUT_NLS - 1; i >= 0; --i) {
+		nl += (nut00b.ps[i] + nut00b.pst[i] * t) * sarg[i] + nut00b.pc[i] * carg[i];
+		no += (nut00b.ec[i] + nut00b.ect[i] * t) * carg[i] + nut00b.es[i] * sarg[i];
+	}
 
 	nl = nl * U2R + DPPLAN;
 	no = no * U2R + DEPLAN;
@@ -396,6 +508,190 @@ double ATimeSpace::TrueLongSun(double t) {
 	return MeanLongSun(t) + CenterSun(t);
 }
 
+double ATimeSpace::MeanLongMoon(double t) {
+	/* 参数来源: Jean Meeus <Astronomical Algorithms>, 47.1 */
+	double ml = 218.3164477 + (481267.88123421 + (-0.0015786 + (1.0 / 538841.0 - t / 65194000.0) * t) * t) * t;
+	ml = cyclemod(ml, 360.0);
+	return (ml * D2R);
+}
+
+/*
+ * 周期项的幅角为日月平角距D、太阳平近点角M、月亮平近点角M'和月亮升交点角距F的整数倍组合.
+ * 含M的项按地球轨道偏心率修正振幅
+ */
+void ATimeSpace::MoonPosition(double t, double& ra, double& dec, double& dist) {
+	/* 黄经与距离周期项. 振幅量纲: 黄经1E-6度, 距离1E-3千米 */
+	static const struct {
+		int nd, nm, nmp, nf;	/* coefficients of D,M,M',F */
+		double sl, sr;			/* longitude sin, distance cos coefficients */
+	} xlr[] = {
+			{ 0, 0, 1, 0, 6288774.0, -20905355.0},
+			{ 2, 0,-1, 0, 1274027.0,  -3699111.0},
+			{ 2, 0, 0, 0,  658314.0,  -2955968.0},
+			{ 0, 0, 2, 0,  213618.0,   -569925.0},
+			{ 0, 1, 0, 0, -185116.0,     48888.0},
+			{ 0, 0, 0, 2, -114332.0,     -3149.0},
+			{ 2, 0,-2, 0,   58793.0,    246158.0},
+			{ 2,-1,-1, 0,   57066.0,   -152138.0},
+			{ 2, 0, 1, 0,   53322.0,   -170733.0},
+			{ 2,-1, 0, 0,   45758.0,   -204586.0},
+			{ 0, 1,-1, 0,  -40923.0,   -129620.0},
+			{ 1, 0, 0, 0,  -34720.0,    108743.0},
+			{ 0, 1, 1, 0,  -30383.0,    104755.0},
+			{ 2, 0, 0,-2,   15327.0,     10321.0},
+			{ 0, 0, 1, 2,  -12528.0,         0.0},
+			{ 0, 0, 1,-2,   10980.0,     79661.0},
+			{ 4, 0,-1, 0,   10675.0,    -34782.0},
+			{ 0, 0, 3, 0,   10034.0,    -23210.0},
+			{ 4, 0,-2, 0,    8548.0,    -21636.0},
+			{ 2, 1,-1, 0,   -7888.0,     24208.0},
+			{ 2, 1, 0, 0,   -6766.0,     30824.0},
+			{ 1, 0,-1, 0,   -5163.0,     -8379.0},
+			{ 1, 1, 0, 0,    4987.0,    -16675.0},
+			{ 2,-1, 1, 0,    4036.0,    -12831.0},
+			{ 2, 0, 2, 0,    3994.0,    -10445.0},
+			{ 4, 0, 0, 0,    3861.0,    -11650.0},
+			{ 2, 0,-3, 0,    3665.0,     14403.0},
+			{ 0, 1,-2, 0,   -2689.0,     -7003.0},
+			{ 2, 0,-1, 2,   -2602.0,         0.0},
+			{ 2,-1,-2, 0,    2390.0,     10056.0},
+			{ 1, 0, 1, 0,   -2348.0,      6322.0},
+			{ 2,-2, 0, 0,    2236.0,     -9884.0},
+			{ 0, 1, 2, 0,   -2120.0,      5751.0},
+			{ 0, 2, 0, 0,   -2069.0,         0.0},
+			{ 2,-2,-1, 0,    2048.0,     -4950.0},
+			{ 2, 0, 1,-2,   -1773.0,      4130.0},
+			{ 2, 0, 0, 2,   -1595.0,         0.0},
+			{ 4,-1,-1, 0,    1215.0,     -3958.0},
+			{ 0, 0, 2, 2,   -1110.0,         0.0},
+			{ 3, 0,-1, 0,    -892.0,      3258.0},
+			{ 2, 1, 1, 0,    -810.0,      2616.0},
+			{ 4,-1,-2, 0,     759.0,     -1897.0},
+			{ 0, 2,-1, 0,    -713.0,     -2117.0},
+			{ 2, 2,-1, 0,    -700.0,      2354.0},
+			{ 2, 1,-2, 0,     691.0,         0.0},
+			{ 2,-1, 0,-2,     596.0,         0.0},
+			{ 4, 0, 1, 0,     549.0,     -1423.0},
+			{ 0, 0, 4, 0,     537.0,     -1117.0},
+			{ 4,-1, 0, 0,     520.0,     -1571.0},
+			{ 1, 0,-2, 0,    -487.0,     -1739.0},
+			{ 2, 1, 0,-2,    -399.0,         0.0},
+			{ 0, 0, 2,-2,    -381.0,     -4421.0},
+			{ 1, 1, 1, 0,     351.0,         0.0},
+			{ 3, 0,-2, 0,    -340.0,         0.0},
+			{ 4, 0,-3, 0,     330.0,         0.0},
+			{ 2,-1, 2, 0,     327.0,         0.0},
+			{ 0, 2, 1, 0,    -323.0,      1165.0},
+			{ 1, 1,-1, 0,     299.0,         0.0},
+			{ 2, 0, 3, 0,     294.0,         0.0},
+			{ 2, 0,-1,-2,       0.0,      8752.0}
+	};
+	/* 黄纬周期项. 振幅量纲: 1E-6度 */
+	static const struct {
+		int nd, nm, nmp, nf;	/* coefficients of D,M,M',F */
+		double sb;				/* latitude sin coefficients */
+	} xb[] = {
+			{ 0, 0, 0, 1, 5128122.0},
+			{ 0, 0, 1, 1,  280602.0},
+			{ 0, 0, 1,-1,  277693.0},
+			{ 2, 0, 0,-1,  173237.0},
+			{ 2, 0,-1, 1,   55413.0},
+			{ 2, 0,-1,-1,   46271.0},
+			{ 2, 0, 0, 1,   32573.0},
+			{ 0, 0, 2, 1,   17198.0},
+			{ 2, 0, 1,-1,    9266.0},
+			{ 0, 0, 2,-1,    8822.0},
+			{ 2,-1, 0,-1,    8216.0},
+			{ 2, 0,-2,-1,    4324.0},
+			{ 2, 0, 1, 1,    4200.0},
+			{ 2, 1, 0,-1,   -3359.0},
+			{ 2,-1,-1, 1,    2463.0},
+			{ 2,-1, 0, 1,    2211.0},
+			{ 2,-1,-1,-1,    2065.0},
+			{ 0, 1,-1,-1,   -1870.0},
+			{ 4, 0,-1,-1,    1828.0},
+			{ 0, 1, 0, 1,   -1794.0},
+			{ 0, 0, 0, 3,   -1749.0},
+			{ 0, 1,-1, 1,   -1565.0},
+			{ 1, 0, 0, 1,   -1491.0},
+			{ 0, 1, 1, 1,   -1475.0},
+			{ 0, 1, 1,-1,   -1410.0},
+			{ 0, 1, 0,-1,   -1344.0},
+			{ 1, 0, 0,-1,   -1335.0},
+			{ 0, 0, 3, 1,    1107.0},
+			{ 4, 0, 0,-1,    1021.0},
+			{ 4, 0,-1, 1,     833.0},
+			{ 0, 0, 1,-3,     777.0},
+			{ 4, 0,-2, 1,     671.0},
+			{ 2, 0, 0,-3,     607.0},
+			{ 2, 0, 2,-1,     596.0},
+			{ 2,-1, 1,-1,     491.0},
+			{ 2, 0,-2, 1,    -451.0},
+			{ 0, 0, 3,-1,     439.0},
+			{ 2, 0, 2, 1,     422.0},
+			{ 2, 0,-3,-1,     421.0},
+			{ 2, 1,-1, 1,    -366.0},
+			{ 2, 1, 0, 1,    -351.0},
+			{ 4, 0, 0, 1,     331.0},
+			{ 2,-1, 1, 1,     315.0},
+			{ 2,-2, 0,-1,     302.0}
+	};
+	const int NLR = (int) (sizeof xlr / sizeof xlr[0]);
+	const int NB  = (int) (sizeof xb / sizeof xb[0]);
+
+	double lp = MeanLongMoon(t);			// 月亮平黄经
+	double d  = MeanElongationMoonSun(t);	// 日月平角距
+	double m  = MeanAnomalySun(t);			// 太阳平近点角
+	double mp = MeanAnomalyMoon(t);			// 月亮平近点角
+	double f  = RelLongMoon(t);				// 月亮升交点角距
+	double e  = 1.0 - (0.002516 + 7.4E-6 * t) * t;	// 地球轨道偏心率修正因子
+	double a1 = (119.75 + 131.849 * t) * D2R;
+	double a2 = (53.09 + 479264.29 * t) * D2R;
+	double a3 = (313.45 + 481266.484 * t) * D2R;
+	double sl(0.0), sr(0.0), sb(0.0), arg, ef, nl, no, l, b;
+	int i;
+
+	/* Summation of periodic terms (smallest terms first). */
+	for (i = NLR - 1; i >= 0; --i) {
+		arg = xlr[i].nd * d + xlr[i].nm * m + xlr[i].nmp * mp + xlr[i].nf * f;
+		ef  = xlr[i].nm == 0 ? 1.0 : (xlr[i].nm == 1 || xlr[i].nm == -1 ? e : e * e);
+		sl += xlr[i].sl * ef * sin(arg);
+		sr += xlr[i].sr * ef * cos(arg);
+	}
+	for (i = NB - 1; i >= 0; --i) {
+		arg = xb[i].nd * d + xb[i].nm * m + xb[i].nmp * mp + xb[i].nf * f;
+		ef  = xb[i].nm == 0 ? 1.0 : (xb[i].nm == 1 || xb[i].nm == -1 ? e : e * e);
+		sb += xb[i].sb * ef * sin(arg);
+	}
+	/* 金星、木星及地球扁率摄动 */
+	sl += 3958.0 * sin(a1) + 1962.0 * sin(lp - f) + 318.0 * sin(a2);
+	sb += -2235.0 * sin(lp) + 382.0 * sin(a3) + 175.0 * sin(a1 - f) + 175.0 * sin(a1 + f)
+			+ 127.0 * sin(lp - mp) - 115.0 * sin(lp + mp);
+
+	/* 视黄经: 加入黄经章动; 黄道坐标转换为真赤道坐标 */
+	Nutation(t, nl, no);
+	l = lp + sl * 1E-6 * D2R + nl;
+	b = sb * 1E-6 * D2R;
+	Eclip2Eq(l, b, MeanObliquity(t) + no, ra, dec);
+	dist = 385000.56 + sr * 1E-3;
+}
+
+/*
+ * 由地心距离和日月角距计算月面相位角, 照亮比例为(1+cos(i))/2. 算法来源: Jean Meeus, 第48章
+ */
+double ATimeSpace::MoonIllumination(double t) {
+	double ra0, dec0, ra, dec, dist, ec, v, r, psi, i;
+
+	SunPosition(t, ra0, dec0);
+	MoonPosition(t, ra, dec, dist);
+	ec = EccentricityEarth(t);
+	v  = MeanAnomalySun(t) + CenterSun(t);	// 太阳真近点角
+	r  = 1.000001018 * (1.0 - ec * ec) / (1.0 + ec * cos(v)) * AU;	// 日地距离, 量纲: 千米
+	psi = SphereAngle(ra0, dec0, ra, dec);	// 日月地心角距
+	i   = atan2(r * sin(psi), dist - r * cos(psi));
+	return (1.0 + cos(i)) * 0.5;
+}
+
 double ATimeSpace::ModifiedJulianDay() {
 	return values_[ATS_MJD];
 }
@@ -494,149 +790,8 @@ double ATimeSpace::TrueObliquity() {
 }
 
 void ATimeSpace::Nutation(double& nl, double& no) {
-	double arg, sarg, carg;
-	double t = JulianCentury();
-
-	/* Units of 0.1 microarcsecond to radians */
-	static const double U2R = AS2R * 1e-7;
-	/* ---------------------------------------- */
-	/* Fixed offsets in lieu of planetary terms */
-	/* ---------------------------------------- */
-	static const double DPPLAN = -0.135E-6 * AS2R;
-	static const double DEPLAN =  0.388E-6 * AS2R;
-	/* The units for the sine and cosine coefficients are */
-	/* 0.1 microarcsec and the same per Julian century    */
-	static const struct {
-		int nl, nlp, nf, nd, nom; /* coefficients of l,l',F,D,Om */
-		double ps, pst, pc;     /* longitude sin, t*sin, cos coefficients */
-		double ec, ect, es;     /* obliquity cos, t*cos, sin coefficients */
-	} x[] = {
-			/* 1-10 */
-			{ 0, 0, 0, 0, 1, -172064161.0, -174666.0,  33386.0, 92052331.0,  9086.0, 15377.0},
-			{ 0, 0, 2,-2, 2,  -13170906.0,   -1675.0, -13696.0,  5730336.0, -3015.0, -4587.0},
-			{ 0, 0, 2, 0, 2,   -2276413.0,    -234.0,   2796.0,   978459.0,  -485.0,  1374.0},
-			{ 0, 0, 0, 0, 2,    2074554.0,     207.0,   -698.0,  -897492.0,   470.0,  -291.0},
-			{ 0, 1, 0, 0, 0,    1475877.0,   -3633.0,  11817.0,    73871.0,  -184.0, -1924.0},
-			{ 0, 1, 2,-2, 2,    -516821.0,    1226.0,   -524.0,   224386.0,  -677.0,  -174.0},
-			{ 1, 0, 0, 0, 0,     711159.0,      73.0,   -872.0,    -6750.0,     0.0,   358.0},
-			{ 0, 0, 2, 0, 1,    -387298.0,    -367.0,    380.0,   200728.0,    18.0,   318.0},
-			{ 1, 0, 2, 0, 2,    -301461.0,     -36.0,    816.0,   129025.0,   -63.0,   367.0},
-			{ 0,-1, 2,-2, 2,     215829.0,    -494.0,    111.0,   -95929.0,   299.0,   132.0},
-
-			/* 11-20 */
-			{ 0, 0, 2,-2,1, 128227.0,  137.0,  181.0, -68982.0,  -9.0,  39.0},
-			{-1, 0, 2, 0,2, 123457.0,   11.0,   19.0, -53311.0,  32.0,  -4.0},
-			{-1, 0, 0, 2,0, 156994.0,   10.0, -168.0,  -1235.0,   0.0,  82.0},
-			{ 1, 0, 0, 0,1,  63110.0,   63.0,   27.0, -33228.0,   0.0,  -9.0},
-			{-1, 0, 0, 0,1, -57976.0,  -63.0, -189.0,  31429.0,   0.0, -75.0},
-			{-1, 0, 2, 2,2, -59641.0,  -11.0,  149.0,  25543.0, -11.0,  66.0},
-			{ 1, 0, 2, 0,1, -51613.0,  -42.0,  129.0,  26366.0,   0.0,  78.0},
-			{-2, 0, 2, 0,1,  45893.0,   50.0,   31.0, -24236.0, -10.0,  20.0},
-			{ 0, 0, 0, 2,0,  63384.0,   11.0, -150.0,  -1220.0,   0.0,  29.0},
-			{ 0, 0, 2, 2,2, -38571.0,   -1.0,  158.0,  16452.0, -11.0,  68.0},
-
-			/* 21-30 */
-			{ 0,-2, 2,-2,2,  32481.0,    0.0,    0.0, -13870.0,   0.0,   0.0},
-			{-2, 0, 0, 2,0, -47722.0,    0.0,  -18.0,    477.0,   0.0, -25.0},
-			{ 2, 0, 2, 0,2, -31046.0,   -1.0,  131.0,  13238.0, -11.0,  59.0},
-			{ 1, 0, 2,-2,2,  28593.0,    0.0,   -1.0, -12338.0,  10.0,  -3.0},
-			{-1, 0, 2, 0,1,  20441.0,   21.0,   10.0, -10758.0,   0.0,  -3.0},
-			{ 2, 0, 0, 0,0,  29243.0,    0.0,  -74.0,   -609.0,   0.0,  13.0},
-			{ 0, 0, 2, 0,0,  25887.0,    0.0,  -66.0,   -550.0,   0.0,  11.0},
-			{ 0, 1, 0, 0,1, -14053.0,  -25.0,   79.0,   8551.0,  -2.0, -45.0},
-			{-1, 0, 0, 2,1,  15164.0,   10.0,   11.0,  -8001.0,   0.0,  -1.0},
-			{ 0, 2, 2,-2,2, -15794.0,   72.0,  -16.0,   6850.0, -42.0,  -5.0},
-
-			/* 31-40 */
-			{ 0, 0,-2, 2,0,  21783.0,    0.0,   13.0,   -167.0,   0.0,  13.0},
-			{ 1, 0, 0,-2,1, -12873.0,  -10.0,  -37.0,   6953.0,   0.0, -14.0},
-			{ 0,-1, 0, 0,1, -12654.0,   11.0,   63.0,   6415.0,   0.0,  26.0},
-			{-1, 0, 2, 2,1, -10204.0,    0.0,   25.0,   5222.0,   0.0,  15.0},
-			{ 0, 2, 0, 0,0,  16707.0,  -85.0,  -10.0,    168.0,  -1.0,  10.0},
-			{ 1, 0, 2, 2,2,  -7691.0,    0.0,   44.0,   3268.0,   0.0,  19.0},
-			{-2, 0, 2, 0,0, -11024.0,    0.0,  -14.0,    104.0,   0.0,   2.0},
-			{ 0, 1, 2, 0,2,   7566.0,  -21.0,  -11.0,  -3250.0,   0.0,  -5.0},
-			{ 0, 0, 2, 2,1,  -6637.0,  -11.0,   25.0,   3353.0,   0.0,  14.0},
-			{ 0,-1, 2, 0,2,  -7141.0,   21.0,    8.0,   3070.0,   0.0,   4.0},
-
-			/* 41-50 */
-			{ 0, 0, 0, 2,1,  -6302.0,  -11.0,    2.0,   3272.0,   0.0,   4.0},
-			{ 1, 0, 2,-2,1,   5800.0,   10.0,    2.0,  -3045.0,   0.0,  -1.0},
-			{ 2, 0, 2,-2,2,   6443.0,    0.0,   -7.0,  -2768.0,   0.0,  -4.0},
-			{-2, 0, 0, 2,1,  -5774.0,  -11.0,  -15.0,   3041.0,   0.0,  -5.0},
-			{ 2, 0, 2, 0,1,  -5350.0,    0.0,   21.0,   2695.0,   0.0,  12.0},
-			{ 0,-1, 2,-2,1,  -4752.0,  -11.0,   -3.0,   2719.0,   0.0,  -3.0},
-			{ 0, 0, 0,-2,1,  -4940.0,  -11.0,  -21.0,   2720.0,   0.0,  -9.0},
-			{-1,-1, 0, 2,0,   7350.0,    0.0,   -8.0,    -51.0,   0.0,   4.0},
-			{ 2, 0, 0,-2,1,   4065.0,    0.0,    6.0,  -2206.0,   0.0,   1.0},
-			{ 1, 0, 0, 2,0,   6579.0,    0.0,  -24.0,   -199.0,   0.0,   2.0},
-
-			/* 51-60 */
-			{ 0, 1, 2,-2,1,   3579.0,    0.0,    5.0,  -1900.0,   0.0,   1.0},
-			{ 1,-1, 0, 0,0,   4725.0,    0.0,   -6.0,    -41.0,   0.0,   3.0},
-			{-2, 0, 2, 0,2,  -3075.0,    0.0,   -2.0,   1313.0,   0.0,  -1.0},
-			{ 3, 0, 2, 0,2,  -2904.0,    0.0,   15.0,   1233.0,   0.0,   7.0},
-			{ 0,-1, 0, 2,0,   4348.0,    0.0,  -10.0,    -81.0,   0.0,   2.0},
-			{ 1,-1, 2, 0,2,  -2878.0,    0.0,    8.0,   1232.0,   0.0,   4.0},
-			{ 0, 0, 0, 1,0,  -4230.0,    0.0,    5.0,    -20.0,   0.0,  -2.0},
-			{-1,-1, 2, 2,2,  -2819.0,    0.0,    7.0,   1207.0,   0.0,   3.0},
-			{-1, 0, 2, 0,0,  -4056.0,    0.0,    5.0,     40.0,   0.0,  -2.0},
-			{ 0,-1, 2, 2,2,  -2647.0,    0.0,   11.0,   1129.0,   0.0,   5.0},
-
-			/* 61-70 */
-			{-2, 0, 0, 0,1,  -2294.0,    0.0,  -10.0,   1266.0,   0.0,  -4.0},
-			{ 1, 1, 2, 0,2,   2481.0,    0.0,   -7.0,  -1062.0,   0.0,  -3.0},
-			{ 2, 0, 0, 0,1,   2179.0,    0.0,   -2.0,  -1129.0,   0.0,  -2.0},
-			{-1, 1, 0, 1,0,   3276.0,    0.0,    1.0,     -9.0,   0.0,   0.0},
-			{ 1, 1, 0, 0,0,  -3389.0,    0.0,    5.0,     35.0,   0.0,  -2.0},
-			{ 1, 0, 2, 0,0,   3339.0,    0.0,  -13.0,   -107.0,   0.0,   1.0},
-			{-1, 0, 2,-2,1,  -1987.0,    0.0,   -6.0,   1073.0,   0.0,  -2.0},
-			{ 1, 0, 0, 0,2,  -1981.0,    0.0,    0.0,    854.0,   0.0,   0.0},
-			{-1, 0, 0, 1,0,   4026.0,    0.0, -353.0,   -553.0,   0.0,-139.0},
-			{ 0, 0, 2, 1,2,   1660.0,    0.0,   -5.0,   -710.0,   0.0,  -2.0},
-
-			/* 71-77 */
-			{-1, 0, 2, 4,2,  -1521.0,    0.0,    9.0,    647.0,   0.0,   4.0},
-			{-1, 1, 0, 1,1,   1314.0,    0.0,    0.0,   -700.0,   0.0,   0.0},
-			{ 0,-2, 2,-2,1,  -1283.0,    0.0,    0.0,    672.0,   0.0,   0.0},
-			{ 1, 0, 2, 2,1,  -1331.0,    0.0,    8.0,    663.0,   0.0,   4.0},
-			{-2, 0, 2, 2,2,   1383.0,    0.0,   -2.0,   -594.0,   0.0,  -2.0},
-			{-1, 0, 0, 0,2,   1405.0,    0.0,    4.0,   -610.0,   0.0,   2.0},
-			{ 1, 1, 2,-2,2,   1290.0,    0.0,    0.0,   -556.0,   0.0,   0.0}
-	};
-
-	/* Number of terms in the series */
-	const int NLS = (int) (sizeof x / sizeof x[0]);
-	/* Mean anomaly of the Moon. */
-	double el = MeanAnomalyMoon();
-	/* Mean anomaly of the Sun. */
-	double elp = MeanAnomalySun();
-	/* Mean argument of the latitude of the Moon. */
-	double f = RelLongMoon();
-	/* Mean elongation of the Moon from the Sun. */
-	double d = MeanElongationMoonSun();
-	/* Mean longitude of the ascending node of the Moon. */
-	double om = MeanLongAscNodeMoon();
-
-	nl = no = 0.0;
-
-	/* Summation of luni-solar nutation series (smallest terms first). */
-	for (int i = NLS-1; i >= 0; --i) {
-		/* Argument and functions. */
-		arg =   (double)x[i].nl  * el  +
-				(double)x[i].nlp * elp +
-				(double)x[i].nf  * f   +
-				(double)x[i].nd  * d   +
-				(double)x[i].nom * om;
-		sarg = sin(arg);
-		carg = cos(arg);
-	   /* Term. */
-	      nl += (x[i].ps + x[i].pst * t) * sarg + x[i].pc * carg;
-	      no += (x[i].ec + x[i].ect * t) * carg + x[i].es * sarg;
-	   }
-
-	nl = nl * U2R + DPPLAN;
-	no = no * U2R + DEPLAN;
+	nutation_series(JulianCentury(), MeanAnomalyMoon(), MeanAnomalySun(),
+			RelLongMoon(), MeanElongationMoonSun(), MeanLongAscNodeMoon(), nl, no);
 }
 
 double ATimeSpace::NutationLongitude() {
@@ -779,8 +934,39 @@ void ATimeSpace::SunPosition(double& ra, double& dec) {
 	dec = values_[ATS_POSITION_SUN_DEC];
 }
 
+/*
+ * 月亮运动较快, 采用地球时(TT)计算
+ */
+void ATimeSpace::MoonPosition(double& ra, double& dec) {
+	if (!valid_[ATS_POSITION_MOON]) {
+		double t = JulianCentury(TAI() + TTMTAI / DAYSEC);
+
+		MoonPosition(t, values_[ATS_POSITION_MOON_RA], values_[ATS_POSITION_MOON_DEC],
+				values_[ATS_POSITION_MOON_DIST]);
+		valid_[ATS_POSITION_MOON] = true;
+	}
+
+	ra  = values_[ATS_POSITION_MOON_RA];
+	dec = values_[ATS_POSITION_MOON_DEC];
+}
+
+double ATimeSpace::MoonDistance() {
+	double ra, dec;
+	MoonPosition(ra, dec);
+	return values_[ATS_POSITION_MOON_DIST];
+}
+
+double ATimeSpace::MoonIllumination() {
+	if (!valid_[ATS_ILLUMINATION_MOON]) {
+		values_[ATS_ILLUMINATION_MOON] = MoonIllumination(JulianCentury(TAI() + TTMTAI / DAYSEC));
+		valid_[ATS_ILLUMINATION_MOON]  = true;
+	}
+	return values_[ATS_ILLUMINATION_MOON];
+}
+
 void ATimeSpace::invalid_values() {
 	memset(valid_, 0, ATS_END * sizeof(bool));
+	memset(age_, 0, ATS_END * sizeof(double));
 }
 
 double ATimeSpace::ModifiedJulianDay(int iy, int im, int id, double fd) {
@@ -805,8 +991,11 @@ double ATimeSpace::Epoch(double mjd) {
 	return (2000.0 + (mjd - MJD2K) / 365.25);
 }
 
-double ATimeSpace::DeltaAT(int iy, int im, int id, double fd) {
-	const int IYV = 2017;	// 最后更新闰秒: 2017-01-01
+/*
+ * 闰秒表. 算法来源: sofa/iauDat
+ * 内置表最后更新闰秒: 2017-01-01. 可由LoadLeapSecond()从IERS文件更新
+ */
+void ATimeSpace::init_leap_second() {
 	/* Reference dates (MJD) and drift rates (s/day), pre leap seconds */
 	static const double drift[][2] = {
 			{ 37300.0, 0.0012960 },
@@ -879,25 +1068,86 @@ double ATimeSpace::DeltaAT(int iy, int im, int id, double fd) {
 
 	/* Number of Delta(AT) changes */
 	const int NDAT = sizeof changes / sizeof changes[0];
+	leap_second ls;
+
+	leaps_.clear();
+	for (int i = 0; i < NDAT; ++i) {
+		ls.mjd   = ModifiedJulianDay(changes[i].iyear, changes[i].month, 1, 0.0);
+		ls.delat = changes[i].delat;
+		ls.mjdref= i < NERA1 ? drift[i][0] : 0.0;
+		ls.drift = i < NERA1 ? drift[i][1] : 0.0;
+		leaps_.push_back(ls);
+	}
+	datfrom_ = HUGE_VAL;	// 使缓存失效
+	datnext_ = -HUGE_VAL;
+	datidx_  = -1;
+}
 
-	/* Miscellaneous local variables */
-	int i, m;
-	double da(0.0);
+/*
+ * 文件格式与IERS Leap_Second.dat一致, 每行为: MJD 日 月 年 TAI-UTC, '#'起始为注释行
+ * 文件中最早日期之前的内置表项(含1972年前的漂移项)被保留
+ */
+int ATimeSpace::LoadLeapSecond(const char *filepath) {
+	FILE *fp;
+	char line[200];
+	int iy, im, id;
+	double mjd, dat;
+	leapvec loaded;
+	leap_second ls;
+
+	if (!filepath || !(fp = fopen(filepath, "r"))) return -1;
+	while (fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#' || sscanf(line, "%lf %d %d %d %lf", &mjd, &id, &im, &iy, &dat) != 5) continue;
+		if (!loaded.empty() && mjd <= loaded.back().mjd) {
+			fclose(fp);
+			return -3;
+		}
+		ls.mjd   = mjd;
+		ls.delat = dat;
+		ls.mjdref= ls.drift = 0.0;
+		loaded.push_back(ls);
+	}
+	fclose(fp);
+	if (loaded.empty()) return -2;
 
-	/* Combine year and month to form a date-ordered integer... */
-	m = 12 * iy + im;
+	init_leap_second();
+	while (!leaps_.empty() && leaps_.back().mjd >= loaded.front().mjd) leaps_.pop_back();
+	leaps_.insert(leaps_.end(), loaded.begin(), loaded.end());
 
-	/* ...and use it to find the preceding table entry. */
-	for (i = NDAT-1; i >=0; i--) {
-		if (m >= (12 * changes[i].iyear + changes[i].month)) break;
-	}
+	return (int) loaded.size();
+}
+
+void ATimeSpace::CopyLeapSecond(const ATimeSpace &other) {
+	leaps_  = other.leaps_;
+	datfrom_ = HUGE_VAL;	// 使缓存失效
+	datnext_ = -HUGE_VAL;
+	datidx_  = -1;
+}
 
-	/* Get the Delta(AT). */
-	da = changes[i].delat;
+/*
+ * 闰秒只在UTC日的0时变化. 缓存查找到的表项及其有效区间[datfrom_, datnext_),
+ * 区间内各日(例如UTC2TAI()中的今日与明日)的调用不再查表
+ */
+double ATimeSpace::DeltaAT(int iy, int im, int id, double fd) {
+	double mjd = ModifiedJulianDay(iy, im, id, 0.0);
+
+	if (mjd < datfrom_ || mjd >= datnext_) {
+		/* 二分查找生效时间不晚于mjd的最后一个表项 */
+		int n(leaps_.size()), low(0), high(n), mid;
+		while (low < high) {
+			mid = (low + high) / 2;
+			if (leaps_[mid].mjd <= mjd) low = mid + 1;
+			else high = mid;
+		}
+		datidx_  = low - 1;
+		datfrom_ = datidx_ < 0 ? -HUGE_VAL : leaps_[datidx_].mjd;
+		datnext_ = low < n ? leaps_[low].mjd : HUGE_VAL;
+	}
+	if (datidx_ < 0) return 0.0;	// 1960年之前
 
 	/* If pre-1972, adjust for drift. */
-	if (i < NERA1) da += (ModifiedJulianDay(iy, im, id, fd) + fd - drift[i][0]) * drift[i][1];
-	return da;
+	const leap_second &ls = leaps_[datidx_];
+	return ls.drift == 0.0 ? ls.delat : ls.delat + (mjd + fd - ls.mjdref) * ls.drift;
 }
 
 int ATimeSpace::HourStr2Dbl(const char *str, double &hour) {
@@ -1107,6 +1357,59 @@ double ATimeSpace::SphereAngle(double l1, double b1, double l2, double b2) {
 	return acos(sin(b1) * sin(b2) + cos(b1) * cos(b2) * cos(l1 - l2));
 }
 
+/*
+ * 批量计算时, 方位角和视差角的分子分母同乘cos(dec)或cos(lat), 以sin/cos代替tan,
+ * 每个目标只需计算一次时角和赤纬的正弦与余弦
+ */
+void ATimeSpace::Eq2Horizon(int n, double lst, const double ra[], const double dec[],
+		double azi[], double alt[], double pa[], double ref[], double airp, double temp) {
+	double slat = sin(lat_), clat = cos(lat_);
+	double k = (airp / 1010.0) * (283.0 / (273.0 + temp));
+	double ha, sha, cha, sdc, cdc, a, h;
+
+	for (int i = 0; i < n; ++i) {
+		ha  = lst - ra[i];
+		sha = sin(ha);
+		cha = cos(ha);
+		sdc = sin(dec[i]);
+		cdc = cos(dec[i]);
+		a = atan2(sha * cdc, cha * cdc * slat - sdc * clat);
+		azi[i] = a < 0 ? a + A2PI : a;
+		alt[i] = asin(slat * sdc + clat * cdc * cha);
+		if (pa) pa[i] = atan2(sha * clat, slat * cdc - sdc * cha * clat);
+		if (ref) {
+			h = alt[i] * R2D;
+			ref[i] = (1.02 / tan((h + 10.3 / (h + 5.11)) * D2R) + 1.9279E-3) * k;
+		}
+	}
+}
+
+void ATimeSpace::Horizon2Eq(int n, double lst, const double azi[], const double alt[],
+		double ra[], double dec[]) {
+	double slat = sin(lat_), clat = cos(lat_);
+	double saz, caz, sal, cal, ha;
+
+	for (int i = 0; i < n; ++i) {
+		saz = sin(azi[i]);
+		caz = cos(azi[i]);
+		sal = sin(alt[i]);
+		cal = cos(alt[i]);
+		ha = atan2(saz * cal, caz * cal * slat + sal * clat);
+		ra[i]  = cyclemod(lst - ha, A2PI);
+		dec[i] = asin(slat * sal - clat * cal * caz);
+	}
+}
+
+void ATimeSpace::ParallacticAngle(int n, double lst, const double ra[], const double dec[], double pa[]) {
+	double slat = sin(lat_), clat = cos(lat_);
+	double ha;
+
+	for (int i = 0; i < n; ++i) {
+		ha = lst - ra[i];
+		pa[i] = atan2(sin(ha) * clat, slat * cos(dec[i]) - sin(dec[i]) * cos(ha) * clat);
+	}
+}
+
 void ATimeSpace::EqTransfer(double rai, double deci, double& rao, double& deco) {
 	double t = JulianCentury();			// 输出历元与输入历元之间的儒略世纪数
 	double eps0= 84381.406 * AS2R;		// J2000对应的黄赤交角
@@ -1177,6 +1480,120 @@ void ATimeSpace::EqReTransfer(double rai, double deci, double& rao, double& deco
 	Eclip2Eq(l, b, eps0, rao, deco);
 }
 
+/*
+ * 矩阵左乘绕x轴旋转: m = R1(a) * m. 算法来源: sofa/iauRx
+ */
+static void rotate_x(double a, double m[3][3]) {
+	double s = sin(a), c = cos(a), a1, a2;
+	for (int j = 0; j < 3; ++j) {
+		a1 =  c * m[1][j] + s * m[2][j];
+		a2 = -s * m[1][j] + c * m[2][j];
+		m[1][j] = a1;
+		m[2][j] = a2;
+	}
+}
+
+/*
+ * 矩阵左乘绕z轴旋转: m = R3(a) * m. 算法来源: sofa/iauRz
+ */
+static void rotate_z(double a, double m[3][3]) {
+	double s = sin(a), c = cos(a), a0, a1;
+	for (int j = 0; j < 3; ++j) {
+		a0 =  c * m[0][j] + s * m[1][j];
+		a1 = -s * m[0][j] + c * m[1][j];
+		m[0][j] = a0;
+		m[1][j] = a1;
+	}
+}
+
+/*
+ * 岁差采用与EqTransfer()相同的黄道坐标系参数, 各旋转依次为:
+ * J2000赤道 -> J2000黄道 -> 当前历元平黄道 -> 当前历元真黄道 -> 当前历元真赤道
+ * 周年光行差在当前历元平黄道中表示为速度矢量, 随后与坐标一起转换到真赤道
+ */
+void ATimeSpace::precession_nutation_matrix() {
+	if (valid_[ATS_PN_MATRIX]) return;
+
+	double t = JulianCentury();
+	double eps0= 84381.406 * AS2R;		// J2000对应的黄赤交角
+	double eps = TrueObliquity();		// 输出历元对应的真黄赤交角
+	double nl = NutationLongitude();	// 黄经章动
+	double lsun = MeanLongSun() + CenterSun();	// 太阳真黄经
+	double ec = EccentricityEarth();		// 地球偏心率
+	double pl = PerihelionLongEarth();	// 地球轨道近日点黄经
+	double K = 20.49552 * AS2R;			// 光行差常数
+	double x, y, z, v[2], w;
+
+	/* 岁差 */
+	x = ((47.0029 - (0.03302 - 6E-5 * t) * t) * t) * AS2R;
+	y = (629554.9824 - (869.8089 - 0.03536 * t) * t) * AS2R;
+	z = (5029.0966 + (1.11113 - 6E-6 * t) * t) * t * AS2R;
+
+	memset(pnm_, 0, sizeof(pnm_));
+	pnm_[0][0] = pnm_[1][1] = pnm_[2][2] = 1.0;
+	rotate_x(eps0, pnm_);
+	rotate_z(y, pnm_);
+	rotate_x(x, pnm_);
+	rotate_z(-(y + z), pnm_);
+	/* 章动及黄道坐标转换为赤道坐标 */
+	rotate_z(-nl, pnm_);
+	rotate_x(-eps, pnm_);
+	/* 光行差: 平黄道中的速度矢量, 满足EqTransfer()中dl和db的一阶关系 */
+	v[0] =  K * (sin(lsun) - ec * sin(pl));
+	v[1] = -K * (cos(lsun) - ec * cos(pl));
+	/* 光行差矢量同样旋转至真赤道: R1(-eps) * R3(-nl) * v */
+	abv_[0] = cos(nl) * v[0] - sin(nl) * v[1];
+	w       = sin(nl) * v[0] + cos(nl) * v[1];
+	abv_[1] = cos(eps) * w;
+	abv_[2] = sin(eps) * w;
+
+	valid_[ATS_PN_MATRIX] = true;
+}
+
+void ATimeSpace::EqTransfer(int n, const double rai[], const double deci[], double rao[], double deco[]) {
+	double p[3], q[3], cd, r;
+
+	precession_nutation_matrix();
+	for (int i = 0; i < n; ++i) {
+		cd = cos(deci[i]);
+		p[0] = cd * cos(rai[i]);
+		p[1] = cd * sin(rai[i]);
+		p[2] = sin(deci[i]);
+		q[0] = pnm_[0][0] * p[0] + pnm_[0][1] * p[1] + pnm_[0][2] * p[2] + abv_[0];
+		q[1] = pnm_[1][0] * p[0] + pnm_[1][1] * p[1] + pnm_[1][2] * p[2] + abv_[1];
+		q[2] = pnm_[2][0] * p[0] + pnm_[2][1] * p[1] + pnm_[2][2] * p[2] + abv_[2];
+		r = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+		rao[i]  = cyclemod(atan2(q[1], q[0]), A2PI);
+		deco[i] = asin(q[2] / r);
+	}
+}
+
+/*
+ * 由视位置方向u求解单位矢量p, 使p+v与u同向: p = k*u - v, |p| = 1
+ */
+void ATimeSpace::EqReTransfer(int n, const double rai[], const double deci[], double rao[], double deco[]) {
+	double v2, u[3], p[3], cd, uv, k;
+
+	precession_nutation_matrix();
+	v2 = abv_[0] * abv_[0] + abv_[1] * abv_[1] + abv_[2] * abv_[2];
+	for (int i = 0; i < n; ++i) {
+		cd = cos(deci[i]);
+		u[0] = cd * cos(rai[i]);
+		u[1] = cd * sin(rai[i]);
+		u[2] = sin(deci[i]);
+		uv = u[0] * abv_[0] + u[1] * abv_[1] + u[2] * abv_[2];
+		k  = uv + sqrt(uv * uv - v2 + 1.0);
+		u[0] = k * u[0] - abv_[0];
+		u[1] = k * u[1] - abv_[1];
+		u[2] = k * u[2] - abv_[2];
+		p[0] = pnm_[0][0] * u[0] + pnm_[1][0] * u[1] + pnm_[2][0] * u[2];
+		p[1] = pnm_[0][1] * u[0] + pnm_[1][1] * u[1] + pnm_[2][1] * u[2];
+		p[2] = pnm_[0][2] * u[0] + pnm_[1][2] * u[1] + pnm_[2][2] * u[2];
+		rao[i]  = cyclemod(atan2(p[1], p[0]), A2PI);
+		deco[i] = asin(p[2]);
+	}
+}
+
 int ATimeSpace::TwilightTime(double& sunrise, double& sunset, int type) {
 	double alt;
 	alt = type == 1 ? -6.0 :			// 民用晨昏时
@@ -4,8 +4,6 @@
  * @versiion 0.3
  * @note
  * 欠缺功能
- * - 月亮位置
- * - 月相
  * - UTC与UT转换: 由计算机获得的U变量TC时间对应的UT才是计算恒星时的输入
  * - 历元转换
  * - 小行星、彗星
@@ -30,6 +28,9 @@
 #ifndef ATIMESPACE_H_
 #define ATIMESPACE_H_
 
+#include <stddef.h>
+#include <vector>
+
 namespace AstroUtil {
 ///////////////////////////////////////////////////////////////////////////////
 class ATimeSpace {
@@ -75,6 +76,18 @@ public:
 	 * @param t 历元
 	 */
 	void SetMJD(double mjd);
+	/*!
+	 * @brief 将UTC时间推进dt, 保留仍在有效期内的缓存数值
+	 * @param dt 推进时长, 量纲: 秒. 可为负
+	 * @note
+	 * - 恒星时、太阳与月亮位置等快变量在推进后重新计算
+	 * - 日月平近点角、平黄经等按线性变化率外推
+	 * - 平黄赤交角、章动、岁差-章动矩阵等慢变量在有效期内直接复用, 误差小于1毫角秒
+	 * - 累计推进时长超出有效期后, 缓存数值失效并重新计算
+	 * @note
+	 * 适用于跟踪等逐秒更新时间的场合. 首次使用前应调用SetUTC()等函数设置时间
+	 */
+	void Advance(double dt);
 	/*!
 	 * @brief 计算修正儒略日
 	 * @param iy 年
@@ -109,6 +122,25 @@ public:
 	 * 闰秒, 量纲: 秒
 	 */
 	double DeltaAT(int iy, int im, int id, double fd);
+	/*!
+	 * @brief 从IERS闰秒文件(Leap_Second.dat)加载闰秒表
+	 * @param filepath 文件路径
+	 * @return
+	 * >0: 加载的闰秒表项数量
+	 * -1: 文件访问失败
+	 * -2: 文件中无有效闰秒表项
+	 * -3: 文件中日期非递增
+	 * @note
+	 * 加载失败时继续使用此前的闰秒表
+	 */
+	int LoadLeapSecond(const char *filepath);
+	/*!
+	 * @brief 复制其它对象的闰秒表
+	 * @param other 已加载闰秒表的对象
+	 * @note
+	 * 调用者负责与其它访问闰秒表的线程互斥
+	 */
+	void CopyLeapSecond(const ATimeSpace &other);
 	/*!
 	 * @brief 修正儒略日转换为格里高利历
 	 * @param mjd 修正儒略日
@@ -284,6 +316,31 @@ public:
 	 * 太阳真黄经, 量纲: 弧度
 	 */
 	double TrueLongSun(double t);
+	/*!
+	 * @brief 计算与儒略世纪对应的月亮平黄经
+	 * @param t 相对J2000的儒略世纪
+	 * @return
+	 * 平黄经, 量纲: 弧度
+	 */
+	double MeanLongMoon(double t);
+	/*!
+	 * @brief 计算与儒略世纪对应的月亮地心视位置
+	 * @param t    相对J2000的儒略世纪, 地球时(TT)
+	 * @param ra   赤经, 量纲: 弧度
+	 * @param dec  赤纬, 量纲: 弧度
+	 * @param dist 地心距离, 量纲: 千米
+	 * @note
+	 * 算法来源: Jean Meeus <Astronomical Algorithms>, 第47章. 截断至振幅不低于0.0003度的周期项,
+	 * 黄经误差约10角秒
+	 */
+	void MoonPosition(double t, double& ra, double& dec, double& dist);
+	/*!
+	 * @brief 计算与儒略世纪对应的月面照亮比例
+	 * @param t 相对J2000的儒略世纪, 地球时(TT)
+	 * @return
+	 * 照亮比例, 范围: [0, 1]. 0: 新月; 1: 满月
+	 */
+	double MoonIllumination(double t);
 
 public:
 	/*!
@@ -452,6 +509,24 @@ public:
 	 * @param dec 赤纬, 量纲: 弧度
 	 */
 	void SunPosition(double& ra, double& dec);
+	/*!
+	 * @brief 当前时间对应的月亮地心视位置
+	 * @param ra  赤经, 量纲: 弧度
+	 * @param dec 赤纬, 量纲: 弧度
+	 */
+	void MoonPosition(double& ra, double& dec);
+	/*!
+	 * @brief 当前时间对应的月亮地心距离
+	 * @return
+	 * 地心距离, 量纲: 千米
+	 */
+	double MoonDistance();
+	/*!
+	 * @brief 当前时间对应的月面照亮比例
+	 * @return
+	 * 照亮比例, 范围: [0, 1]
+	 */
+	double MoonIllumination();
 
 public:
 	/*!
@@ -531,6 +606,46 @@ public:
 	 */
 	double SphereAngle(double l1, double b1, double l2, double b2);
 
+public:
+	/*!
+	 * @brief 批量将赤道坐标转换为地平坐标, 并计算视差角和蒙气差
+	 * @param n    目标数量
+	 * @param lst  本地恒星时, 量纲: 弧度
+	 * @param ra   赤经, 量纲: 弧度
+	 * @param dec  赤纬, 量纲: 弧度
+	 * @param azi  方位角, 量纲: 弧度. 南零点
+	 * @param alt  高度角, 量纲: 弧度
+	 * @param pa   视差角, 量纲: 弧度. 为NULL时不计算
+	 * @param ref  由真高度角计算的蒙气差, 量纲: 角分. 为NULL时不计算
+	 * @param airp 大气压, 量纲: 毫巴
+	 * @param temp 气温, 量纲: 摄氏度
+	 * @note
+	 * 所有目标共用测站位置和恒星时, 测站纬度的三角函数只计算一次
+	 */
+	void Eq2Horizon(int n, double lst, const double ra[], const double dec[],
+			double azi[], double alt[], double pa[] = NULL, double ref[] = NULL,
+			double airp = 1010.0, double temp = 10.0);
+	/*!
+	 * @brief 批量将地平坐标转换为赤道坐标
+	 * @param n    目标数量
+	 * @param lst  本地恒星时, 量纲: 弧度
+	 * @param azi  方位角, 量纲: 弧度. 南零点
+	 * @param alt  高度角, 量纲: 弧度
+	 * @param ra   赤经, 量纲: 弧度
+	 * @param dec  赤纬, 量纲: 弧度
+	 */
+	void Horizon2Eq(int n, double lst, const double azi[], const double alt[],
+			double ra[], double dec[]);
+	/*!
+	 * @brief 批量计算视差角
+	 * @param n    目标数量
+	 * @param lst  本地恒星时, 量纲: 弧度
+	 * @param ra   赤经, 量纲: 弧度
+	 * @param dec  赤纬, 量纲: 弧度
+	 * @param pa   视差角, 量纲: 弧度
+	 */
+	void ParallacticAngle(int n, double lst, const double ra[], const double dec[], double pa[]);
+
 public:
 	/*!
 	 * @brief 赤道坐标历元转换. 输入坐标系: J2000, 输出坐标系: UTC对应历元
@@ -560,6 +675,30 @@ public:
 	 * 已验证与EqTransfer()的一致性. Nov 17, 2018
 	 */
 	void EqReTransfer(double rai, double deci, double& rao, double& deco);
+	/*!
+	 * @brief 批量赤道坐标历元转换. 输入坐标系: J2000, 输出坐标系: UTC对应历元
+	 * @param n     目标数量
+	 * @param rai   输入赤经, 量纲: 弧度
+	 * @param deci  输入赤纬, 量纲: 弧度
+	 * @param rao   输出赤经, 量纲: 弧度
+	 * @param deco  输出赤纬, 量纲: 弧度
+	 * @note
+	 * 岁差、章动合并为旋转矩阵, 与周年光行差一起在每个历元只计算一次.
+	 * 光行差按速度矢量叠加. 黄纬±80度以内与EqTransfer()的差异小于10毫角秒;
+	 * 黄极附近EqTransfer()的光行差公式含1/cos(b), 不再适用
+	 */
+	void EqTransfer(int n, const double rai[], const double deci[], double rao[], double deco[]);
+	/*!
+	 * @brief 批量赤道坐标历元转换. 输入坐标系: UTC对应历元, 输出坐标系: J2000
+	 * @param n     目标数量
+	 * @param rai   输入赤经, 量纲: 弧度
+	 * @param deci  输入赤纬, 量纲: 弧度
+	 * @param rao   输出赤经, 量纲: 弧度
+	 * @param deco  输出赤纬, 量纲: 弧度
+	 * @note
+	 * 是EqTransfer(int, ...)的严格逆变换
+	 */
+	void EqReTransfer(int n, const double rai[], const double deci[], double rao[], double deco[]);
 	/*!
 	 * @brief 计算晨光始与昏影终
 	 * @param sunrise 晨光始, 量纲: 小时
@@ -647,6 +786,29 @@ private:
 	 * @brief 重置数据区
 	 */
 	void invalid_values();
+	/*!
+	 * @brief 使用内置数据初始化闰秒表
+	 */
+	void init_leap_second();
+	/*!
+	 * @brief 章动序列求和, 由Nutation()调用
+	 * @param t   相对J2000的儒略世纪
+	 * @param el  月亮平近点角, 量纲: 弧度
+	 * @param elp 太阳平近点角, 量纲: 弧度
+	 * @param f   月亮相对升交点平黄经位移, 量纲: 弧度
+	 * @param d   日月平角距, 量纲: 弧度
+	 * @param om  月亮升交点平黄经, 量纲: 弧度
+	 * @param nl  黄经章动, 量纲: 弧度
+	 * @param no  交角章动, 量纲: 弧度
+	 */
+	void nutation_series(double t, double el, double elp, double f, double d, double om,
+			double& nl, double& no);
+	/*!
+	 * @brief 计算UTC对应历元的岁差-章动矩阵和光行差矢量
+	 * @note
+	 * 结果存储在pnm_和abv_中, 由valid_[ATS_PN_MATRIX]标志有效性
+	 */
+	void precession_nutation_matrix();
 
 private:
 	enum {
@@ -679,6 +841,9 @@ private:
 		ATS_POSITION_MOON,		//< 月亮赤道坐标
 		ATS_POSITION_MOON_RA,
 		ATS_POSITION_MOON_DEC,
+		ATS_POSITION_MOON_DIST,
+		ATS_ILLUMINATION_MOON,	//< 月面照亮比例
+		ATS_PN_MATRIX,			//< 岁差-章动矩阵与光行差矢量
 		ATS_END		//< 最后一个数值, 用作判断缓冲区长度
 	};
 
@@ -688,6 +853,23 @@ private:
 	int		tz_;	//< 时区, 量纲: 小时. 东经时区为正
 	double	values_[ATS_END];	//< 数据缓冲区, 避免重复计算
 	bool	valid_[ATS_END];	//< 数据缓冲区有效性
+	double	age_[ATS_END];		//< 缓存数值被Advance()累计推进的时长, 量纲: 日
+	double	mjdset_;	//< 最近一次SetUTC()设置的修正儒略日
+	double	elapsed_;	//< Advance()自mjdset_累计推进的时长, 量纲: 秒. 避免逐次累加日的小数引入舍入误差
+	struct leap_second {// 闰秒表项
+		double mjd;		//< 生效日期对应的修正儒略日
+		double delat;	//< DAT=TAI-UTC, 量纲: 秒
+		double mjdref;	//< 1972年之前: 漂移参考日期, 量纲: 修正儒略日
+		double drift;	//< 1972年之前: 漂移率, 量纲: 秒/天. 1972年之后为0
+	};
+	typedef std::vector<leap_second> leapvec;
+
+	leapvec	leaps_;		//< 闰秒表, 按生效日期递增排列
+	double	datfrom_;	//< 闰秒缓存的有效起始日: 表项datidx_的生效日期, 量纲: 修正儒略日
+	double	datnext_;	//< 闰秒缓存的有效截止日(不含): 下一表项的生效日期, 量纲: 修正儒略日
+	int		datidx_;	//< 闰秒缓存对应的闰秒表索引
+	double	pnm_[3][3];	//< 岁差-章动矩阵: J2000赤道坐标至UTC对应历元的真赤道坐标
+	double	abv_[3];	//< 周年光行差速度矢量, 在UTC对应历元的真赤道坐标系中, 量纲: 弧度
 };
 ///////////////////////////////////////////////////////////////////////////////
 }
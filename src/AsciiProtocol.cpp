@@ -12,6 +12,17 @@ using namespace boost;
 AsciiProtocol::AsciiProtocol() {
 	ibuf_ = 0;
 	buff_.reset(new char[1024 * 10]); //< 存储区
+
+	const char* name = "annaes_protocol_resolved_total";
+	const char* help = "Protocol messages resolved, by type";
+	mslit_   = _gMetrics.Counter(name, help, "type=\"" APTYPE_SLIT "\"");
+	mstart_  = _gMetrics.Counter(name, help, "type=\"" APTYPE_START "\"");
+	mstop_   = _gMetrics.Counter(name, help, "type=\"" APTYPE_STOP "\"");
+	mreload_ = _gMetrics.Counter(name, help, "type=\"" APTYPE_RELOAD "\"");
+	mstatus_ = _gMetrics.Counter(name, help, "type=\"" APTYPE_STATUS "\"");
+	msub_    = _gMetrics.Counter(name, help, "type=\"" APTYPE_SUB "\"");
+	munsub_  = _gMetrics.Counter(name, help, "type=\"" APTYPE_UNSUB "\"");
+	mfailed_ = _gMetrics.Counter("annaes_protocol_failures_total", "Protocol messages that failed to resolve");
 }
 
 AsciiProtocol::~AsciiProtocol() {
@@ -92,6 +103,21 @@ apbase AsciiProtocol::resolve_slit(likv &kvs) {
 	return to_apbase(proto);
 }
 
+apbase AsciiProtocol::resolve_status() {
+	apstatus proto = boost::make_shared<ascii_proto_status>();
+	return to_apbase(proto);
+}
+
+apbase AsciiProtocol::resolve_subscribe() {
+	apsub proto = boost::make_shared<ascii_proto_subscribe>();
+	return to_apbase(proto);
+}
+
+apbase AsciiProtocol::resolve_unsubscribe() {
+	apunsub proto = boost::make_shared<ascii_proto_unsubscribe>();
+	return to_apbase(proto);
+}
+
 apbase AsciiProtocol::Resolve(const char *rcvd) {
 	const char seps[] = ",", *ptr;
 	char ch;
@@ -109,16 +135,20 @@ apbase AsciiProtocol::Resolve(const char *rcvd) {
 	resolve_kv_array(tokens, kvs, basis);
 	// 按照协议类型解析键值对
 	if (type[0] == 's' || type[0] == 'S') {
-		if      (iequals(type, APTYPE_SLIT))   proto = resolve_slit(kvs);
-		else if (iequals(type, APTYPE_START))  proto = resolve_start();
-		else if (iequals(type, APTYPE_STOP))   proto = resolve_stop();
+		if      (iequals(type, APTYPE_SLIT))   { proto = resolve_slit(kvs); mslit_->Add(); }
+		else if (iequals(type, APTYPE_START))  { proto = resolve_start();   mstart_->Add(); }
+		else if (iequals(type, APTYPE_STOP))   { proto = resolve_stop();    mstop_->Add(); }
+		else if (iequals(type, APTYPE_STATUS)) { proto = resolve_status();  mstatus_->Add(); }
+		else if (iequals(type, APTYPE_SUB))    { proto = resolve_subscribe(); msub_->Add(); }
 	}
-	else if (iequals(type, APTYPE_RELOAD))  proto = resolve_reload();
+	else if (iequals(type, APTYPE_RELOAD))  { proto = resolve_reload(); mreload_->Add(); }
+	else if (iequals(type, APTYPE_UNSUB))   { proto = resolve_unsubscribe(); munsub_->Add(); }
 
 	if (proto.use_count()) {
 		proto->type = type;
 		proto->gid  = basis.gid;
 	}
+	else mfailed_->Add();
 
 	return proto;
 }
@@ -152,3 +182,25 @@ const char *AsciiProtocol::CompactSlit(apslit proto, int &n) {
 	if (proto->state != -1)   join_kv(output, "state",   proto->state);
 	return output_compacted(output, n);
 }
+
+void AsciiProtocol::CompactStatus(apstatus proto, string &output) {
+	output = APTYPE_STATUS;
+	output += " ";
+	int count = proto->items.size();
+	join_kv(output, "count", count);
+	trim_right_if(output, is_punct());
+	output += "\n";
+
+	for (std::vector<ascii_proto_status::item>::iterator it = proto->items.begin(); it != proto->items.end(); ++it) {
+		string line = APTYPE_STATUS;
+		line += " ";
+		if (!(*it).gid.empty())    join_kv(line, "gid",      (*it).gid);
+		join_kv(line, "state",    (*it).state);
+		join_kv(line, "automode", (*it).automode);
+		join_kv(line, "cntopen",  (*it).cntopen);
+		join_kv(line, "cntclose", (*it).cntclose);
+		if (!(*it).tmlast.empty()) join_kv(line, "tmlast",   (*it).tmlast);
+		trim_right_if(line, is_punct());
+		output += line + "\n";
+	}
+}
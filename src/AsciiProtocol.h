@@ -9,9 +9,11 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include <boost/smart_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/format.hpp>
+#include "Metrics.h"
 
 using std::string;
 using std::list;
@@ -22,6 +24,9 @@ using std::list;
 #define APTYPE_STOP		"stop"		//< 禁用自动开关天窗
 #define APTYPE_RELOAD	"reload"	//< 重新加载配置参数
 #define APTYPE_SLIT		"slit"		//< 天窗状态与指令
+#define APTYPE_STATUS	"status"	//< 查询全部天窗状态
+#define APTYPE_SUB		"subscribe"		//< 订阅天窗状态变化
+#define APTYPE_UNSUB	"unsubscribe"	//< 取消订阅天窗状态变化
 
 /*!
  * @struct ascii_proto_base 通信协议基类
@@ -86,6 +91,57 @@ public:
 };
 typedef boost::shared_ptr<ascii_proto_slit> apslit;
 
+/*!
+ * @struct ascii_proto_status 查询全部天窗状态
+ * @note
+ * 查询时不区分组标志. 应答时items为全部天窗, 封装为一行数量与逐行天窗状态:
+ * status count=N
+ * status gid=<gid>,state=<state>,automode=<0|1>,cntopen=<n>,cntclose=<n>,tmlast=<UTC>
+ */
+struct ascii_proto_status : public ascii_proto_base {
+	struct item {// 单个天窗状态
+		string gid;		//< 组标志
+		int state;		//< 天窗状态
+		int automode;	//< 自动开关天窗
+		int cntopen;	//< 计数: 打开
+		int cntclose;	//< 计数: 关闭
+		string tmlast;	//< 最后一次操作时间. 格式: CCYY-MM-DDThh:mm:ss; 未操作时为空
+	};
+	std::vector<item> items;	//< 天窗状态
+
+public:
+	ascii_proto_status() {
+		type = APTYPE_STATUS;
+	}
+};
+typedef boost::shared_ptr<ascii_proto_status> apstatus;
+
+/*!
+ * @struct ascii_proto_subscribe 订阅天窗状态变化
+ * @note
+ * gid为空时订阅全部天窗, 否则将gid加入已订阅集合. 天窗状态变化时以slit协议推送
+ */
+struct ascii_proto_subscribe : public ascii_proto_base {
+public:
+	ascii_proto_subscribe() {
+		type = APTYPE_SUB;
+	}
+};
+typedef boost::shared_ptr<ascii_proto_subscribe> apsub;
+
+/*!
+ * @struct ascii_proto_unsubscribe 取消订阅天窗状态变化
+ * @note
+ * gid为空时取消全部订阅, 否则将gid移出已订阅集合
+ */
+struct ascii_proto_unsubscribe : public ascii_proto_base {
+public:
+	ascii_proto_unsubscribe() {
+		type = APTYPE_UNSUB;
+	}
+};
+typedef boost::shared_ptr<ascii_proto_unsubscribe> apunsub;
+
 /*!
  * @brief 将ascii_proto_base继承类的boost::shared_ptr型指针转换为apbase类型
  * @param proto 协议指针
@@ -132,6 +188,15 @@ protected:
 	boost::mutex mtx_;	//< 互斥锁
 	int ibuf_;			//< 存储区索引
 	charray buff_;		//< 存储区
+	/* 运行指标 */
+	MetricCounter* mslit_;		//< 已解析: slit
+	MetricCounter* mstart_;		//< 已解析: start
+	MetricCounter* mstop_;		//< 已解析: stop
+	MetricCounter* mreload_;	//< 已解析: reload
+	MetricCounter* mstatus_;	//< 已解析: status
+	MetricCounter* msub_;		//< 已解析: subscribe
+	MetricCounter* munsub_;		//< 已解析: unsubscribe
+	MetricCounter* mfailed_;	//< 解析失败
 
 protected:
 	/*!
@@ -193,6 +258,18 @@ protected:
 	 * @brief 解析天窗状态/指令
 	 * */
 	apbase resolve_slit(likv &kvs);
+	/**
+	 * @brief 查询全部天窗状态
+	 * */
+	apbase resolve_status();
+	/**
+	 * @brief 订阅天窗状态变化
+	 * */
+	apbase resolve_subscribe();
+	/**
+	 * @brief 取消订阅天窗状态变化
+	 * */
+	apbase resolve_unsubscribe();
 
 public:
 	/*---------------- 解析通信协议 ----------------*/
@@ -219,6 +296,14 @@ public:
 	 * @brief 封装: 天窗状态/指令
 	 */
 	const char *CompactSlit(apslit proto, int &n);
+	/*!
+	 * @brief 封装: 全部天窗状态
+	 * @param proto  天窗状态
+	 * @param output 输出字符串, 含多行
+	 * @note
+	 * 输出长度随天窗数量增加, 不使用内部存储区
+	 */
+	void CompactStatus(apstatus proto, string &output);
 };
 typedef boost::shared_ptr<AsciiProtocol> AscProtoPtr;
 
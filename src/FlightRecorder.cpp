@@ -0,0 +1,222 @@
+/*
+ * @file FlightRecorder.cpp 类FlightRecorder的定义文件
+ * @version      0.1
+ * @date         2026年10月19日
+ */
+
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <boost/bind.hpp>
+#include "FlightRecorder.h"
+#include "globaldef.h"
+
+/* 异步信号安全的字符串拼接 */
+static void append_str(char *&p, const char *end, const char *s) {
+	while (*s && p < end) *p++ = *s++;
+}
+
+static void append_uint(char *&p, const char *end, uint64_t value) {
+	char digits[24];
+	int n(0);
+	do {
+		digits[n++] = char('0' + value % 10);
+		value /= 10;
+	} while (value);
+	while (n && p < end) *p++ = digits[--n];
+}
+
+/* 按完整长度写入文件 */
+static bool write_all(int fd, const void *data, size_t len) {
+	const char *p = (const char *) data;
+	ssize_t n;
+	while (len) {
+		if ((n = write(fd, p, len)) < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static FlightRecorder *installed = NULL;	//< 由Install()指定的记录器
+
+static void crash_handler(int sig) {
+	const char *reason = sig == SIGSEGV ? "segv" : (sig == SIGBUS ? "bus"
+			: (sig == SIGFPE ? "fpe" : (sig == SIGILL ? "ill" : "abort")));
+	if (installed) installed->Dump(reason);
+	raise(sig);	// 已恢复缺省处理
+}
+
+FlightRecorder::FlightRecorder() {
+	ring_.reset(new fr_event[FR_SLOTS]);
+	memset(ring_.get(), 0, sizeof(fr_event) * FR_SLOTS);
+	next_      = 1;
+	dumping_   = false;
+	lastfault_ = 0;
+	faultpend_ = false;
+	strncpy(dirname_, gLogDir, sizeof(dirname_) - 1);
+	dirname_[sizeof(dirname_) - 1] = 0;
+}
+
+FlightRecorder::~FlightRecorder() {
+	if (thrddump_) {
+		thrddump_->interrupt();
+		thrddump_->join();
+		thrddump_.reset();
+	}
+	if (faultpend_.exchange(false)) Dump("fault");
+}
+
+void FlightRecorder::Record(const FR_EVENT type, int32_t p1, int64_t p2, int64_t p3, const char *text) {
+	uint64_t seq = next_.fetch_add(1, boost::memory_order_relaxed);
+	fr_event &e = ring_[(seq - 1) & (FR_SLOTS - 1)];
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	// 写入期间序号为0, 写入完成后设置序号
+	__atomic_store_n(&e.seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	e.usec = int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+	e.type = uint16_t(type);
+	e.rsv  = 0;
+	e.p1   = p1;
+	e.p2   = p2;
+	e.p3   = p3;
+	if (text) {
+		strncpy(e.text, text, FR_TEXT - 1);
+		e.text[FR_TEXT - 1] = 0;
+	}
+	else e.text[0] = 0;
+	__atomic_store_n(&e.seq, seq, __ATOMIC_RELEASE);
+}
+
+int FlightRecorder::Dump(const char *reason) {
+	if (dumping_.exchange(true)) return EBUSY;
+
+	char path[400], *p = path, *end = path + sizeof(path) - 1;
+	fr_head head;
+	int fd, rslt(0);
+
+	append_str(p, end, dirname_);
+	append_str(p, end, "/");
+	append_str(p, end, gLogPrefix);
+	append_str(p, end, "flight_");
+	append_uint(p, end, uint64_t(time(NULL)));
+	append_str(p, end, "_");
+	append_str(p, end, reason);
+	append_str(p, end, ".bin");
+	*p = 0;
+
+	memset(&head, 0, sizeof(head));
+	memcpy(head.magic, FR_MAGIC, 8);
+	head.size  = sizeof(fr_event);
+	head.count = FR_SLOTS;
+	head.next  = next_.load();
+	strncpy(head.reason, reason, sizeof(head.reason) - 1);
+
+	if ((fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0644)) < 0) rslt = errno;
+	else {
+		fr_event batch[FR_DUMP_BATCH];
+		uint64_t seq;
+		int i, j;
+
+		if (!write_all(fd, &head, sizeof(head))) rslt = errno;
+		for (i = 0; !rslt && i < FR_SLOTS; i += FR_DUMP_BATCH) {
+			for (j = 0; j < FR_DUMP_BATCH; ++j) {// 复制后序号改变, 说明复制期间事件被改写
+				const fr_event &e = ring_[i + j];
+				seq = __atomic_load_n(&e.seq, __ATOMIC_ACQUIRE);
+				memcpy(&batch[j], &e, sizeof(fr_event));
+				__atomic_thread_fence(__ATOMIC_ACQUIRE);
+				if (__atomic_load_n(&e.seq, __ATOMIC_RELAXED) != seq) batch[j].seq = 0;
+			}
+			if (!write_all(fd, batch, sizeof(batch))) rslt = errno;
+		}
+		close(fd);
+	}
+	dumping_ = false;
+
+	return rslt;
+}
+
+void FlightRecorder::Install() {
+	struct sigaction act;
+	int signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+	installed = this;
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = crash_handler;
+	act.sa_flags   = SA_RESETHAND;
+	sigemptyset(&act.sa_mask);
+	for (size_t i = 0; i < sizeof(signals) / sizeof(int); ++i) sigaction(signals[i], &act, NULL);
+	if (!thrddump_) thrddump_.reset(new boost::thread(boost::bind(&FlightRecorder::thread_dump, this)));
+}
+
+void FlightRecorder::thread_dump() {
+	boost::chrono::milliseconds period(FR_DUMP_PERIOD);
+
+	while (1) {
+		boost::this_thread::sleep_for(period);
+		if (faultpend_.exchange(false)) Dump("fault");
+	}
+}
+
+void FlightRecorder::OnFault() {
+	FlightRecorder *recorder = installed;
+	if (!recorder) return;
+
+	int64_t now = time(NULL);
+	int64_t last = recorder->lastfault_.exchange(now);
+
+	recorder->Record(FRE_FAULT);
+	if (now - last >= FR_FAULT_PERIOD) recorder->faultpend_ = true;	// 由后台线程写入文件
+}
+
+int FlightRecorder::Render(const fr_event &e, char *out, int size) {
+	const char *peer = e.p1 == 0 ? "CLIENT" : "DOME";
+	int n(0);
+
+	switch (e.type) {
+	case FRE_START:
+		n = snprintf(out, size, "service started");
+		break;
+	case FRE_ACCEPT:
+		n = snprintf(out, size, "accept %s from %u.%u.%u.%u:%d", peer,
+				unsigned(e.p2 >> 24) & 0xFF, unsigned(e.p2 >> 16) & 0xFF, unsigned(e.p2 >> 8) & 0xFF,
+				unsigned(e.p2) & 0xFF, int(e.p3));
+		break;
+	case FRE_CLOSE:
+		n = snprintf(out, size, "close %s[%s]", peer, e.text);
+		break;
+	case FRE_COMMAND:
+		n = snprintf(out, size, "%s sent <%s> command=%d state=%d", peer, e.text, int(e.p2), int(e.p3));
+		break;
+	case FRE_STATE:
+		n = snprintf(out, size, "Dome[%s] state %d -> %d", e.text, e.p1, int(e.p2));
+		break;
+	case FRE_DECISION:
+		n = snprintf(out, size, "Dome[%s] wind %.2f m/s, count open=%d close=%d, command=%d", e.text,
+				e.p2 * 0.01, int(e.p3 >> 16), int(e.p3 & 0xFFFF), e.p1);
+		break;
+	case FRE_QUEUE:
+		n = snprintf(out, size, "message queue depth %d, posted %lld", e.p1, (long long) e.p2);
+		break;
+	case FRE_FAULT:
+		n = snprintf(out, size, "LOG_FAULT recorded");
+		break;
+	case FRE_ESCALATE:
+		n = snprintf(out, size, "Dome[%s] command=%d failed after %d retries, state=%d", e.text,
+				e.p1, int(e.p2), int(e.p3));
+		break;
+	default:
+		n = snprintf(out, size, "<unknown event %u>", e.type);
+		break;
+	}
+	return n < size ? n : size - 1;
+}
@@ -0,0 +1,133 @@
+/*
+ * @file FlightRecorder.h  类FlightRecorder声明文件
+ * @description  事件飞行记录器: 在内存中循环保存最近的关键事件, 出现问题时写入文件
+ * @version      0.1
+ * @date         2026年10月19日
+ * @note
+ * (1) 事件为固定长度的二进制记录, 保存在固定长度的环形队列中. 写入时以原子操作分配位置,
+ *     不加锁、不分配内存, 可始终启用
+ * (2) 队列满时覆盖最早的事件. 按FR_SLOTS与事件频度, 可保留最近数分钟至数小时的事件
+ * (3) 以下情况将队列写入日志目录下的文件annaes_flight_<UTC秒数>_<原因>.bin:
+ *     收到SIGUSR1; 此前FR_FAULT_PERIOD秒内无LOG_FAULT时记录LOG_FAULT类型日志; 进程崩溃.
+ *     持续出现的故障(例如气象文件长期未更新)只在首次出现时写入文件
+ * (4) 写入文件仅使用异步信号安全的系统调用, 可在信号处理函数中执行.
+ *     LOG_FAULT触发的写入由后台线程完成, 不阻塞记录日志的线程
+ * (5) 写入文件时逐个复制事件并复核序号(seqlock). 复制期间被改写的事件序号置0, 还原时被丢弃
+ * (6) 文件由glogdec还原为文本
+ */
+
+#ifndef FLIGHTRECORDER_H_
+#define FLIGHTRECORDER_H_
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#define FR_MAGIC		"GFLIGHT1"	//< 文件标志
+#define FR_SLOTS		8192		//< 环形队列容量, 须为2的幂且不小于FR_DUMP_BATCH
+#define FR_TEXT			24			//< 事件中文本的最大长度, 含结束符
+#define FR_FAULT_PERIOD	600			//< LOG_FAULT间隔不小于此值时写入文件, 量纲: 秒
+#define FR_DUMP_BATCH	64			//< 写入文件时每批复制的事件数量
+#define FR_DUMP_PERIOD	100			//< 后台线程检查待写入请求的周期, 量纲: 毫秒
+
+enum FR_EVENT {// 事件类型
+	FRE_NONE,		//< 空
+	FRE_START,		//< 启动服务
+	FRE_ACCEPT,		//< 建立网络连接. p1: 主机类型; p2: IPv4地址; p3: 端口
+	FRE_CLOSE,		//< 断开网络连接. p1: 主机类型; text: 组标志
+	FRE_COMMAND,	//< 解析通信协议. p1: 主机类型; p2: 指令; p3: 状态; text: 协议类型与组标志
+	FRE_STATE,		//< 天窗状态变化. p1: 原状态; p2: 新状态; text: 组标志
+	FRE_DECISION,	//< 自动开关判断. p1: 指令; p2: 风速, 量纲: 0.01米/秒; p3: 打开计数<<16 | 关闭计数; text: 组标志
+	FRE_QUEUE,		//< 消息队列深度. p1: 待处理消息数量; p2: 累计投递数量
+	FRE_FAULT,		//< 记录了LOG_FAULT日志
+	FRE_ESCALATE,	//< 天窗指令失败. p1: 指令; p2: 重发次数; p3: 天窗状态; text: 组标志
+	FRE_MAX
+};
+
+struct fr_event {// 事件, 长度与缓存行相同
+	uint64_t seq;	//< 序号. 0: 未写入或正在写入
+	int64_t usec;	//< 时标, 量纲: 微秒, 自1970年1月1日起(UTC)
+	uint16_t type;	//< 事件类型
+	uint16_t rsv;	//< 保留
+	int32_t p1;		//< 参数
+	int64_t p2;
+	int64_t p3;
+	char text[FR_TEXT];	//< 文本
+};
+
+struct fr_head {// 文件头
+	char magic[8];		//< 文件标志
+	uint32_t size;		//< 事件长度, 量纲: 字节
+	uint32_t count;		//< 事件数量
+	uint64_t next;		//< 下一个事件的序号
+	char reason[16];	//< 写入原因
+};
+
+class FlightRecorder {
+public:
+	FlightRecorder();
+	virtual ~FlightRecorder();
+
+protected:
+	boost::scoped_array<fr_event> ring_;	//< 环形队列
+	boost::atomic<uint64_t> next_;		//< 下一个事件的序号, 自1起
+	boost::atomic<bool> dumping_;		//< 正在写入文件
+	boost::atomic<int64_t> lastfault_;	//< 最近一次LOG_FAULT的时间, 量纲: 秒
+	boost::atomic<bool> faultpend_;		//< 等待后台线程写入文件的LOG_FAULT
+	boost::shared_ptr<boost::thread> thrddump_;	//< 后台写入线程
+	char dirname_[256];	//< 目录名
+
+protected:
+	/*!
+	 * @brief 后台线程: 周期检查并写入LOG_FAULT触发的文件
+	 */
+	void thread_dump();
+
+public:
+	/*!
+	 * @brief 记录一个事件
+	 * @param type 事件类型
+	 * @param p1   参数1
+	 * @param p2   参数2
+	 * @param p3   参数3
+	 * @param text 文本. 超长时被截断
+	 */
+	void Record(const FR_EVENT type, int32_t p1 = 0, int64_t p2 = 0, int64_t p3 = 0, const char *text = NULL);
+	/*!
+	 * @brief 将环形队列写入文件
+	 * @param reason 原因, 作为文件名的一部分
+	 * @return
+	 * 0: 成功; 其它: 错误代码
+	 * @note
+	 * 异步信号安全. 正在写入时直接返回
+	 */
+	int Dump(const char *reason);
+	/*!
+	 * @brief 安装崩溃信号(SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT)处理函数,
+	 *        并以该对象响应OnFault(); 启动后台写入线程
+	 * @note
+	 * 处理函数写入文件后恢复缺省处理, 并再次触发信号
+	 */
+	void Install();
+	/*!
+	 * @brief 记录LOG_FAULT事件. 与上一次LOG_FAULT间隔不小于FR_FAULT_PERIOD时写入文件
+	 * @note
+	 * 作为GLog的LOG_FAULT回调函数. 由Install()指定记录器.
+	 * 仅置位请求标志, 由后台线程写入文件
+	 */
+	static void OnFault();
+	/*!
+	 * @brief 将事件还原为文本, 不含时标
+	 * @param event 事件
+	 * @param out   输出缓冲区
+	 * @param size  输出缓冲区长度
+	 * @return
+	 * 输出文本长度
+	 */
+	static int Render(const fr_event &event, char *out, int size);
+};
+
+extern FlightRecorder _gRecorder;	//< 事件飞行记录器
+
+#endif /* FLIGHTRECORDER_H_ */
@@ -6,11 +6,17 @@
 
 #include <sys/stat.h>
 #include <sys/types.h>	// Linux需要
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <unistd.h>
-#include <stdarg.h>
+#include <fcntl.h>
+#include <zlib.h>
+#include <time.h>
+#include <string.h>
 #include <string>
 #include <boost/filesystem/path.hpp>
 #include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
 #include "GLog.h"
 #include "globaldef.h"
@@ -18,85 +24,739 @@
 using std::string;
 using namespace boost::posix_time;
 
+#define GLOG_FORMATS	1024	//< 结构化日志格式的最大数量
+
+static int64_t monotonic_usec() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+GLogLimit::GLogLimit(double rate, int burst) {
+	interval_  = int64_t(1E6 / rate);
+	tolerance_ = interval_ * (burst > 1 ? burst - 1 : 0);
+	tat_       = 0;
+	limited_   = 0;
+}
+
+int GLogLimit::Allow() {
+	int64_t now = monotonic_usec();
+	int64_t tat = tat_.load(boost::memory_order_relaxed);
+	int64_t t;
+
+	do {
+		t = tat > now ? tat : now;
+		if (t - now > tolerance_) {// 令牌已耗尽
+			++limited_;
+			return -1;
+		}
+	} while (!tat_.compare_exchange_weak(tat, t + interval_, boost::memory_order_relaxed));
+
+	return limited_.exchange(0);
+}
+
 GLog::GLog(FILE *out) {
-	day_ = -1;
-	fd_  = out;
+	files_[FILE_TEXT].fd = out;
 	dirname_ = gLogDir;
 	prefix_  = gLogPrefix;
+	init();
 }
 
 GLog::GLog(const char* dirname, const char* prefix) {
-	day_ = -1;
-	fd_  = NULL;
 	dirname_ = dirname;
 	prefix_  = prefix;
+	init();
 }
 
 GLog::~GLog() {
-	if (fd_ && fd_ != stdout && fd_ != stderr) fclose(fd_);
-}
-
-bool GLog::valid_file(ptime &t) {
-	if (fd_ == stdout || fd_ == stderr) return true;
-	ptime::date_type date = t.date();
-	if (day_ != date.day()) {// 日期变更
-		day_ = date.day();
-		if (fd_) {// 关闭已打开的日志文件
-			fprintf(fd_, "%s continue\n", string(69, '>').c_str());
-			fclose(fd_);
-			fd_ = NULL;
+	EnableAsync(false);
+	{// 记录尚未写入的重复次数
+		mutex_lock lock(mtx_);
+		for (int i = 0; i < FILE_COUNT; ++i) {
+			if (files_[i].repeat) {
+				append_repeat(i, files_[i].batchdate);
+				write_batch(i);
+			}
 		}
 	}
+	for (int i = 0; i < FILE_COUNT; ++i) close_file(i, false);
+	// 等待后台线程完成压缩
+	{
+		mutex_lock lock(mtxzip_);
+		zipstop_ = true;
+		cvzip_.notify_one();
+	}
+	if (thrdzip_) thrdzip_->join();
+}
+
+void GLog::init() {
+	files_[FILE_TEXT].ext = ".log";
+	files_[FILE_BINARY].ext = ".bin";
+	formats_.reserve(GLOG_FORMATS);
+	ndef_    = 0;
+	async_   = false;
+	head_    = 0;
+	tail_    = 0;
+	dropped_ = 0;
+	zipstop_ = false;
+	noverflow_ = 0;
+	nlimited_  = 0;
+	nrepeated_ = 0;
+	for (int i = 0; i < LOGC_MAX; ++i) levels_[i] = LEVEL_NORMAL;
+	hookfault_ = NULL;
+	idrepeat_  = Register(LOG_NORMAL, NULL, "last message repeated %u times");
+	idlimited_ = Register(LOG_NORMAL, NULL, "%u similar message(s) suppressed by rate limit");
+}
+
+bool GLog::to_terminal() {
+	FILE *fd = files_[FILE_TEXT].fd;
+	return (fd == stdout || fd == stderr);
+}
+
+string GLog::segment_path(int kind, int date, int segment) {
+	boost::filesystem::path path = dirname_;
+	boost::format fmt("%s%d%s%s");
+	string seg = segment ? "_" + boost::lexical_cast<string>(segment) : "";
+	fmt % prefix_.c_str() % date % seg.c_str() % files_[kind].ext.c_str();
+	path /= fmt.str();
+	return path.string();
+}
+
+void GLog::close_file(int kind, bool finished) {
+	log_file &file = files_[kind];
+	if (!file.fd || file.fd == stdout || file.fd == stderr) return;
+
+	if (kind == FILE_TEXT) file.size += fprintf(file.fd, "%s continue\n", string(69, '>').c_str());
+	fflush(file.fd);
+	if (ftruncate(fileno(file.fd), file.size)) {}	// 释放预分配但未使用的空间
+	fclose(file.fd);
+	file.fd = NULL;
+
+	if (finished) {// 已完成的文件交由后台线程压缩
+		mutex_lock lock(mtxzip_);
+		tozip_.push_back(file.path);
+		if (!thrdzip_) thrdzip_.reset(new boost::thread(boost::bind(&GLog::thread_compress, this)));
+		cvzip_.notify_one();
+	}
+}
 
-	if (fd_ == NULL) {
+bool GLog::valid_file(int kind, int date) {
+	log_file &file = files_[kind];
+	if (file.fd == stdout || file.fd == stderr) return true;
+	if (file.date != date) {// 日期变更
+		close_file(kind, file.date >= 0);
+		file.date = date;
+		file.segment = 0;
+	}
+	else if (file.fd && file.size >= GLOG_SEGMENT) {// 文件长度超限
+		close_file(kind, true);
+		++file.segment;
+	}
+
+	if (file.fd == NULL) {
 		if (access(dirname_.c_str(), F_OK)) mkdir(dirname_.c_str(), 0755);	// 创建目录
 		if (!access(dirname_.c_str(), W_OK | X_OK)) {
-			boost::filesystem::path path = dirname_;
-			boost::format fmt("%s%s.log");
-			fmt % prefix_.c_str() % to_iso_string(date).c_str();
-			path /= fmt.str();
-			fd_ = fopen(path.c_str(), "a+");
-			fprintf(fd_, "%s\n", string(79, '-').c_str());
+			struct stat st;
+			// 跳过已压缩或已写满的分段
+			while (true) {
+				file.path = segment_path(kind, date, file.segment);
+				if (!access((file.path + ".gz").c_str(), F_OK)
+						|| (!stat(file.path.c_str(), &st) && st.st_size >= GLOG_SEGMENT)) ++file.segment;
+				else break;
+			}
+
+			if ((file.fd = fopen(file.path.c_str(), "a+")) != NULL) {
+				fseek(file.fd, 0, SEEK_END);
+				file.size = ftell(file.fd);
+#ifdef __linux__
+				// 预分配磁盘空间但不改变文件长度, 避免写入时逐次分配数据块
+				if (file.size < GLOG_SEGMENT)
+					fallocate(fileno(file.fd), FALLOC_FL_KEEP_SIZE, file.size, GLOG_SEGMENT - file.size);
+#endif
+				if (kind == FILE_TEXT) file.size += fprintf(file.fd, "%s\n", string(79, '-').c_str());
+				else {// 新文件写入文件标志. 格式编号仅在本进程内有效, 因此每次打开文件时重写全部格式
+					if (file.size == 0) file.size += fwrite(GLOG_MAGIC, 1, 8, file.fd);
+					ndef_ = 0;
+				}
+				fflush(file.fd);
+			}
+		}
+	}
+
+	if (kind == FILE_BINARY && file.fd && ndef_ < formats_.size()) {// 补充格式定义
+		for (; ndef_ < formats_.size(); ++ndef_) {
+			log_format &def = formats_[ndef_];
+			uint16_t len = uint16_t(1 + 2 + 1 + def.where.size() + 1 + def.format.size() + 1);
+			uint16_t id  = uint16_t(ndef_);
+			uint8_t type = uint8_t(def.type);
+
+			fwrite(&len, 2, 1, file.fd);
+			fputc('F', file.fd);
+			fwrite(&id, 2, 1, file.fd);
+			fwrite(&type, 1, 1, file.fd);
+			fwrite(def.where.c_str(), 1, def.where.size() + 1, file.fd);
+			fwrite(def.format.c_str(), 1, def.format.size() + 1, file.fd);
+			file.size += 2 + len;
+		}
+		fflush(file.fd);
+	}
+
+	return (file.fd != NULL);
+}
+
+void GLog::thread_compress() {
+#ifdef __linux__
+	setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);	// 最低优先级, 不与工作线程争用处理器
+#endif
+	string path;
+
+	while (true) {
+		{
+			mutex_lock lock(mtxzip_);
+			while (tozip_.empty() && !zipstop_) cvzip_.wait(lock);
+			if (tozip_.empty()) break;
+			path = tozip_.front();
+			tozip_.pop_front();
 		}
+		if (!compress(path)) Write(LOG_WARN, "GLog::compress", "failed to compress [%s]", path.c_str());
 	}
+}
+
+bool GLog::compress(const string& path) {
+	string pathzip = path + ".gz";
+	string pathtmp = pathzip + ".tmp";
+	FILE *fp = fopen(path.c_str(), "rb");
+	gzFile gz;
+	char buff[65536];
+	size_t n;
+	bool success(true);
 
-	return (fd_ != NULL);
+	if (!fp) return false;
+	if (!(gz = gzopen(pathtmp.c_str(), "wb"))) {
+		fclose(fp);
+		return false;
+	}
+	while (success && (n = fread(buff, 1, sizeof(buff), fp)) > 0) {
+		success = gzwrite(gz, buff, n) == int(n);
+	}
+	fclose(fp);
+	success = gzclose(gz) == Z_OK && success;
+	// 压缩完成后再替换原文件, 避免中断时丢失日志
+	if (success) success = !rename(pathtmp.c_str(), pathzip.c_str()) && !unlink(path.c_str());
+	else unlink(pathtmp.c_str());
+
+	return success;
+}
+
+const char *GLog::local_stamp(time_t now, int& date) {
+	/* 每个线程缓存最近一秒的时标, 避免逐条调用localtime_r()和to_simple_string() */
+	static thread_local char stamp[16];
+	static thread_local time_t last = -1;
+	static thread_local int today = -1;
+
+	if (now != last) {
+		struct tm tmnow;
+		last = now;
+		localtime_r(&now, &tmnow);
+		today = (tmnow.tm_year + 1900) * 10000 + (tmnow.tm_mon + 1) * 100 + tmnow.tm_mday;
+		snprintf(stamp, sizeof(stamp), "%02d:%02d:%02d >> ", tmnow.tm_hour, tmnow.tm_min, tmnow.tm_sec);
+	}
+	date = today;
+
+	return stamp;
+}
+
+const char *GLog::format_line(const LOG_TYPE type, const char* where, const char* format, va_list vl,
+		int& len, int& date) {
+	static thread_local char buff[GLOG_LINE];
+	const char *stamp = local_stamp(time(NULL), date);
+	int n = strlen(stamp);
+
+	memcpy(buff, stamp, n);
+	n += snprintf(buff + n, GLOG_LINE - n, "%s", TypePrefix(type));
+	if (where) n += snprintf(buff + n, GLOG_LINE - n, "%s, ", where);
+	if (n < GLOG_LINE - 1) n += vsnprintf(buff + n, GLOG_LINE - n, format, vl);
+	if (n > GLOG_LINE - 2) n = GLOG_LINE - 2;	// 截断过长的日志
+	buff[n++] = '\n';
+	buff[n]   = 0;
+	len = n;
+
+	return buff;
+}
+
+void GLog::commit(const int kind, const LOG_TYPE type, const char *text, int len, int date) {
+	if (async_) {
+		if (!push(kind, text, len, date)) {
+			++dropped_;
+			++noverflow_;
+		}
+		if (type == LOG_FAULT) Flush();
+		else if (head_ - tail_ >= GLOG_SLOTS / 2) cvwake_.notify_one();
+	}
+	else {
+		mutex_lock lock(mtx_);
+		append(kind, text, len, date);
+		write_batch(kind);
+	}
+	if (type == LOG_FAULT) {
+		FaultHook hook = hookfault_.load(boost::memory_order_relaxed);
+		if (hook) (*hook)();
+	}
+}
+
+void GLog::append(const int kind, const char *text, int len, int date) {
+	log_file &file = files_[kind];
+	time_t now = time(NULL);
+	string key;
+
+	// 比较内容时排除时标: 文本日志以"hh:mm:ss >> "开始; 结构化日志比较格式编号与参数
+	if (kind == FILE_TEXT) key.assign(text + 12, len - 12);
+	else key.assign(text + 3, 2).append(text + GLOG_RECHEAD, len - GLOG_RECHEAD);
+	if (key == file.last) {// 保留时标, 使重复次数以最近一条重复日志的时间记录
+		if (kind == FILE_TEXT) file.stamp.assign(text, 12);
+		else file.stamp.assign(text + 5, 12);
+		++file.repeat;
+		++nrepeated_;
+		if (now - file.trepeat >= GLOG_REPEAT) append_repeat(kind, date);
+		return;
+	}
+	if (file.repeat) append_repeat(kind, date);
+	file.last.swap(key);
+	file.trepeat = now;
+
+	if (date != file.batchdate || file.batch.size() + len > GLOG_BATCH) {
+		write_batch(kind);
+		file.batchdate = date;
+	}
+	file.batch.insert(file.batch.end(), text, text + len);
+}
+
+void GLog::append_repeat(const int kind, int date) {
+	log_file &file = files_[kind];
+	char buff[GLOG_LINE];
+	int len;
+
+	if (kind == FILE_TEXT) {
+		len = snprintf(buff, GLOG_LINE, "%slast message repeated %u times\n",
+				file.stamp.c_str(), file.repeat);
+	}
+	else {
+		struct timespec ts;
+		int64_t sec;
+		int32_t nsec;
+		char *p = buff + GLOG_RECHEAD, *end = buff + GLOG_LINE;
+
+		memcpy(&sec, file.stamp.data(), 8);
+		memcpy(&nsec, file.stamp.data() + 8, 4);
+		ts.tv_sec  = sec;
+		ts.tv_nsec = nsec;
+		put_arg(p, end, file.repeat);
+		len = int(p - buff);
+		fill_head(buff, len, idrepeat_, ts);
+	}
+	file.repeat  = 0;
+	file.trepeat = time(NULL);
+
+	if (date != file.batchdate || file.batch.size() + len > GLOG_BATCH) {
+		write_batch(kind);
+		file.batchdate = date;
+	}
+	file.batch.insert(file.batch.end(), buff, buff + len);
+}
+
+void GLog::fill_head(char *buff, int len, int id, const struct timespec& ts) {
+	uint16_t size = uint16_t(len - 2);
+	uint16_t fid  = uint16_t(id);
+	int64_t sec   = ts.tv_sec;
+	int32_t nsec  = ts.tv_nsec;
+
+	memcpy(buff, &size, 2);
+	buff[2] = 'E';
+	memcpy(buff + 3, &fid, 2);
+	memcpy(buff + 5, &sec, 8);
+	memcpy(buff + 13, &nsec, 4);
+}
+
+void GLog::commit_record(int id, char *buff, int len) {
+	if (id < 0) return;
+
+	struct timespec ts;
+	int date;
+	const char *stamp;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	stamp = local_stamp(ts.tv_sec, date);
+	const log_format &def = formats_[id];	// 格式注册后不再改变, 无需加锁
+
+	if (to_terminal()) {// 直接还原为文本
+		char text[GLOG_LINE];
+		int n = strlen(stamp);
+
+		memcpy(text, stamp, n);
+		n += snprintf(text + n, GLOG_LINE - n, "%s", TypePrefix(def.type));
+		if (!def.where.empty()) n += snprintf(text + n, GLOG_LINE - n, "%s, ", def.where.c_str());
+		if (n > GLOG_LINE - 2) n = GLOG_LINE - 2;	// 截断过长的日志
+		n += Render(def.format.c_str(), buff + GLOG_RECHEAD, len - GLOG_RECHEAD, text + n, GLOG_LINE - 1 - n);
+		text[n++] = '\n';
+		commit(FILE_TEXT, def.type, text, n, date);
+	}
+	else {
+		fill_head(buff, len, id, ts);
+		commit(FILE_BINARY, def.type, buff, len, date);
+	}
+}
+
+bool GLog::push(const int kind, const char *text, int len, int date) {
+	uint32_t pos = head_.load(boost::memory_order_relaxed);
+	log_slot *slot;
+
+	while (true) {
+		slot = &ring_[pos & (GLOG_SLOTS - 1)];
+		int32_t diff = int32_t(slot->seq.load(boost::memory_order_acquire) - pos);
+		if (diff == 0) {// 单元可写, 尝试占用
+			if (head_.compare_exchange_weak(pos, pos + 1, boost::memory_order_relaxed)) break;
+		}
+		else if (diff < 0) return false;	// 队列已满
+		else pos = head_.load(boost::memory_order_relaxed);
+	}
+	memcpy(slot->text, text, len);
+	slot->kind = kind;
+	slot->len  = len;
+	slot->date = date;
+	slot->seq.store(pos + 1, boost::memory_order_release);
+
+	return true;
+}
+
+void GLog::write_batch(int kind) {
+	log_file &file = files_[kind];
+	if (file.batch.empty()) return;
+	if (valid_file(kind, file.batchdate)) {
+		const char *p = &file.batch[0];
+		size_t n = file.batch.size();
+		ssize_t m;
+
+		while (n > 0 && (m = ::write(fileno(file.fd), p, n)) > 0) {
+			p += m;
+			n -= m;
+			file.size += m;
+		}
+	}
+	file.batch.clear();
+}
+
+void GLog::drain() {
+	if (!ring_) return;
+
+	uint32_t dropped = dropped_.exchange(0);
+	uint32_t pos = tail_.load(boost::memory_order_relaxed);
+	log_slot *slot;
+
+	while (true) {
+		slot = &ring_[pos & (GLOG_SLOTS - 1)];
+		if (slot->seq.load(boost::memory_order_acquire) != pos + 1) break;
+
+		append(slot->kind, slot->text, slot->len, slot->date);
+		slot->seq.store(pos + GLOG_SLOTS, boost::memory_order_release);
+		tail_.store(++pos, boost::memory_order_relaxed);
+	}
+	for (int i = 0; i < FILE_COUNT; ++i) write_batch(i);
+
+	if (dropped) {
+		boost::format fmt("%sWARN: GLog, %u message(s) dropped\n");
+		int date;
+		fmt % local_stamp(time(NULL), date) % dropped;
+		string text = fmt.str();
+		append(FILE_TEXT, text.c_str(), int(text.size()), date);
+		write_batch(FILE_TEXT);
+	}
+}
+
+void GLog::thread_write() {
+	boost::chrono::milliseconds period(GLOG_PERIOD);
+
+	while (async_) {
+		{
+			mutex_lock lock(mtxwake_);
+			cvwake_.wait_for(lock, period);
+		}
+		Flush();
+	}
+}
+
+void GLog::EnableAsync(bool enabled) {
+	if (enabled && !thrdwrite_) {
+		if (!ring_) {
+			ring_.reset(new log_slot[GLOG_SLOTS]);
+			for (uint32_t i = 0; i < GLOG_SLOTS; ++i) ring_[i].seq = i;
+			head_ = 0;
+			tail_ = 0;
+			for (int i = 0; i < FILE_COUNT; ++i) files_[i].batch.reserve(GLOG_BATCH);
+		}
+		async_ = true;
+		thrdwrite_.reset(new boost::thread(boost::bind(&GLog::thread_write, this)));
+	}
+	else if (!enabled && thrdwrite_) {
+		async_ = false;
+		cvwake_.notify_one();
+		thrdwrite_->join();
+		thrdwrite_.reset();
+		Flush();
+	}
+}
+
+void GLog::SetFaultHook(FaultHook hook) {
+	hookfault_ = hook;
+}
+
+void GLog::Flush() {
+	mutex_lock lock(mtx_);
+	drain();
+}
+
+void GLog::SetLevel(const LOG_CATEGORY cat, const LOG_LEVEL level) {
+	levels_[cat].store(level, boost::memory_order_relaxed);
+}
+
+LOG_LEVEL GLog::GetLevel(const LOG_CATEGORY cat) {
+	return LOG_LEVEL(levels_[cat].load(boost::memory_order_relaxed));
+}
+
+const char *GLog::TypePrefix(const int type) {
+	static const char *prefix[] = {"", "WARN: ", "ERROR: ", "DEBUG: ", "TRACE: "};
+	return type >= 0 && type <= LOG_TRACE ? prefix[type] : "";
+}
+
+const char *GLog::CategoryName(const int cat) {
+	static const char *name[] = {"Network", "Protocol", "Weather", "NTP", "Dome"};
+	return cat >= 0 && cat < LOGC_MAX ? name[cat] : "";
+}
+
+int GLog::LevelByName(const char *name) {
+	static const char *level[] = {"trace", "debug", "normal", "warn", "fault", "off"};
+	for (int i = LEVEL_TRACE; i <= LEVEL_OFF; ++i) {
+		if (boost::iequals(name, level[i])) return i;
+	}
+	return -1;
+}
+
+void GLog::Limited() {
+	++nlimited_;
+}
+
+void GLog::Suppressed(int n) {
+	Record(idlimited_, n);
+}
+
+void GLog::GetCounters(uint64_t& overflow, uint64_t& limited, uint64_t& repeated) {
+	overflow = noverflow_;
+	limited  = nlimited_;
+	repeated = nrepeated_;
+}
+
+int GLog::Register(const LOG_TYPE type, const char* where, const char* format) {
+	mutex_lock lock(mtx_);
+	if (formats_.size() >= GLOG_FORMATS) return -1;
+
+	log_format def;
+	def.type   = type;
+	def.where  = where ? where : "";
+	def.format = format;
+	formats_.push_back(def);
+
+	return int(formats_.size() - 1);
+}
+
+void GLog::put_arg(char*& p, char*& end, long long v) {
+	if (end - p < 9) end = p;	// 空间不足, 舍弃此后的全部参数
+	else {
+		*p = 'i';
+		memcpy(p + 1, &v, 8);
+		p += 9;
+	}
+}
+
+void GLog::put_arg(char*& p, char*& end, unsigned long long v) {
+	if (end - p < 9) end = p;
+	else {
+		*p = 'u';
+		memcpy(p + 1, &v, 8);
+		p += 9;
+	}
+}
+
+void GLog::put_arg(char*& p, char*& end, int v) {
+	if (end - p < 5) end = p;
+	else {
+		*p = 'I';
+		memcpy(p + 1, &v, 4);
+		p += 5;
+	}
+}
+
+void GLog::put_arg(char*& p, char*& end, unsigned v) {
+	if (end - p < 5) end = p;
+	else {
+		*p = 'U';
+		memcpy(p + 1, &v, 4);
+		p += 5;
+	}
+}
+
+void GLog::put_arg(char*& p, char*& end, double v) {
+	if (end - p < 9) end = p;
+	else {
+		*p = 'd';
+		memcpy(p + 1, &v, 8);
+		p += 9;
+	}
+}
+
+void GLog::put_arg(char*& p, char*& end, const char *v) {
+	if (end - p < 3) end = p;
+	else {
+		if (!v) v = "(null)";
+		size_t n = strlen(v);
+		if (n > size_t(end - p - 3)) n = end - p - 3;	// 截断字符串
+		uint16_t len = uint16_t(n);
+
+		*p = 's';
+		memcpy(p + 1, &len, 2);
+		memcpy(p + 3, v, n);
+		p += 3 + n;
+	}
+}
+
+int GLog::Render(const char *format, const char *args, int len, char *out, int size) {
+	const char *end = args + len;
+	char spec[32];
+	int n(0), m, k;
+
+	if (size <= 0) return 0;
+	while (*format && n < size - 1) {
+		if (*format != '%') {
+			out[n++] = *format++;
+			continue;
+		}
+		if (format[1] == '%') {
+			out[n++] = '%';
+			format += 2;
+			continue;
+		}
+
+		// 提取转换说明: 标志、宽度、精度. 长度修饰符仅用于确定整数的有效位数
+		int nh(0);
+		bool wide(false);
+		k = 0;
+		spec[k++] = *format++;
+		while (*format && strchr("-+ #0123456789.", *format) && k < 24) spec[k++] = *format++;
+		for (; *format && strchr("hlLqjzt", *format); ++format) {
+			if (*format == 'h') ++nh;
+			else wide = true;
+		}
+		char conv = *format;
+		if (!conv) break;
+		++format;
+		bool isfloat = strchr("eEfFgGaA", conv) != NULL;
+
+		m = 0;
+		if (args < end && (*args == 'i' || *args == 'u' || *args == 'd' || *args == 'I' || *args == 'U')
+				&& end - args >= (*args == 'I' || *args == 'U' ? 5 : 9)) {
+			char tag = *args;
+			long long vi;
+			unsigned long long vu;
+			double vd;
+
+			if (tag == 'I' || tag == 'U') {// 32位整数
+				int32_t v32;
+				memcpy(&v32, args + 1, 4);
+				args += 5;
+				vi = tag == 'I' ? (long long) v32 : (long long) uint32_t(v32);
+				vu = (unsigned long long) vi;
+				tag = tag == 'I' ? 'i' : 'u';
+			}
+			else {
+				memcpy(&vi, args + 1, 8);
+				memcpy(&vu, args + 1, 8);
+				memcpy(&vd, args + 1, 8);
+				args += 9;
+			}
+			if (tag == 'd') vi = (long long) vd, vu = (unsigned long long) vd;
+			else vd = tag == 'i' ? double(vi) : double(vu);
+			if (!isfloat && conv != 's' && !wide) {// 无l/ll等修饰符时, 与printf一致地截断为int/short/char
+				if (nh == 1)     vu = uint16_t(vu), vi = int16_t(vu);
+				else if (nh > 1) vu = uint8_t(vu),  vi = int8_t(vu);
+				else             vu = uint32_t(vu), vi = int32_t(vu);
+			}
+
+			if (isfloat) {
+				spec[k++] = conv;
+				spec[k] = 0;
+				m = snprintf(out + n, size - n, spec, vd);
+			}
+			else if (conv == 's') {
+				spec[k++] = 'l';
+				spec[k++] = 'l';
+				spec[k++] = tag == 'u' ? 'u' : 'd';
+				spec[k] = 0;
+				m = tag == 'u' ? snprintf(out + n, size - n, spec, vu) : snprintf(out + n, size - n, spec, vi);
+			}
+			else if (conv == 'c') {
+				spec[k++] = 'c';
+				spec[k] = 0;
+				m = snprintf(out + n, size - n, spec, int(vi));
+			}
+			else {
+				spec[k++] = 'l';
+				spec[k++] = 'l';
+				spec[k++] = conv;
+				spec[k] = 0;
+				m = strchr("ouxX", conv) ? snprintf(out + n, size - n, spec, vu)
+						: snprintf(out + n, size - n, spec, vi);
+			}
+		}
+		else if (args < end && *args == 's' && end - args >= 3) {
+			uint16_t slen;
+			memcpy(&slen, args + 1, 2);
+			if (slen > end - args - 3) slen = uint16_t(end - args - 3);
+			string str(args + 3, slen);
+			args += 3 + slen;
+
+			spec[k++] = 's';
+			spec[k] = 0;
+			m = snprintf(out + n, size - n, spec, str.c_str());
+		}
+		else m = snprintf(out + n, size - n, "?");	// 缺少参数
+		if (m > 0) n += m;
+	}
+	if (n > size - 1) n = size - 1;
+	out[n] = 0;
+
+	return n;
 }
 
 void GLog::Write(const char* format, ...) {
 	if (format == NULL) return;
 
-	mutex_lock lock(mtx_);
-	ptime t = second_clock::local_time();
+	const char *text;
+	int len, date;
 	va_list vl;
 
-	if (valid_file(t)) {
-		fprintf(fd_, "%s >> ", to_simple_string(t.time_of_day()).c_str());
-		va_start(vl, format);
-		vfprintf(fd_, format, vl);
-		va_end(vl);
-		fprintf(fd_, "\n");
-		fflush(fd_);
-	}
+	va_start(vl, format);
+	text = format_line(LOG_NORMAL, NULL, format, vl, len, date);
+	va_end(vl);
+	commit(FILE_TEXT, LOG_NORMAL, text, len, date);
 }
 
 void GLog::Write(const LOG_TYPE type, const char* where, const char* format, ...) {
 	if (format == NULL) return;
 
-	mutex_lock lock(mtx_);
-	ptime t = second_clock::local_time();
+	const char *text;
+	int len, date;
 	va_list vl;
 
-	if (valid_file(t)) {
-		fprintf(fd_, "%s >> ", to_simple_string(t.time_of_day()).c_str());
-		if      (type == LOG_WARN)  fprintf(fd_, "WARN: ");
-		else if (type == LOG_FAULT) fprintf(fd_, "ERROR: ");
-		if (where) fprintf(fd_, "%s, ", where);
-		va_start(vl, format);
-		vfprintf(fd_, format, vl);
-		va_end(vl);
-		fprintf(fd_, "\n");
-		fflush(fd_);
-	}
+	va_start(vl, format);
+	text = format_line(type, where, format, vl, len, date);
+	va_end(vl);
+	commit(FILE_TEXT, type, text, len, date);
 }
-
@@ -6,23 +6,176 @@
  * @date         2016年10月28日
  * @note
  * 使用互斥锁管理文件写入操作, 将并行操作转换为串性操作, 避免日志混淆
+ *
+ * @version      2.1
+ * @date         2026年10月19日
+ * @note
+ * 异步模式:
+ * (1) 调用线程在线程局部缓冲区中格式化日志, 再以无锁方式压入环形队列, 不等待磁盘操作
+ * (2) 后台线程批量取出日志, 合并为一次write()写入文件
+ * (3) 队列长度固定. 队列满时丢弃日志并计数, 由后台线程在日志中记录丢弃数量
+ * (4) LOG_FAULT类型日志在调用线程中立即写入文件, 确保严重错误不因进程退出而丢失
+ * 结构化日志:
+ * (1) 调用位置以GLOG_RECORD注册静态格式编号, 此后仅以二进制写入编号、纳秒时标和原始参数,
+ *     不在调用线程中格式化文本
+ * (2) 二进制日志写入与文本日志同目录、扩展名为.bin的文件, 格式定义随文件写入, 由glogdec还原为文本
+ * (3) 日志输出至终端时, 直接还原为文本
+ * 限流与去重:
+ * (1) GLOG_RECORD在调用位置以令牌桶限制日志速率. 被限制的日志计数, 并在该位置下一条日志之后记录数量
+ * (2) 与上一条内容(不含时标)相同的日志不再写入, 仅计数. 内容变化或重复持续GLOG_REPEAT秒时,
+ *     记录"last message repeated N times"
+ * (3) 队列溢出、限流、去重的累计数量由GetCounters()查看
+ * 文件分段:
+ * (1) 日期变更或文件长度达到GLOG_SEGMENT时开始新的分段, 分段文件名为<前缀><日期>_<序号>.<扩展名>
+ * (2) 打开分段时以fallocate()预分配空间(不改变文件长度), 关闭时释放未使用的空间
+ * (3) 已完成的分段由最低优先级的后台线程以gzip格式压缩, 写入线程不等待压缩
+ * 子系统日志级别:
+ * (1) 日志按子系统(网络、协议、气象、NTP、圆顶)分类, 各类别的级别可在运行时调整,
+ *     检查级别仅需一次relaxed原子读取
+ * (2) 低于GLOG_MIN_LEVEL的GLOG_TRACE/GLOG_DEBUG在编译时被消除, 其参数不被求值
  */
 
 #ifndef GLOG_H_
 #define GLOG_H_
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <string>
+#include <vector>
+#include <deque>
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
 #include <boost/smart_ptr.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 using std::string;
 
+#define GLOG_LINE		512		//< 单条日志最大长度, 量纲: 字节
+#define GLOG_SLOTS		4096	//< 异步模式: 环形队列长度, 须为2的幂
+#define GLOG_BATCH		65536	//< 异步模式: 单次写入的最大长度, 量纲: 字节
+#define GLOG_PERIOD		100		//< 异步模式: 后台线程写入周期, 量纲: 毫秒
+#define GLOG_MAGIC		"GLOGBIN1"	//< 二进制日志文件标志
+#define GLOG_RECHEAD	17		//< 二进制日志记录头长度: 长度(2)+类型(1)+编号(2)+秒(8)+纳秒(4)
+#define GLOG_RATE		1.0		//< GLOG_RECORD缺省速率, 量纲: 条/秒
+#define GLOG_BURST		10		//< GLOG_RECORD缺省突发数量
+#define GLOG_REPEAT		600		//< 重复日志的计数周期, 量纲: 秒
+#define GLOG_SEGMENT	(16 * 1024 * 1024)	//< 单个分段的最大长度, 量纲: 字节
+#define GLOG_TRACE_RATE	1000	//< GLOG_TRACE/GLOG_DEBUG的速率与突发数量, 量纲: 条/秒
+
+#ifndef GLOG_MIN_LEVEL
+#define GLOG_MIN_LEVEL	1		//< 编译时保留的最低日志级别: 0 跟踪; 1 调试; 2 普通
+#endif
+
 enum LOG_TYPE {// 日志类型
 	LOG_NORMAL,	// 普通
 	LOG_WARN,	// 警告, 可以继续操作
-	LOG_FAULT	// 错误, 需清除错误再继续操作
+	LOG_FAULT,	// 错误, 需清除错误再继续操作
+	LOG_DEBUG,	// 调试
+	LOG_TRACE	// 跟踪
+};
+
+enum LOG_LEVEL {// 日志级别, 由低至高
+	LEVEL_TRACE,	// 跟踪
+	LEVEL_DEBUG,	// 调试
+	LEVEL_NORMAL,	// 普通
+	LEVEL_WARN,		// 警告
+	LEVEL_FAULT,	// 错误
+	LEVEL_OFF		// 关闭
+};
+
+enum LOG_CATEGORY {// 日志类别: 子系统
+	LOGC_NETWORK,	// 网络连接
+	LOGC_PROTOCOL,	// 通信协议
+	LOGC_WEATHER,	// 气象数据
+	LOGC_NTP,		// 时钟同步
+	LOGC_DOME,		// 圆顶与天窗
+	LOGC_MAX
+};
+
+/*!
+ * @brief 记录一条结构化日志. 首次执行时注册格式, 之后仅写入参数
+ * @param type   日志类型
+ * @param where  事件位置, 可为NULL
+ * @param format 日志描述的格式, 须为字符串常量
+ * @note
+ * 支持的参数类型: 整数、浮点数、字符串. 格式中不支持'*'宽度
+ * 速率限制为GLOG_RATE条/秒, 允许突发GLOG_BURST条
+ */
+#define GLOG_RECORD(type, where, format, ...) \
+	GLOG_RECORD_RATE(GLOG_RATE, GLOG_BURST, type, where, format, ##__VA_ARGS__)
+/*!
+ * @brief 以指定速率限制记录一条结构化日志
+ * @param rate  速率, 量纲: 条/秒
+ * @param burst 突发数量
+ */
+#define GLOG_RECORD_RATE(rate, burst, type, where, format, ...) do { \
+	static const int glog_id_ = _gLog.Register(type, where, format); \
+	static GLogLimit glog_limit_(rate, burst); \
+	int glog_n_ = glog_limit_.Allow(); \
+	if (glog_n_ < 0) _gLog.Limited(); \
+	else { \
+		_gLog.Record(glog_id_, ##__VA_ARGS__); \
+		if (glog_n_ > 0) _gLog.Suppressed(glog_n_); \
+	} \
+} while (0)
+
+/*!
+ * @brief 按类别的当前级别记录一条结构化日志
+ * @param cat 日志类别
+ */
+#define GLOG_RECORD_CAT(cat, type, where, format, ...) do { \
+	if (_gLog.Enabled(cat, type)) GLOG_RECORD(type, where, format, ##__VA_ARGS__); \
+} while (0)
+
+/*!
+ * @brief 跟踪与调试日志. 低于GLOG_MIN_LEVEL时编译为空语句
+ * @param cat 日志类别
+ */
+#if GLOG_MIN_LEVEL <= 0
+#define GLOG_TRACE(cat, where, format, ...) do { \
+	if (_gLog.Enabled(cat, LOG_TRACE)) \
+		GLOG_RECORD_RATE(GLOG_TRACE_RATE, GLOG_TRACE_RATE, LOG_TRACE, where, format, ##__VA_ARGS__); \
+} while (0)
+#else
+#define GLOG_TRACE(cat, where, format, ...) do {} while (0)
+#endif
+
+#if GLOG_MIN_LEVEL <= 1
+#define GLOG_DEBUG(cat, where, format, ...) do { \
+	if (_gLog.Enabled(cat, LOG_DEBUG)) \
+		GLOG_RECORD_RATE(GLOG_TRACE_RATE, GLOG_TRACE_RATE, LOG_DEBUG, where, format, ##__VA_ARGS__); \
+} while (0)
+#else
+#define GLOG_DEBUG(cat, where, format, ...) do {} while (0)
+#endif
+
+/*!
+ * @brief 调用位置的日志速率限制
+ * @note
+ * 令牌桶以GCRA(generic cell rate algorithm)形式实现: 仅维护一个理论到达时间, 以原子操作更新
+ */
+class GLogLimit {
+public:
+	/*!
+	 * @param rate  速率, 量纲: 条/秒
+	 * @param burst 突发数量
+	 */
+	GLogLimit(double rate, int burst);
+
+public:
+	/*!
+	 * @brief 检查是否允许记录一条日志
+	 * @return
+	 * <0: 不允许
+	 * >=0: 允许. 数值为上次允许之后被限制的日志数量
+	 */
+	int Allow();
+
+protected:
+	int64_t interval_;	//< 令牌间隔, 量纲: 微秒
+	int64_t tolerance_;	//< 允许的提前量, 量纲: 微秒
+	boost::atomic<int64_t> tat_;	//< 理论到达时间, 量纲: 微秒
+	boost::atomic<int> limited_;	//< 被限制的日志数量
 };
 
 class GLog {
@@ -31,16 +184,186 @@ public:
 	GLog(const char* dirname, const char* prefix);
 	virtual ~GLog();
 
+public:
+	typedef void (*FaultHook)();	//< 记录LOG_FAULT类型日志后的回调函数
+
 protected:
+	/* 数据类型 */
+	typedef boost::unique_lock<boost::mutex> mutex_lock; //< 基于boost::mutex的互斥锁
+	typedef boost::shared_ptr<boost::thread> threadptr;
+
+	enum {// 日志文件类型
+		FILE_TEXT,		//< 文本
+		FILE_BINARY,	//< 二进制
+		FILE_COUNT
+	};
+
+	struct log_file {// 日志文件
+		FILE *fd;			//< 文件描述符
+		int date;			//< 文件对应的本地日期, 格式: YYYYMMDD
+		int segment;		//< 分段序号
+		long size;			//< 文件长度, 量纲: 字节
+		string path;		//< 文件路径
+		string ext;			//< 扩展名
+		std::vector<char> batch;	//< 批量写入缓冲区
+		int batchdate;		//< 批量缓冲区中日志的日期
+		string last;		//< 上一条日志的内容, 不含时标
+		unsigned repeat;	//< 上一条日志的重复次数
+		time_t trepeat;		//< 开始重复计数的时间
+		string stamp;		//< 最近一条重复日志的时标. 文本日志: 时标文本; 结构化日志: 记录头中的秒与纳秒
+
+	public:
+		log_file() {
+			fd   = NULL;
+			date = -1;
+			segment = 0;
+			size = 0;
+			batchdate = -1;
+			repeat  = 0;
+			trepeat = 0;
+		}
+	};
+
+	struct log_format {// 结构化日志格式
+		LOG_TYPE type;	//< 日志类型
+		string where;	//< 事件位置
+		string format;	//< 格式
+	};
+
+	struct log_slot {// 环形队列单元
+		boost::atomic<uint32_t> seq;	//< 序号. 等于写入位置时可写, 等于写入位置+1时可读
+		int kind;			//< 日志文件类型
+		int date;			//< 本地日期, 格式: YYYYMMDD
+		int len;			//< 日志长度
+		char text[GLOG_LINE];	//< 日志
+	};
+
+protected:
+	/*!
+	 * @brief 初始化成员变量并注册内置格式
+	 */
+	void init();
 	/*!
 	 * @brief 检查日志文件有效性
-	 * @param t 本地时间
+	 * @param kind 日志文件类型
+	 * @param date 本地日期, 格式: YYYYMMDD
 	 * @return
 	 * 文件有效性. true: 可继续操作文件; false: 文件访问错误
 	 * @note
-	 * 当日期变更时, 需重新创建日志文件
+	 * 当日期变更时, 需重新创建日志文件. 二进制文件在写入记录前补充尚未写入的格式定义
+	 */
+	bool valid_file(int kind, int date);
+	/*!
+	 * @brief 查看分段文件路径
+	 */
+	string segment_path(int kind, int date, int segment);
+	/*!
+	 * @brief 关闭日志文件
+	 * @param finished 分段已完成, 交由后台线程压缩
+	 */
+	void close_file(int kind, bool finished);
+	/*!
+	 * @brief 后台压缩线程
+	 */
+	void thread_compress();
+	/*!
+	 * @brief 将文件压缩为.gz文件, 成功后删除原文件
+	 * @return
+	 * 压缩结果
+	 */
+	bool compress(const string& path);
+	/*!
+	 * @brief 日志是否输出至终端
+	 */
+	bool to_terminal();
+	/*!
+	 * @brief 查看本地时标
+	 * @param now  UTC秒数
+	 * @param date 本地日期, 格式: YYYYMMDD
+	 * @return
+	 * 时标字符串, 格式: "hh:mm:ss >> "
+	 */
+	const char *local_stamp(time_t now, int& date);
+	/*!
+	 * @brief 在线程局部缓冲区中格式化一条日志
+	 * @param type   日志类型
+	 * @param where  事件位置
+	 * @param format 日志描述的格式
+	 * @param vl     日志描述的内容
+	 * @param date   本地日期, 格式: YYYYMMDD
+	 * @return
+	 * 缓冲区地址. 日志以换行符结束, 长度存储在len中
+	 */
+	const char *format_line(const LOG_TYPE type, const char* where, const char* format, va_list vl,
+			int& len, int& date);
+	/*!
+	 * @brief 提交一条已格式化的日志
+	 */
+	void commit(const int kind, const LOG_TYPE type, const char *text, int len, int date);
+	/*!
+	 * @brief 将一条日志加入批量缓冲区. 与上一条日志内容相同时仅计数
+	 * @note
+	 * 调用者需持有mtx_
+	 */
+	void append(const int kind, const char *text, int len, int date);
+	/*!
+	 * @brief 记录上一条日志的重复次数
+	 * @note
+	 * 调用者需持有mtx_
+	 */
+	void append_repeat(const int kind, int date);
+	/*!
+	 * @brief 填写结构化日志的记录头
+	 */
+	static void fill_head(char *buff, int len, int id, const struct timespec& ts);
+	/*!
+	 * @brief 补充记录头并提交一条结构化日志
+	 * @param id   格式编号
+	 * @param buff 记录缓冲区, 参数自GLOG_RECHEAD处开始
+	 * @param len  记录长度
+	 */
+	void commit_record(int id, char *buff, int len);
+	/*!
+	 * @brief 异步模式: 将日志压入环形队列
+	 * @return
+	 * 队列已满时返回false
+	 */
+	bool push(const int kind, const char *text, int len, int date);
+	/*!
+	 * @brief 异步模式: 取出队列中的全部日志并写入文件
+	 * @note
+	 * 调用者需持有mtx_
+	 */
+	void drain();
+	/*!
+	 * @brief 将批量缓冲区写入文件
+	 */
+	void write_batch(int kind);
+	/*!
+	 * @brief 在结构化日志缓冲区中写入参数
+	 * @note
+	 * 参数以类型标志开始: 'I'/'U' 32位有/无符号整数, 'i'/'u' 64位有/无符号整数, 'd' 浮点数, 's' 字符串.
+	 * 缓冲区剩余空间不足时截断字符串, 或舍弃该参数及其后的全部参数
 	 */
-	bool valid_file(boost::posix_time::ptime &t);
+	static void put_arg(char*& p, char*& end, long long v);
+	static void put_arg(char*& p, char*& end, unsigned long long v);
+	static void put_arg(char*& p, char*& end, int v);
+	static void put_arg(char*& p, char*& end, unsigned v);
+	static void put_arg(char*& p, char*& end, double v);
+	static void put_arg(char*& p, char*& end, const char *v);
+	static void put_arg(char*& p, char*& end, const string& v) { put_arg(p, end, v.c_str()); }
+	static void put_arg(char*& p, char*& end, long v)          { put_arg(p, end, (long long) v); }
+	static void put_arg(char*& p, char*& end, unsigned long v) { put_arg(p, end, (unsigned long long) v); }
+	static void put_args(char*&, char*&) {}
+	template<typename T, typename... Rest>
+	static void put_args(char*& p, char*& end, const T& v, const Rest&... rest) {
+		put_arg(p, end, v);
+		put_args(p, end, rest...);
+	}
+	/*!
+	 * @brief 异步模式: 后台写入线程
+	 */
+	void thread_write();
 
 public:
 	/*!
@@ -55,19 +378,144 @@ public:
 	 * @param format  日志描述的格式和内容
 	 */
 	void Write(const LOG_TYPE type, const char* where, const char* format, ...);
-
-protected:
-	/* 数据类型 */
-	typedef boost::unique_lock<boost::mutex> mutex_lock; //< 基于boost::mutex的互斥锁
-	typedef boost::shared_ptr<boost::thread> threadptr;
+	/*!
+	 * @brief 注册结构化日志格式
+	 * @param type   日志类型
+	 * @param where  事件位置, 可为NULL
+	 * @param format 日志描述的格式
+	 * @return
+	 * 格式编号
+	 * @note
+	 * 通常由GLOG_RECORD在调用位置以静态变量注册
+	 */
+	int Register(const LOG_TYPE type, const char* where, const char* format);
+	/*!
+	 * @brief 记录一条结构化日志
+	 * @param id   由Register()获得的格式编号
+	 * @param args 参数
+	 */
+	template<typename... Args>
+	void Record(int id, const Args&... args) {
+		char buff[GLOG_LINE];
+		char *p = buff + GLOG_RECHEAD;
+		char *end = buff + GLOG_LINE;
+		put_args(p, end, args...);
+		commit_record(id, buff, int(p - buff));
+	}
+	/*!
+	 * @brief 检查类别的当前级别是否允许记录该类型日志
+	 * @param cat  日志类别
+	 * @param type 日志类型
+	 */
+	bool Enabled(const LOG_CATEGORY cat, const LOG_TYPE type) {
+		return levels_[cat].load(boost::memory_order_relaxed) <= LevelOf(type);
+	}
+	/*!
+	 * @brief 设置类别的日志级别
+	 * @param cat   日志类别
+	 * @param level 日志级别. 低于该级别的日志不被记录
+	 */
+	void SetLevel(const LOG_CATEGORY cat, const LOG_LEVEL level);
+	/*!
+	 * @brief 查看类别的日志级别
+	 */
+	LOG_LEVEL GetLevel(const LOG_CATEGORY cat);
+	/*!
+	 * @brief 查看日志类型对应的级别
+	 */
+	static LOG_LEVEL LevelOf(const LOG_TYPE type) {
+		return type == LOG_TRACE ? LEVEL_TRACE : (type == LOG_DEBUG ? LEVEL_DEBUG
+				: (type == LOG_WARN ? LEVEL_WARN : (type == LOG_FAULT ? LEVEL_FAULT : LEVEL_NORMAL)));
+	}
+	/*!
+	 * @brief 查看日志类型在文本中的前缀
+	 */
+	static const char *TypePrefix(const int type);
+	/*!
+	 * @brief 查看类别名称
+	 */
+	static const char *CategoryName(const int cat);
+	/*!
+	 * @brief 由名称查找日志级别
+	 * @param name 名称: trace, debug, normal, warn, fault, off. 不区分大小写
+	 * @return
+	 * 日志级别. 名称无效时返回-1
+	 */
+	static int LevelByName(const char *name);
+	/*!
+	 * @brief 记录一条被速率限制丢弃的日志
+	 */
+	void Limited();
+	/*!
+	 * @brief 在上一条结构化日志之后记录被速率限制的日志数量
+	 */
+	void Suppressed(int n);
+	/*!
+	 * @brief 查看累计丢弃的日志数量
+	 * @param overflow 异步模式队列溢出
+	 * @param limited  速率限制
+	 * @param repeated 重复内容
+	 */
+	void GetCounters(uint64_t& overflow, uint64_t& limited, uint64_t& repeated);
+	/*!
+	 * @brief 将结构化日志的参数按格式还原为文本
+	 * @param format 格式
+	 * @param args   参数起始地址
+	 * @param len    参数长度
+	 * @param out    输出缓冲区
+	 * @param size   输出缓冲区长度
+	 * @return
+	 * 输出文本长度
+	 */
+	static int Render(const char *format, const char *args, int len, char *out, int size);
+	/*!
+	 * @brief 启用或禁止异步模式
+	 * @param enabled 启用标志. 禁止时写入队列中的全部日志
+	 * @note
+	 * 守护进程需在fork()之后启用异步模式
+	 */
+	void EnableAsync(bool enabled = true);
+	/*!
+	 * @brief 将队列中的全部日志写入文件
+	 */
+	void Flush();
+	/*!
+	 * @brief 设置LOG_FAULT回调函数
+	 * @param hook 回调函数. 在记录日志的线程中调用. NULL表示不回调
+	 */
+	void SetFaultHook(FaultHook hook);
 
 protected:
 	/* 成员变量 */
 	boost::mutex mtx_;	//< 互斥区
-	int  day_;			//< UTC日期
-	FILE *fd_;			//< 日志文件描述符
+	log_file files_[FILE_COUNT];	//< 日志文件
 	string dirname_;	//< 目录名
 	string prefix_;		//< 文件名前缀
+	std::vector<log_format> formats_;	//< 结构化日志格式
+	size_t ndef_;		//< 已写入当前二进制文件的格式数量
+	/* 异步模式 */
+	boost::atomic<bool> async_;		//< 异步模式标志
+	boost::scoped_array<log_slot> ring_;	//< 环形队列
+	boost::atomic<uint32_t> head_;	//< 队列写入位置
+	boost::atomic<uint32_t> tail_;	//< 队列读取位置. 仅在持有mtx_时修改
+	boost::atomic<uint32_t> dropped_;	//< 因队列满而丢弃的日志数量, 写入日志后清零
+	/* 限流与去重 */
+	int idrepeat_;		//< 内置格式: 重复次数
+	int idlimited_;		//< 内置格式: 速率限制
+	boost::atomic<uint64_t> noverflow_;	//< 累计数量: 队列溢出
+	boost::atomic<uint64_t> nlimited_;	//< 累计数量: 速率限制
+	boost::atomic<uint64_t> nrepeated_;	//< 累计数量: 重复内容
+	boost::atomic<int> levels_[LOGC_MAX];	//< 各类别的日志级别
+	boost::atomic<FaultHook> hookfault_;	//< LOG_FAULT回调函数
+	boost::mutex mtxwake_;			//< 互斥区: 唤醒后台线程
+	boost::condition_variable cvwake_;	//< 条件变量: 唤醒后台线程
+	threadptr thrdwrite_;			//< 后台写入线程
+	/* 分段压缩 */
+	std::deque<string> tozip_;		//< 待压缩的文件
+	bool zipstop_;					//< 停止压缩线程
+	boost::mutex mtxzip_;			//< 互斥区: 待压缩的文件
+	boost::condition_variable cvzip_;	//< 条件变量: 待压缩的文件
+	threadptr thrdzip_;				//< 后台压缩线程
 };
 
 extern GLog _gLog;		//< 工作日志
@@ -4,36 +4,67 @@
  * @version 0.1
  */
 
+#include <sys/stat.h>
+#include <time.h>
 #include <boost/make_shared.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include "GeneralControl.h"
 #include "GLog.h"
+#include "FlightRecorder.h"
 #include "globaldef.h"
 #include "ADefine.h"
 
 using namespace boost;
 using namespace AstroUtil;
 
+/* 文件修改时间. macOS的stat中对应成员名为st_mtimespec */
+static inline struct timespec file_mtime(const struct stat& st) {
+#ifdef __APPLE__
+	return st.st_mtimespec;
+#else
+	return st.st_mtim;
+#endif
+}
+
 GeneralControl::GeneralControl() {
 	bufrcv_.reset(new char[TCP_PACK_SIZE]);
 	ascproto_ = boost::make_shared<AsciiProtocol>();
 	param_    = boost::make_shared<Parameter>();
+	traces_.set_capacity(64);
+	idtrace_  = 0;
+	verdome_  = 1;
+	versnap_  = 0;
+	register_metrics();
+	const TimerWheel::CBSlot& slot = boost::bind(&GeneralControl::idle_expired, this, _1);
+	wheel_.RegisterExpire(slot);
 }
 
 GeneralControl::~GeneralControl() {
-
+	conncollect_.disconnect();
 }
 
 //////////////////////////////////////////////////////////////////////////////
 bool GeneralControl::StartService() {
-	if (!param_->LoadFile(gConfigPath)) {
+	ParamPtr param = param_;	// 工作线程启动前尚无并发访问
+
+	if (!param->LoadFile(gConfigPath)) {
 		_gLog.Write(LOG_FAULT, NULL, "failed to access configuration file[%s]", gConfigPath);
 		return false;
 	}
 
-	ats_.SetSite(param_->siteLon, param_->siteLat, param_->siteAlt, param_->timezone);
-	if (1 <= param_->openWindOpt && param_->openWindOpt <= 3 && 1 <= param_->cloWindOpt && param_->cloWindOpt <= 3)
+	_gRecorder.Record(FRE_START);
+	apply_log_level(param);
+	{
+		mutex_lock lck(mtx_ats_);
+		ats_.SetSite(param->siteLon, param->siteLat, param->siteAlt, param->timezone);
+	}
+	load_leap_second(param->pathLeapSecond);
+	load_almanac(param->pathAlmanac, param);
+	if (1 <= param->openWindOpt && param->openWindOpt <= 3 && 1 <= param->cloWindOpt && param->cloWindOpt <= 3) {
 		thrd_weather_.reset(new boost::thread(boost::bind(&GeneralControl::thread_weather, this)));
+		thrd_emergency_.reset(new boost::thread(boost::bind(&GeneralControl::thread_emergency, this)));
+	}
 	else {
 		_gLog.Write(LOG_FAULT, NULL, "UseWindSpd option of SlitOpen or SlitClose was wrong");
 		return false;
@@ -44,8 +75,16 @@ bool GeneralControl::StartService() {
 	name += DAEMON_NAME;
 	if (!Start(name.c_str())) return false;
 	if (!create_all_server()) return false;
-	if (param_->ntpEnable) {
-		ntp_ = make_ntp(param_->ntpHost.c_str(), 123, param_->ntpMaxDiff);
+	if (param->metricsEnable) {
+		int ec = _gMetrics.StartServer(param->metricsAddress, param->metricsPort);
+		if (ec) {
+			_gLog.Write(LOG_WARN, NULL, "failed to serve metrics on <%s:%d>. ErrorCode<%d>",
+					param->metricsAddress.c_str(), param->metricsPort, ec);
+		}
+	}
+	if (param->ntpEnable) {
+		ntp_ = make_ntp(param->ntpHost.c_str(), 123, param->ntpMaxDiff);
+		ntp_->EnableDiscipline(param->ntpDiscipline, param->ntpPanic);
 		ntp_->EnableAutoSynch(true);
 	}
 
@@ -53,8 +92,16 @@ bool GeneralControl::StartService() {
 }
 
 void GeneralControl::StopService() {
+	// 先停止网络服务, 避免析构期间仍回调network_accept()
+	if (tcps_client_.use_count()) tcps_client_->Stop();
+	if (tcps_dome_.use_count())   tcps_dome_->Stop();
+	_gMetrics.StopServer();
+	conncollect_.disconnect();
 	Stop();
 	interrupt_thread(thrd_weather_);
+	interrupt_thread(thrd_emergency_);
+	wheel_.Stop();
+	keep_.stop();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -63,11 +110,15 @@ void GeneralControl::register_messages() {
 	const CBSlot& slot12 = boost::bind(&GeneralControl::on_receive_dome,    this, _1, _2);
 	const CBSlot& slot21 = boost::bind(&GeneralControl::on_close_client,    this, _1, _2);
 	const CBSlot& slot22 = boost::bind(&GeneralControl::on_close_dome,      this, _1, _2);
+	const CBSlot& slot31 = boost::bind(&GeneralControl::on_slit_timeout,    this, _1, _2);
+	const CBSlot& slot32 = boost::bind(&GeneralControl::on_idle_timeout,    this, _1, _2);
 
 	RegisterMessage(MSG_RECEIVE_CLIENT,  slot11);
 	RegisterMessage(MSG_RECEIVE_DOME,    slot12);
 	RegisterMessage(MSG_CLOSE_CLIENT,    slot21);
 	RegisterMessage(MSG_CLOSE_DOME,      slot22);
+	RegisterMessage(MSG_SLIT_TIMEOUT,    slot31);
+	RegisterMessage(MSG_IDLE_TIMEOUT,    slot32);
 }
 
 void GeneralControl::on_receive_client(const long param1, const long param2) {
@@ -79,21 +130,36 @@ void GeneralControl::on_receive_dome(const long param1, const long param2) {
 }
 
 void GeneralControl::on_close_client(const long param1, const long param2) {
-	mutex_lock lck(mtx_tcpc_client_);
+	MetricTimedLock lck(mtx_tcpc_client_, mlockclient_);
 	TCPClient* ptr = (TCPClient*) param1;
 	TcpCVec::iterator it;
 
 	for (it = tcpc_client_.begin(); it != tcpc_client_.end() && ptr != (*it).get(); ++it);
 	if (it != tcpc_client_.end()) tcpc_client_.erase(it);
+	for (SubscriberVec::iterator its = subscribers_.begin(); its != subscribers_.end(); ++its) {
+		if (ptr == (*its).tcp.get()) {
+			subscribers_.erase(its);
+			break;
+		}
+	}
+	_gRecorder.Record(FRE_CLOSE, PEER_CLIENT);
 }
 
 void GeneralControl::on_close_dome(const long param1, const long param2) {
-	mutex_lock lck(mtx_tcpc_dome_);
+	MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
 	TCPClient* ptr = (TCPClient*) param1;
 	DomeNetVec::iterator it;
 
 	for (it = tcpc_dome_.begin(); it != tcpc_dome_.end() && ptr != (*it).tcp.get(); ++it);
-	if (it != tcpc_dome_.end()) tcpc_dome_.erase(it);
+	if (it != tcpc_dome_.end()) {
+		_gRecorder.Record(FRE_CLOSE, PEER_DOME, 0, 0, (*it).gid.c_str());
+		if ((*it).tmcmd.use_count()) {
+			boost::system::error_code ec;
+			(*it).tmcmd->cancel(ec);
+		}
+		tcpc_dome_.erase(it);
+		++verdome_;
+	}
 }
 
 /*!
@@ -111,19 +177,32 @@ void GeneralControl::resolve_protocol_ascii(TCPClient* client, int peer) {
 	while (client->IsOpen() && (pos = client->Lookup(term, len)) >= 0) {
 		if ((toread = pos + len) > TCP_PACK_SIZE) {
 			string ip = client->GetSocket().remote_endpoint().address().to_string();
-			_gLog.Write(LOG_FAULT, "GeneralControl::receive_protocol_ascii",
-					"too long message from IP<%s>. peer type is %s", ip.c_str(),
+			GLOG_RECORD_CAT(LOGC_PROTOCOL, LOG_FAULT, "GeneralControl::receive_protocol_ascii",
+					"too long message from IP<%s>. peer type is %s", ip,
 					peer == PEER_CLIENT ? "CLIENT" : "DOME");
 			client->Close();
 		}
 		else {// 读取协议内容并解析执行
 			client->Read(bufrcv_.get(), toread);
 			bufrcv_[pos] = 0;
+			arm_idle(client, peer);
+			GLOG_TRACE(LOGC_PROTOCOL, "GeneralControl::resolve_protocol_ascii", "%s<%s>",
+					peer == PEER_CLIENT ? "CLIENT" : "DOME", bufrcv_.get());
 
 			proto = ascproto_->Resolve(bufrcv_.get());
+			if (proto.use_count()) {
+				string what = proto->type + " " + proto->gid;
+				int cmd(-1), state(-1);
+				if (iequals(proto->type, APTYPE_SLIT)) {
+					apslit slit = from_apbase<ascii_proto_slit>(proto);
+					cmd   = slit->command;
+					state = slit->state;
+				}
+				_gRecorder.Record(FRE_COMMAND, peer, cmd, state, what.c_str());
+			}
 			// 检查: 协议有效性及设备标志基本有效性
 			if (!proto.use_count()) {
-				_gLog.Write(LOG_FAULT, "GeneralControl::receive_protocol_ascii",
+				GLOG_RECORD_CAT(LOGC_PROTOCOL, LOG_FAULT, "GeneralControl::receive_protocol_ascii",
 						"illegal protocol[%s]", bufrcv_.get());
 				client->Close();
 			}
@@ -141,47 +220,75 @@ void GeneralControl::process_protocol_client(apbase proto, TCPClient* client) {
 		ParamPtr param = boost::make_shared<Parameter>();
 		param->LoadFile(gConfigPath);
 
-		ats_.SetSite(param->siteLon, param->siteLat, param->siteAlt, param->timezone);
+		apply_log_level(param);
+		{
+			mutex_lock lck(mtx_ats_);
+			ats_.SetSite(param->siteLon, param->siteLat, param->siteAlt, param->timezone);
+		}
+		load_leap_second(param->pathLeapSecond);
+		load_almanac(param->pathAlmanac, param);
+
+		// 先更新参数访问地址, 再重启线程, 使新线程读取新的气象数据文件
+		ParamPtr old = get_param();
+		set_param(param);
 		if (1 <= param->openWindOpt && param->openWindOpt <= 3 && 1 <= param->cloWindOpt && param->cloWindOpt <= 3) {
-			if (!iequals(param_->pathWeather, param->pathWeather)) {
+			if (!iequals(old->pathWeather, param->pathWeather)) {
 				interrupt_thread(thrd_weather_);
 				thrd_weather_.reset(new boost::thread(boost::bind(&GeneralControl::thread_weather, this)));
+				interrupt_thread(thrd_emergency_);
+				thrd_emergency_.reset(new boost::thread(boost::bind(&GeneralControl::thread_emergency, this)));
 			}
 		}
 		else {
 			_gLog.Write(LOG_FAULT, NULL, "UseWindSpd option of SlitOpen or SlitClose was wrong");
 			interrupt_thread(thrd_weather_);
+			interrupt_thread(thrd_emergency_);
 		}
-
-		// 更新参数访问地址
-		param_ = param;
 	}
 	else if (iequals(type, APTYPE_SLIT)) {// 手动控制天窗开关
 		apslit slit = from_apbase<ascii_proto_slit>(proto);
 		int cmd = slit->command;
 		int n;
 		const char *s = ascproto_->CompactSlit(slit, n);
-		mutex_lock lck(mtx_tcpc_dome_);
+		MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
 		for (DomeNetVec::iterator it = tcpc_dome_.begin(); it != tcpc_dome_.end(); ++it) {
 			if ((*it).automode || !(*it).IsMatched(gid)) continue;
 			if ((cmd == DSC_OPEN && (*it).state == DSS_CLOSE)
 					|| (cmd == DSC_CLOSE && (*it).state == DSS_OPEN)) {
 				(*it).tcp->Write(s, n);
+				mslitcmd_[1][cmd == DSC_OPEN ? 0 : 1]->Add();
+				track_command(*it, cmd);
 			}
 		}
 	}
 	else if (iequals(type, APTYPE_START)) {// 启用自动开关天窗
-		mutex_lock lck(mtx_tcpc_dome_);
+		MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
 		for (DomeNetVec::iterator it = tcpc_dome_.begin(); it != tcpc_dome_.end(); ++it) {
-			if ((*it).IsMatched(gid)) (*it).automode = true;
+			if ((*it).IsMatched(gid) && !(*it).automode) {
+				(*it).automode = true;
+				++verdome_;
+			}
 		}
 	}
 	else if (iequals(type, APTYPE_STOP)) {// 禁用自动开关天窗
-		mutex_lock lck(mtx_tcpc_dome_);
+		MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
 		for (DomeNetVec::iterator it = tcpc_dome_.begin(); it != tcpc_dome_.end(); ++it) {
-			if ((*it).IsMatched(gid)) (*it).automode = false;
+			if ((*it).IsMatched(gid) && (*it).automode) {
+				(*it).automode = false;
+				++verdome_;
+			}
 		}
 	}
+	else if (iequals(type, APTYPE_STATUS)) {// 查询全部天窗状态
+		const string &snapshot = dome_snapshot();
+		client->Write(snapshot.c_str(), snapshot.size());
+	}
+	else if (iequals(type, APTYPE_SUB)) {// 订阅天窗状态变化
+		subscribe(client, gid, true);
+	}
+	else if (iequals(type, APTYPE_UNSUB)) {// 取消订阅天窗状态变化
+		subscribe(client, gid, false);
+	}
 }
 
 void GeneralControl::process_protocol_dome(apbase proto, TCPClient* client) {
@@ -190,13 +297,87 @@ void GeneralControl::process_protocol_dome(apbase proto, TCPClient* client) {
 
 	if (iequals(type, APTYPE_SLIT) && !gid.empty()) {// 天窗状态
 		apslit slit = from_apbase<ascii_proto_slit>(proto);
-		DomeNetVec::iterator it;
-		mutex_lock lck(mtx_tcpc_dome_);
+		bool changed(false);
+		{
+			DomeNetVec::iterator it;
+			MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
 
-		for (it = tcpc_dome_.begin(); it != tcpc_dome_.end() && client != (*it).tcp.get(); ++it);
-		if (it != tcpc_dome_.end()) {
-			if ((*it).gid.empty()) (*it).gid = gid;
-			(*it).state = slit->state;
+			for (it = tcpc_dome_.begin(); it != tcpc_dome_.end() && client != (*it).tcp.get(); ++it);
+			if (it != tcpc_dome_.end()) {
+				if ((*it).gid.empty()) {
+					apslit close = boost::make_shared<ascii_proto_slit>();
+					int n;
+					close->set_id(gid);
+					close->command = DSC_CLOSE;
+					const char *s = ascproto_->CompactSlit(close, n);
+					(*it).gid = gid;
+					(*it).frmclose.assign(s, n);
+					++verdome_;
+				}
+				if ((*it).silent) {
+					(*it).silent = false;
+					_gLog.Write("Dome[%s] resumed reporting", gid.c_str());
+				}
+				if ((changed = (*it).state != slit->state)) {
+					_gRecorder.Record(FRE_STATE, (*it).state, slit->state, 0, gid.c_str());
+					(*it).state = slit->state;
+					++verdome_;
+					update_command(*it);
+				}
+			}
+		}
+		// 释放圆顶锁后推送, 避免与客户端锁嵌套
+		if (changed) publish_state(gid, slit->state);
+	}
+}
+
+void GeneralControl::subscribe(TCPClient* client, const string &gid, bool on) {
+	MetricTimedLock lck(mtx_tcpc_client_, mlockclient_);
+	SubscriberVec::iterator it;
+
+	for (it = subscribers_.begin(); it != subscribers_.end() && client != (*it).tcp.get(); ++it);
+	if (it == subscribers_.end()) {
+		if (!on) return;
+		TcpCVec::iterator itc;
+		for (itc = tcpc_client_.begin(); itc != tcpc_client_.end() && client != (*itc).get(); ++itc);
+		if (itc == tcpc_client_.end()) return;
+
+		Subscriber sub;
+		sub.tcp = *itc;
+		it = subscribers_.insert(subscribers_.end(), sub);
+	}
+
+	if (on) {
+		if (gid.empty()) (*it).all = true;
+		else (*it).gids.insert(gid);
+	}
+	else if (!gid.empty()) (*it).gids.erase(gid);
+	if (!on && (gid.empty() || !((*it).all || (*it).gids.size()))) subscribers_.erase(it);
+}
+
+void GeneralControl::publish_state(const string &gid, int state) {
+	apslit slit = boost::make_shared<ascii_proto_slit>();
+	int n;
+
+	slit->set_id(gid);
+	slit->state = state;
+	const char *s = ascproto_->CompactSlit(slit, n);
+	string event(s, n);	// 全部订阅者共用的已编码信息
+
+	MetricTimedLock lck(mtx_tcpc_client_, mlockclient_);
+	for (SubscriberVec::iterator it = subscribers_.begin(); it != subscribers_.end(); ++it) {
+		if (!((*it).IsSubscribed(gid) && (*it).tcp->IsOpen())) continue;
+		if ((*it).tcp->Pending() > SUB_MAX_PENDING) {// 慢速订阅者: 断开连接, 由on_close_client()清理
+			boost::system::error_code ec;
+			tcp::endpoint remote = (*it).tcp->GetSocket().remote_endpoint(ec);
+			_gLog.Write(LOG_WARN, "GeneralControl::publish_state", "subscriber<%s:%d> disconnected for backlog of %d bytes",
+					remote.address().to_string().c_str(), remote.port(), (*it).tcp->Pending());
+			(*it).tcp->Close();
+			mevicted_->Add();
+		}
+		else {
+			(*it).tcp->Write(event.c_str(), n);
+			mpushed_->Add();
 		}
 	}
 }
@@ -210,18 +391,19 @@ int GeneralControl::create_server(TcpSPtr *server, const uint16_t port) {
 }
 
 bool GeneralControl::create_all_server() {
+	ParamPtr param = get_param();
 	int ec;
 
-	if ((ec = create_server(&tcps_client_, param_->portClient))) {
+	if ((ec = create_server(&tcps_client_, param->portClient))) {
 		_gLog.Write(LOG_FAULT, "GeneralControl::create_all_server",
 				"Failed to create server for client on port<%d>. ErrorCode<%d>",
-				param_->portClient, ec);
+				param->portClient, ec);
 		return false;
 	}
-	if ((ec = create_server(&tcps_dome_, param_->portDome))) {
+	if ((ec = create_server(&tcps_dome_, param->portDome))) {
 		_gLog.Write(LOG_FAULT, "GeneralControl::create_all_server",
 				"Failed to create server for dome on port<%d>. ErrorCode<%d>",
-				param_->portDome, ec);
+				param->portDome, ec);
 		return false;
 	}
 
@@ -230,23 +412,34 @@ bool GeneralControl::create_all_server() {
 
 void GeneralControl::network_accept(const TcpCPtr& client, const long server) {
 	TCPServer* ptr = (TCPServer*) server;
+	boost::system::error_code ec;
+	tcp::endpoint remote = client->GetSocket().remote_endpoint(ec);
+	GLOG_DEBUG(LOGC_NETWORK, NULL, "%s connection from <%s>", ptr == tcps_client_.get() ? "CLIENT" : "DOME",
+			remote.address().to_string());
+	_gRecorder.Record(FRE_ACCEPT, ptr == tcps_client_.get() ? PEER_CLIENT : PEER_DOME,
+			remote.address().is_v4() ? remote.address().to_v4().to_ulong() : 0, remote.port());
 
 	/* 不使用消息队列, 需要互斥 */
 	if (ptr == tcps_client_.get()) {// 客户端
-		mutex_lock lck(mtx_tcpc_client_);
+		MetricTimedLock lck(mtx_tcpc_client_, mlockclient_);
 		tcpc_client_.push_back(client);
 		client->UseBuffer();
 		const TCPClient::CBSlot& slot = boost::bind(&GeneralControl::receive_client, this, _1, _2);
 		client->RegisterRead(slot);
+		arm_idle(client.get(), PEER_CLIENT);
 	}
 	else if (ptr == tcps_dome_.get()) {// 转台
-		mutex_lock lck(mtx_tcpc_dome_);
+		MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
 		DomeNetwork netdome;
 		netdome.tcp = client;
 		tcpc_dome_.push_back(netdome);
+		++verdome_;
 		client->UseBuffer();
 		const TCPClient::CBSlot& slot = boost::bind(&GeneralControl::receive_dome, this, _1, _2);
+		const TCPClient::CBSlot& slot1 = boost::bind(&GeneralControl::slit_written, this, _1, _2);
 		client->RegisterRead(slot);
+		client->RegisterWritten(slot1);
+		arm_idle(client.get(), PEER_DOME);
 	}
 }
 
@@ -258,25 +451,95 @@ void GeneralControl::receive_dome(const long client, const long ec) {
 	PostMessage(ec ? MSG_CLOSE_DOME : MSG_RECEIVE_DOME, client);
 }
 
+void GeneralControl::arm_idle(TCPClient* client, int peer) {
+	ParamPtr param = get_param();
+	int secs;
+	if (peer == PEER_CLIENT) secs = param->liveClientIdle;
+	else secs = param->liveDomeHeartbeat > 0 ? param->liveDomeHeartbeat : param->liveDomeTimeout;
+	wheel_.Arm(client->IdleTimer(), secs);
+}
+
+void GeneralControl::idle_expired(const long client) {
+	PostMessage(MSG_IDLE_TIMEOUT, client);
+}
+
+void GeneralControl::on_idle_timeout(const long param1, const long param2) {
+	TCPClient* ptr = (TCPClient*) param1;
+	ParamPtr param = get_param();
+	boost::system::error_code ec;
+	{// 客户端: 订阅者可以不发送信息
+		MetricTimedLock lck(mtx_tcpc_client_, mlockclient_);
+		TcpCVec::iterator it;
+		for (it = tcpc_client_.begin(); it != tcpc_client_.end() && ptr != (*it).get(); ++it);
+		if (it != tcpc_client_.end()) {
+			SubscriberVec::iterator its;
+			for (its = subscribers_.begin(); its != subscribers_.end() && ptr != (*its).tcp.get(); ++its);
+			if (its != subscribers_.end()) arm_idle(ptr, PEER_CLIENT);
+			else {
+				tcp::endpoint remote = ptr->GetSocket().remote_endpoint(ec);
+				_gLog.Write(LOG_WARN, NULL, "client<%s:%d> was idle for %d seconds, disconnected",
+						remote.address().to_string().c_str(), remote.port(), param->liveClientIdle);
+				ptr->Close();
+				midleclose_[PEER_CLIENT]->Add();
+			}
+			return;
+		}
+	}
+	{// 圆顶: 先标记为静默, 再断开连接
+		MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
+		DomeNetVec::iterator it;
+		for (it = tcpc_dome_.begin(); it != tcpc_dome_.end() && ptr != (*it).tcp.get(); ++it);
+		if (it == tcpc_dome_.end()) return;
+
+		int heartbeat(param->liveDomeHeartbeat), timeout(param->liveDomeTimeout);
+		if (!(*it).silent && heartbeat > 0) {
+			(*it).silent = true;
+			_gLog.Write(LOG_WARN, NULL, "Dome[%s] has been silent for %d seconds", (*it).gid.c_str(), heartbeat);
+			msilent_->Add();
+			if (timeout > heartbeat) {
+				wheel_.Arm(ptr->IdleTimer(), timeout - heartbeat);
+				return;
+			}
+		}
+		if (timeout > 0) {
+			_gLog.Write(LOG_WARN, NULL, "Dome[%s] has been silent for %d seconds, disconnected",
+					(*it).gid.c_str(), timeout);
+			ptr->Close();
+			midleclose_[PEER_DOME]->Add();
+		}
+		else wheel_.Arm(ptr->IdleTimer(), heartbeat);	// 不断开连接: 按心跳周期继续跟踪
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////
-bool GeneralControl::read_weather(string &tmloc, double &spdopen, double &spdclose) {
+bool GeneralControl::read_weather(ParamPtr param, string &tmloc, double &spdopen, double &spdclose, SlitTrace &trace) {
 	char line[200];
 	char seps[] = " ";
-	char *token;
+	char *token, *saveptr;
 	int pos(0);
 	double spdreal[3];
 
 	/* 尝试访问文件, 读取风速 */
-	FILE *fp = fopen(param_->pathWeather.c_str(), "r");
+	FILE *fp = fopen(param->pathWeather.c_str(), "r");
 	if (!fp) {
-		_gLog.Write(LOG_FAULT, NULL, "failed to open weather file[%s]",
-				param_->pathWeather.c_str());
+		GLOG_RECORD_CAT(LOGC_WEATHER, LOG_FAULT, NULL, "failed to open weather file[%s]", param->pathWeather);
 	}
 	else {
+		struct stat st;
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		trace.mingest = Metrics::Now();
+		trace.tingest = ts.tv_sec + ts.tv_nsec * 1E-9;
+		if (!fstat(fileno(fp), &st)) {
+			ts = file_mtime(st);
+			trace.tsample = ts.tv_sec + ts.tv_nsec * 1E-9;
+		}
+		else trace.tsample = trace.tingest;
+
 		while (!feof(fp)) {
 			if (NULL == fgets(line, 200, fp)) continue;
 
-			token = strtok(line, seps);
+			token = strtok_r(line, seps, &saveptr);
 			while (token && pos < 9) {
 				if (++pos == 1)    tmloc = token;
 				else if (pos == 2) { tmloc += "T"; tmloc += token; }
@@ -284,34 +547,190 @@ bool GeneralControl::read_weather(string &tmloc, double &spdopen, double &spdclo
 				else if (pos == 8) spdreal[1] = atof(token);
 				else if (pos == 9) spdreal[2] = atof(token);
 
-				token = strtok(NULL, seps);
+				token = strtok_r(NULL, seps, &saveptr);
 			}
 		}
 		fclose(fp);
 	}
 	if (pos == 9) {
-		spdopen  = spdreal[param_->openWindOpt - 1];
-		spdclose = spdreal[param_->cloWindOpt - 1];
+		spdopen  = spdreal[param->openWindOpt - 1];
+		spdclose = spdreal[param->cloWindOpt - 1];
 	}
 
 	return pos == 9;
 }
 
+void GeneralControl::load_leap_second(const string &filepath) {
+	if (filepath.empty()) return;
+
+	// 在局部对象中加载, 成功后在互斥锁保护下替换, 避免气象线程读取正在修改的闰秒表
+	ATimeSpace ats;
+	int n = ats.LoadLeapSecond(filepath.c_str());
+	if (n > 0) {
+		{
+			mutex_lock lck(mtx_ats_);
+			ats_.CopyLeapSecond(ats);
+			ephem_.SetLeapSecond(ats);
+		}
+		_gLog.Write("loaded %d leap second entries from [%s]", n, filepath.c_str());
+	}
+	else {
+		_gLog.Write(LOG_WARN, NULL, "failed to load leap second file[%s], error code<%d>. keep current table",
+				filepath.c_str(), n);
+	}
+}
+
+ParamPtr GeneralControl::get_param() {
+	mutex_lock lck(mtx_param_);
+	return param_;
+}
+
+void GeneralControl::set_param(ParamPtr param) {
+	mutex_lock lck(mtx_param_);
+	param_ = param;
+}
+
+void GeneralControl::apply_log_level(ParamPtr param) {
+	for (int i = 0; i < LOGC_MAX; ++i) {
+		const string &name = param->logLevel[i];
+		int level = GLog::LevelByName(name.c_str());
+		if (level >= 0) _gLog.SetLevel(LOG_CATEGORY(i), LOG_LEVEL(level));
+		else if (!name.empty()) {
+			_gLog.Write(LOG_WARN, NULL, "unknown log level<%s> of %s", name.c_str(), GLog::CategoryName(i));
+		}
+	}
+}
+
+void GeneralControl::register_metrics() {
+	const char* name = "annaes_slit_commands_total";
+	const char* help = "Slit commands sent to domes";
+	mslitcmd_[0][0] = _gMetrics.Counter(name, help, "source=\"auto\",command=\"open\"");
+	mslitcmd_[0][1] = _gMetrics.Counter(name, help, "source=\"auto\",command=\"close\"");
+	mslitcmd_[1][0] = _gMetrics.Counter(name, help, "source=\"manual\",command=\"open\"");
+	mslitcmd_[1][1] = _gMetrics.Counter(name, help, "source=\"manual\",command=\"close\"");
+	mweatherfail_  = _gMetrics.Counter("annaes_weather_failures_total", "Failures to read weather file");
+	mweatherstale_ = _gMetrics.Counter("annaes_weather_stale_total", "Weather file read without new time flag");
+	mweatherlag_   = _gMetrics.Gauge("annaes_weather_lag_seconds", "Local time minus time flag of latest weather data");
+	name = "annaes_lock_wait_seconds";
+	help = "Time spent waiting for connection list locks";
+	mlockclient_ = _gMetrics.Histogram(name, help, "lock=\"client\"", 1E-6);
+	mlockdome_   = _gMetrics.Histogram(name, help, "lock=\"dome\"",   1E-6);
+	name = "annaes_slit_latency_seconds";
+	help = "Latency of automatic slit commands by stage, from weather file write to command on the wire";
+	mlatency_[STAGE_SAMPLE] = _gMetrics.Histogram(name, help, "stage=\"sample_to_ingest\"",   1E-6);
+	mlatency_[STAGE_DECIDE] = _gMetrics.Histogram(name, help, "stage=\"ingest_to_decision\"", 1E-6);
+	mlatency_[STAGE_WIRE]   = _gMetrics.Histogram(name, help, "stage=\"decision_to_wire\"",   1E-6);
+	mlatency_[STAGE_TOTAL]  = _gMetrics.Histogram(name, help, "stage=\"sample_to_wire\"",     1E-6);
+	memergency_ = _gMetrics.Histogram("annaes_emergency_close_latency_seconds",
+			"Latency from writing emergency wind sample to close command on the wire", "", 1E-6);
+	mreaction_ = _gMetrics.Histogram("annaes_emergency_reaction_seconds",
+			"Latency of emergency fast path from reading wind sample to close command on the wire", "", 1E-6);
+	mpushed_  = _gMetrics.Counter("annaes_subscription_pushed_total", "Dome state changes pushed to subscribers");
+	mevicted_ = _gMetrics.Counter("annaes_subscription_evicted_total", "Subscribers disconnected for send backlog");
+	mretry_    = _gMetrics.Counter("annaes_slit_retries_total", "Slit commands resent for lack of state change");
+	mescalate_ = _gMetrics.Counter("annaes_slit_escalations_total", "Slit commands given up as failed");
+	msilent_   = _gMetrics.Counter("annaes_dome_silent_total", "Domes flagged silent after heartbeat deadline");
+	name = "annaes_idle_disconnects_total";
+	help = "Connections closed after idle deadline";
+	midleclose_[PEER_CLIENT] = _gMetrics.Counter(name, help, "peer=\"client\"");
+	midleclose_[PEER_DOME]   = _gMetrics.Counter(name, help, "peer=\"dome\"");
+
+	const Metrics::CBSlot& slot = boost::bind(&GeneralControl::collect_metrics, this, _1);
+	conncollect_ = _gMetrics.RegisterCollect(slot);
+}
+
+void GeneralControl::collect_metrics(string &output) {
+	string rcvd, sent;
+	char line[200];
+	uint64_t nrcvd, nsent;
+	int nclient, ndome, nsub;
+	boost::system::error_code ec;
+
+	{
+		mutex_lock lck(mtx_tcpc_client_);
+		nclient = tcpc_client_.size();
+		nsub    = subscribers_.size();
+		for (TcpCVec::iterator it = tcpc_client_.begin(); it != tcpc_client_.end(); ++it) {
+			tcp::endpoint remote = (*it)->GetSocket().remote_endpoint(ec);
+			(*it)->GetBytes(nrcvd, nsent);
+			snprintf(line, sizeof(line), "{peer=\"client\",remote=\"%s:%d\"} ",
+					remote.address().to_string().c_str(), remote.port());
+			rcvd += string("annaes_connection_received_bytes_total") + line + lexical_cast<string>(nrcvd) + "\n";
+			sent += string("annaes_connection_sent_bytes_total") + line + lexical_cast<string>(nsent) + "\n";
+		}
+	}
+	{
+		mutex_lock lck(mtx_tcpc_dome_);
+		ndome = tcpc_dome_.size();
+		for (DomeNetVec::iterator it = tcpc_dome_.begin(); it != tcpc_dome_.end(); ++it) {
+			tcp::endpoint remote = (*it).tcp->GetSocket().remote_endpoint(ec);
+			(*it).tcp->GetBytes(nrcvd, nsent);
+			snprintf(line, sizeof(line), "{peer=\"dome\",gid=\"%s\",remote=\"%s:%d\"} ", (*it).gid.c_str(),
+					remote.address().to_string().c_str(), remote.port());
+			rcvd += string("annaes_connection_received_bytes_total") + line + lexical_cast<string>(nrcvd) + "\n";
+			sent += string("annaes_connection_sent_bytes_total") + line + lexical_cast<string>(nsent) + "\n";
+		}
+	}
+
+	output += "# HELP annaes_connections Open TCP connections\n# TYPE annaes_connections gauge\n";
+	output += "annaes_connections{peer=\"client\"} " + lexical_cast<string>(nclient) + "\n";
+	output += "annaes_connections{peer=\"dome\"} " + lexical_cast<string>(ndome) + "\n";
+	output += "# HELP annaes_subscribers Client connections subscribed to dome state changes\n# TYPE annaes_subscribers gauge\n";
+	output += "annaes_subscribers " + lexical_cast<string>(nsub) + "\n";
+	output += "# HELP annaes_idle_timers Connection idle deadlines armed in the timer wheel\n# TYPE annaes_idle_timers gauge\n";
+	output += "annaes_idle_timers " + lexical_cast<string>(wheel_.Armed()) + "\n";
+	output += "# HELP annaes_connection_received_bytes_total Bytes received on each connection\n"
+			"# TYPE annaes_connection_received_bytes_total counter\n" + rcvd;
+	output += "# HELP annaes_connection_sent_bytes_total Bytes sent on each connection\n"
+			"# TYPE annaes_connection_sent_bytes_total counter\n" + sent;
+}
+
+void GeneralControl::load_almanac(const string &filepath, ParamPtr param) {
+	if (filepath.empty()) return;
+
+	int rslt = almanac_.Open(filepath.c_str());
+	if (rslt) {
+		_gLog.Write(LOG_WARN, NULL, "failed to map almanac file[%s], error code<%d>", filepath.c_str(), rslt);
+		return;
+	}
+
+	const AstroUtil::almanac_head *head = almanac_.Head();
+	if (fabs(head->lgt - param->siteLon) > 1E-6 || fabs(head->lat - param->siteLat) > 1E-6
+			|| head->timezone != param->timezone) {
+		_gLog.Write(LOG_WARN, NULL, "almanac file[%s] was generated for another site", filepath.c_str());
+		almanac_.Close();
+		return;
+	}
+
+	ptime now = second_clock::universal_time();
+	double mjd = now.date().modjulian_day();
+	double rise, set;
+
+	_gLog.Write("mapped almanac file[%s], %d days from MJD %d", filepath.c_str(), head->count, head->mjd0);
+	if (!almanac_.Lookup(mjd, AstroUtil::ALM_ASTRONOMICAL, rise, set))
+		_gLog.Write("astronomical twilight of today: %.4f ~ %.4f", set, rise);
+}
+
 double GeneralControl::sun_altitude() {
 	double ra, dec, lmst;
 	double azi, alt;
 	ptime now = second_clock::universal_time();
 	ptime::date_type today = now.date();
+	mutex_lock lck(mtx_ats_);
 
 	ats_.SetUTC(today.year(), today.month(), today.day(), now.time_of_day().total_seconds() / 86400.0);
 	lmst = ats_.LocalMeanSiderealTime();
-	ats_.SunPosition(ra, dec);
+	// 缓存按TT计算太阳位置, 与此前以UTC代替TT的结果相差约3角秒, 对晨昏判断无影响
+	ephem_.SunPosition(ats_.ModifiedJulianDay(), ra, dec);
 	ats_.Eq2Horizon(lmst - ra, dec, azi, alt);
 
 	return (alt * R2D);
 }
 
-void GeneralControl::switch_slit(DomeNetwork &dome, int odt, double spdopen, double spdclo) {
+void GeneralControl::switch_slit(ParamPtr param, DomeNetwork &dome, int odt, double spdopen, double spdclo, const SlitTrace &trace) {
+	int cntopen(dome.cntopen), cntclose(dome.cntclose);
+	ptime tmlast(dome.tmlast);
+
 	if (dome.state == DSS_OPENING || dome.state == DSS_CLOSING) {
 		ptime now = second_clock::universal_time();
 		if (!dome.tmlast.is_special() && (now - dome.tmlast).total_seconds() >= 300) {
@@ -323,7 +742,8 @@ void GeneralControl::switch_slit(DomeNetwork &dome, int odt, double spdopen, dou
 	else {
 		apslit slit = boost::make_shared<ascii_proto_slit>();
 		int n(0);
-		const char *s;
+		const char *s(NULL);
+		bool emergency(false);
 		if (odt == ODT_DAY) {// 白天: 检查天窗是否未关闭
 			if (dome.state == DSS_OPEN) {// 需要关闭
 				slit->command = DSC_CLOSE;
@@ -331,54 +751,300 @@ void GeneralControl::switch_slit(DomeNetwork &dome, int odt, double spdopen, dou
 		}
 		else {
 			if (dome.state == DSS_OPEN) {// 判断是否需要关闭
-				if (spdclo >= param_->cloWindSpdEmergency) dome.cntclose = param_->cloContNum;
-				else if (spdclo >= param_->cloWindSpd) ++dome.cntclose;
+				if ((emergency = spdclo >= param->cloWindSpdEmergency)) dome.cntclose = param->cloContNum;
+				else if (spdclo >= param->cloWindSpd) ++dome.cntclose;
 				else if (dome.cntclose) dome.cntclose = 0;
 
-				if (dome.cntclose >= param_->cloContNum) slit->command = DSC_CLOSE;
+				if (dome.cntclose >= param->cloContNum) slit->command = DSC_CLOSE;
 			}
 			else if (dome.state == DSS_CLOSE) {// 判断是否需要打开
-				if (spdopen < param_->openWindSpd) ++dome.cntopen;
+				if (spdopen < param->openWindSpd) ++dome.cntopen;
 				else if (dome.cntopen) dome.cntopen = 0;
 
-				if (dome.cntopen >= param_->openContNum) slit->command = DSC_OPEN;
+				if (dome.cntopen >= param->openContNum) slit->command = DSC_OPEN;
 			}
 		}
 
-		if (slit->command >= DSC_OPEN) {
+		_gRecorder.Record(FRE_DECISION, slit->command, int64_t(spdclo * 100),
+				(dome.cntopen << 16) | (dome.cntclose & 0xFFFF), dome.gid.c_str());
+		GLOG_DEBUG(LOGC_DOME, "GeneralControl::switch_slit", "Dome[%s] state=%d, count open=%d close=%d, command=%d",
+				dome.gid, dome.state, dome.cntopen, dome.cntclose, slit->command);
+		if (slit->command >= DSC_OPEN && slit->command != dome.cmdpend) {// 已跟踪的指令由定时器负责重发
 			dome.tmlast = second_clock::universal_time();
 			s = ascproto_->CompactSlit(slit, n);
 		}
-		if (n) dome.tcp->Write(s, n);
+		if (n) {// 发送完成前登记追踪, 发送完成时由slit_written()记录时延
+			SlitTrace x(trace);
+			x.gid       = dome.gid;
+			x.command   = slit->command;
+			x.emergency = emergency && slit->command == DSC_CLOSE;
+			x.mdecide   = Metrics::Now();
+			{
+				mutex_lock lck(mtx_trace_);
+				x.id = ++idtrace_;
+				traces_.push_back(x);
+			}
+			dome.tcp->Write(s, n, x.id);
+			mslitcmd_[0][slit->command == DSC_OPEN ? 0 : 1]->Add();
+			track_command(dome, slit->command);
+		}
+	}
+	if (cntopen != dome.cntopen || cntclose != dome.cntclose || tmlast != dome.tmlast) ++verdome_;
+}
+
+void GeneralControl::slit_written(const long, const long id) {
+	uint64_t now = Metrics::Now();
+	SlitTrace x;
+	{
+		mutex_lock lck(mtx_trace_);
+		SlitTraceBuff::iterator it;
+		for (it = traces_.begin(); it != traces_.end() && (*it).id != id; ++it);
+		if (it == traces_.end()) return;
+		x = *it;
+		traces_.erase(it);
 	}
+
+	// 文件修改时间与读取时间来自实时时钟, 其余阶段采用单调时钟
+	double sample = x.tingest - x.tsample;
+	uint64_t tsample = sample > 0.0 ? uint64_t(sample * 1E6) : 0;
+	uint64_t ttotal  = tsample + (now - x.mingest);
+	mlatency_[STAGE_SAMPLE]->Record(tsample);
+	mlatency_[STAGE_DECIDE]->Record(x.mdecide - x.mingest);
+	mlatency_[STAGE_WIRE]->Record(now - x.mdecide);
+	mlatency_[STAGE_TOTAL]->Record(ttotal);
+	if (x.emergency) {
+		memergency_->Record(ttotal);
+		if (x.fastpath) mreaction_->Record(now - x.mingest);
+		GLOG_RECORD_CAT(LOGC_DOME, LOG_WARN, NULL, "Dome[%s] emergency close sent %.3f seconds after wind sample, %.6f seconds after ingestion",
+				x.gid, ttotal * 1E-6, (now - x.mingest) * 1E-6);
+	}
+	GLOG_DEBUG(LOGC_DOME, "GeneralControl::slit_written", "Dome[%s] command=%d latency: sample %.3f, decide %.6f, wire %.6f sec",
+			x.gid, x.command, tsample * 1E-6, (x.mdecide - x.mingest) * 1E-6, (now - x.mdecide) * 1E-6);
 }
 
 //////////////////////////////////////////////////////////////////////////////
+void GeneralControl::track_command(DomeNetwork &dome, int cmd) {
+	if (!dome.tmcmd.use_count()) dome.tmcmd.reset(new boost::asio::deadline_timer(keep_.get_service()));
+	dome.cmdpend = cmd;
+	dome.nretry  = 0;
+	arm_command_timer(dome, get_param()->cmdAckTimeout);
+}
+
+void GeneralControl::update_command(DomeNetwork &dome) {
+	if (dome.cmdpend == -1) return;
+
+	int cmd = dome.cmdpend;
+	if ((cmd == DSC_OPEN && dome.state == DSS_OPEN) || (cmd == DSC_CLOSE && dome.state == DSS_CLOSE)) {// 到位
+		boost::system::error_code ec;
+		dome.cmdpend = -1;
+		++dome.seqcmd;
+		dome.tmcmd->cancel(ec);
+	}
+	else if ((cmd == DSC_OPEN && dome.state == DSS_OPENING) || (cmd == DSC_CLOSE && dome.state == DSS_CLOSING)) {
+		arm_command_timer(dome, get_param()->cmdMoveTimeout);
+	}
+	else if (dome.state == DSS_ERROR) escalate_command(dome, "dome reported error");
+}
+
+void GeneralControl::arm_command_timer(DomeNetwork &dome, int secs) {
+	boost::system::error_code ec;
+	long seq = ++dome.seqcmd;
+
+	dome.tmcmd->expires_from_now(seconds(secs), ec);
+	dome.tmcmd->async_wait(boost::bind(&GeneralControl::handle_command_timer, this,
+			(long) dome.tcp.get(), seq, boost::asio::placeholders::error));
+}
+
+void GeneralControl::handle_command_timer(const long client, const long seq, const boost::system::error_code& ec) {
+	if (ec != boost::asio::error::operation_aborted) PostMessage(MSG_SLIT_TIMEOUT, client, seq);
+}
+
+void GeneralControl::on_slit_timeout(const long param1, const long param2) {
+	MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
+	TCPClient* ptr = (TCPClient*) param1;
+	DomeNetVec::iterator it;
+
+	for (it = tcpc_dome_.begin(); it != tcpc_dome_.end() && ptr != (*it).tcp.get(); ++it);
+	if (it == tcpc_dome_.end() || (*it).cmdpend == -1 || (*it).seqcmd != param2) return;
+
+	DomeNetwork &dome = *it;
+	ParamPtr param = get_param();
+	int cmd = dome.cmdpend;
+	if ((cmd == DSC_OPEN && dome.state == DSS_OPENING) || (cmd == DSC_CLOSE && dome.state == DSS_CLOSING)) {
+		escalate_command(dome, "slit did not finish moving");
+	}
+	else if (dome.nretry >= param->cmdRetry) {
+		escalate_command(dome, "no state change after retries");
+	}
+	else {// 重发, 等待时间加倍
+		apslit slit = boost::make_shared<ascii_proto_slit>();
+		int n;
+		slit->set_id(dome.gid);
+		slit->command = cmd;
+		const char *s = ascproto_->CompactSlit(slit, n);
+		++dome.nretry;
+		_gLog.Write(LOG_WARN, NULL, "Dome[%s] did not respond to command<%d>, retry #%d",
+				dome.gid.c_str(), cmd, dome.nretry);
+		dome.tmlast = second_clock::universal_time();
+		++verdome_;
+		dome.tcp->Write(s, n);
+		mretry_->Add();
+		long long secs = (long long) param->cmdAckTimeout << dome.nretry;	// nretry不超过16, 不会溢出
+		if (secs > CMD_BACKOFF_MAX) secs = param->cmdAckTimeout > CMD_BACKOFF_MAX ? param->cmdAckTimeout : CMD_BACKOFF_MAX;
+		arm_command_timer(dome, int(secs));
+	}
+}
+
+void GeneralControl::escalate_command(DomeNetwork &dome, const char *reason) {
+	boost::system::error_code ec;
+
+	mescalate_->Add();
+	_gRecorder.Record(FRE_ESCALATE, dome.cmdpend, dome.nretry, dome.state, dome.gid.c_str());
+	_gLog.Write(LOG_FAULT, "GeneralControl::escalate_command", "Dome[%s] command<%d> failed: %s. retried %d times, state=%d",
+			dome.gid.c_str(), dome.cmdpend, reason, dome.nretry, dome.state);
+	dome.cmdpend = -1;
+	++dome.seqcmd;
+	dome.tmcmd->cancel(ec);
+}
+
+void GeneralControl::emergency_close(ParamPtr param, double spdclo, const SlitTrace &trace) {
+	struct target {
+		TcpCPtr tcp;
+		string frame;
+		long id;
+	};
+	std::vector<target> targets;
+	ptime now = second_clock::universal_time();
+
+	{// 圆顶锁内仅登记, 不发送
+		MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
+		for (DomeNetVec::iterator it = tcpc_dome_.begin(); it != tcpc_dome_.end(); ++it) {
+			DomeNetwork &dome = *it;
+			if (!dome.automode || dome.frmclose.empty() || dome.cmdpend == DSC_CLOSE
+					|| !(dome.state == DSS_OPEN || dome.state == DSS_OPENING)) continue;
+
+			SlitTrace x(trace);
+			x.gid       = dome.gid;
+			x.command   = DSC_CLOSE;
+			x.emergency = true;
+			x.fastpath  = true;
+			x.mdecide   = Metrics::Now();
+			{
+				mutex_lock lck1(mtx_trace_);
+				x.id = ++idtrace_;
+				traces_.push_back(x);
+			}
+			_gRecorder.Record(FRE_DECISION, DSC_CLOSE, int64_t(spdclo * 100), param->cloContNum & 0xFFFF, dome.gid.c_str());
+			dome.cntclose = param->cloContNum;
+			dome.tmlast   = now;
+			track_command(dome, DSC_CLOSE);
+			++verdome_;
+
+			target t;
+			t.tcp   = dome.tcp;
+			t.frame = dome.frmclose;
+			t.id    = x.id;
+			targets.push_back(t);
+		}
+	}
+	if (targets.empty()) return;
+
+	for (std::vector<target>::iterator it = targets.begin(); it != targets.end(); ++it) {
+		(*it).tcp->WriteUrgent((*it).frame.c_str(), (*it).frame.size(), (*it).id);
+		mslitcmd_[0][1]->Add();
+	}
+	_gLog.Write(LOG_WARN, NULL, "emergency wind speed %.1f m/s, closing %d domes", spdclo, int(targets.size()));
+}
+
+const string &GeneralControl::dome_snapshot() {
+	uint64_t version = verdome_.load();
+	if (version == versnap_) return snapshot_;
+
+	apstatus status = boost::make_shared<ascii_proto_status>();
+	{// 在互斥锁保护下复制状态, 锁外封装
+		MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
+		version = verdome_.load();
+		status->items.resize(tcpc_dome_.size());
+		int i(0);
+		for (DomeNetVec::iterator it = tcpc_dome_.begin(); it != tcpc_dome_.end(); ++it, ++i) {
+			ascii_proto_status::item &item = status->items[i];
+			item.gid      = (*it).gid;
+			item.state    = (*it).state;
+			item.automode = (*it).automode ? 1 : 0;
+			item.cntopen  = (*it).cntopen;
+			item.cntclose = (*it).cntclose;
+			if (!(*it).tmlast.is_special()) item.tmlast = to_iso_extended_string((*it).tmlast);
+		}
+	}
+	ascproto_->CompactStatus(status, snapshot_);
+	versnap_ = version;
+	GLOG_TRACE(LOGC_PROTOCOL, "GeneralControl::dome_snapshot", "rebuilt snapshot of %d domes, version %lu",
+			int(status->items.size()), (unsigned long) version);
+
+	return snapshot_;
+}
+
+void GeneralControl::thread_emergency() {
+	boost::chrono::milliseconds period(EMERGENCY_POLL);
+	struct stat st;
+	struct timespec last, mtime;	// 上次读取的文件修改时间
+	string tmloc;
+	SlitTrace trace;
+	double spdopen, spdclo;
+	ParamPtr param;
+
+	last.tv_sec = last.tv_nsec = 0;
+	while(1) {
+		boost::this_thread::sleep_for(period);
+		param = get_param();
+		if (stat(param->pathWeather.c_str(), &st)) continue;
+		mtime = file_mtime(st);
+		if (mtime.tv_sec == last.tv_sec && mtime.tv_nsec == last.tv_nsec) continue;
+		last = mtime;
+		if (read_weather(param, tmloc, spdopen, spdclo, trace) && spdclo >= param->cloWindSpdEmergency)
+			emergency_close(param, spdclo, trace);
+	}
+}
+
 void GeneralControl::thread_weather() {
 	boost::chrono::minutes period(1);	// 周期: 1分钟
 	string tmold, tmnew;	// 气象数据文件中的本地时
+	SlitTrace trace;		// 气象数据的时延追踪
 	double spdopen, spdclo;	// 实时风速: 用于开关天窗判据
 	double altsun;
 	int odt; // 观测时段类型
+	ParamPtr param;
 
 	while(1) {
 		boost::this_thread::sleep_for(period);
+		param = get_param();
+		_gRecorder.Record(FRE_QUEUE, int(mdepth_->Value()), mposted_->Value());
 
-		if (!read_weather(tmnew, spdopen, spdclo)) {
-			_gLog.Write(LOG_FAULT, NULL, "failed to access weather file or wrong file style");
+		if (!read_weather(param, tmnew, spdopen, spdclo, trace)) {
+			mweatherfail_->Add();
+			GLOG_RECORD_CAT(LOGC_WEATHER, LOG_FAULT, NULL, "failed to access weather file or wrong file style");
 		}
 		else if (tmold == tmnew) {
-			_gLog.Write(LOG_FAULT, NULL, "gotten same time flag from weather file");
+			mweatherstale_->Add();
+			GLOG_RECORD_CAT(LOGC_WEATHER, LOG_FAULT, NULL, "gotten same time flag from weather file");
 		}
 		else {
 			tmold = tmnew;
+			try {// 气象数据时标为本地时
+				ptime tmdata = time_from_string(replace_all_copy(tmnew, "T", " "));
+				mweatherlag_->Set((second_clock::local_time() - tmdata).total_seconds());
+			}
+			catch(...) {
+			}
 			// 计算太阳高度角和时段类型
 			altsun = sun_altitude();
-			odt = altsun >= param_->openSunAlt && altsun >= param_->cloSunAlt ? ODT_DAY : ODT_NIGHT;
+			odt = altsun >= param->openSunAlt && altsun >= param->cloSunAlt ? ODT_DAY : ODT_NIGHT;
+			GLOG_DEBUG(LOGC_WEATHER, NULL, "weather<%s>: wind %.1f/%.1f m/s, sun altitude %.2f, %s",
+					tmnew, spdopen, spdclo, altsun, odt == ODT_DAY ? "day" : "night");
 			// 逐一检查并改变天窗开关状态
-			mutex_lock lck(mtx_tcpc_dome_);
+			MetricTimedLock lck(mtx_tcpc_dome_, mlockdome_);
 			for (DomeNetVec::iterator it = tcpc_dome_.begin(); it != tcpc_dome_.end(); ++it) {
-				if ((*it).automode) switch_slit(*it, odt, spdopen, spdclo);
+				if ((*it).automode) switch_slit(param, *it, odt, spdopen, spdclo, trace);
 			}
 		}
 	}
@@ -7,17 +7,28 @@
 #ifndef GENERALCONTROL_H_
 #define GENERALCONTROL_H_
 
+#include <set>
 #include <boost/container/stable_vector.hpp>
+#include <boost/circular_buffer.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "MessageQueue.h"
 #include "AsciiProtocol.h"
 #include "tcpasio.h"
+#include "IOServiceKeep.h"
+#include "TimerWheel.h"
 #include "NTPClient.h"
+#include "Metrics.h"
 #include "parameter.h"
 #include "ATimeSpace.h"
+#include "AEphemCache.h"
+#include "AAlmanac.h"
 
 using namespace boost::posix_time;
 
+#define SUB_MAX_PENDING	(TCP_PACK_SIZE * 50)	//< 订阅者发送缓冲区中待发送数据的上限, 超过时断开连接
+#define EMERGENCY_POLL	250	//< 危险风速快速通道检查气象数据文件的周期, 量纲: 毫秒
+#define CMD_BACKOFF_MAX	3600	//< 重发天窗指令后等待时长的上限, 量纲: 秒
+
 class GeneralControl: public MessageQueue {
 public:
 	GeneralControl();
@@ -30,6 +41,8 @@ protected:
 		MSG_RECEIVE_DOME,	//< 收到天窗信息
 		MSG_CLOSE_CLIENT,	//< 客户端断开网络连接
 		MSG_CLOSE_DOME,		//< 天窗断开网络连接
+		MSG_SLIT_TIMEOUT,	//< 天窗指令超时
+		MSG_IDLE_TIMEOUT,	//< 网络连接超时未收到信息
 		MSG_LAST	//< 占位, 不使用
 	};
 
@@ -46,6 +59,12 @@ protected:
 		int cntopen;	//< 计数: 打开
 		int cntclose;	//< 计数: 关闭
 		ptime tmlast;	//< 最后一次操作时间
+		int cmdpend;	//< 等待完成的指令. -1: 无
+		int nretry;		//< 已重发次数
+		long seqcmd;	//< 指令定时器序号, 用于识别已过期的超时消息
+		bool silent;	//< 超过心跳时限未收到信息
+		string frmclose;	//< 预先封装的关闭指令, 获得组标志时生成
+		boost::shared_ptr<boost::asio::deadline_timer> tmcmd;	//< 指令定时器
 
 	public:
 		DomeNetwork() {
@@ -53,6 +72,10 @@ protected:
 			state     = -1;
 			cntopen   = 0;
 			cntclose  = 0;
+			cmdpend   = -1;
+			nretry    = 0;
+			seqcmd    = 0;
+			silent    = false;
 		}
 
 		/*!
@@ -69,6 +92,50 @@ protected:
 			return 0;
 		}
 	};
+	enum {// 天窗指令时延阶段
+		STAGE_SAMPLE,	//< 气象数据写入至被读取
+		STAGE_DECIDE,	//< 气象数据被读取至做出开关决定
+		STAGE_WIRE,		//< 做出开关决定至指令交给操作系统
+		STAGE_TOTAL,	//< 气象数据写入至指令交给操作系统
+		STAGE_MAX
+	};
+	struct SlitTrace {// 天窗指令时延追踪
+		long id;			//< 追踪编号, 作为发送标记
+		string gid;			//< 圆顶组标志
+		int command;		//< 开关指令
+		bool emergency;		//< 危险风速触发的关闭指令
+		bool fastpath;		//< 由危险风速快速通道发出
+		double tsample;		//< 气象数据文件修改时间, 量纲: 秒. 自1970年1月1日起
+		double tingest;		//< 读取气象数据的时间, 量纲: 秒. 自1970年1月1日起
+		uint64_t mingest;	//< 读取气象数据的单调时钟, 量纲: 微秒
+		uint64_t mdecide;	//< 做出开关决定的单调时钟, 量纲: 微秒
+
+	public:
+		SlitTrace() {
+			id        = 0;
+			command   = 0;
+			emergency = false;
+			fastpath  = false;
+			tsample   = tingest = 0.0;
+			mingest   = mdecide = 0;
+		}
+	};
+	struct Subscriber {// 订阅天窗状态变化的客户端
+		TcpCPtr tcp;	//< TCP连接
+		bool all;		//< 订阅全部天窗
+		std::set<string> gids;	//< 已订阅的组标志
+
+	public:
+		Subscriber() {
+			all = false;
+		}
+
+		bool IsSubscribed(const string &gid) {
+			return all || gids.count(gid);
+		}
+	};
+	typedef boost::circular_buffer<SlitTrace> SlitTraceBuff;
+	typedef boost::container::stable_vector<Subscriber> SubscriberVec;
 	typedef boost::container::stable_vector<DomeNetwork> DomeNetVec;
 	typedef boost::container::stable_vector<TcpCPtr> TcpCVec;
 
@@ -76,10 +143,13 @@ protected:
 	/*---------------- 成员变量 ----------------*/
 //////////////////////////////////////////////////////////////////////////////
 	/* 网络资源 */
+	IOServiceKeep keep_;	//< 提供io_service对象: 指令定时器. 先于tcpc_dome_构造, 后于其析构
+	TimerWheel wheel_;		//< 时间轮: 网络连接活跃检查. 先于网络连接构造, 后于其析构
 	TcpSPtr tcps_client_;	//< TCP服务: 客户端
 	TcpSPtr tcps_dome_;		//< TCP服务: 圆顶
 	TcpCVec tcpc_client_;	//< TCP连接: 客户端
 	DomeNetVec tcpc_dome_;	//< TCP连接: 圆顶
+	SubscriberVec subscribers_;	//< 订阅天窗状态变化的客户端. 由mtx_tcpc_client_保护
 	boost::shared_array<char> bufrcv_;	//< 网络信息存储区: 消息队列中调用
 	AscProtoPtr ascproto_;		//< 通用协议解析接口
 
@@ -87,15 +157,47 @@ protected:
 	/* 互斥锁 */
 	boost::mutex mtx_tcpc_client_;	//< 互斥锁: 客户端
 	boost::mutex mtx_tcpc_dome_;	//< 互斥锁: 圆顶
+	boost::mutex mtx_ats_;			//< 互斥锁: 天文时空接口与太阳位置缓存
+	boost::mutex mtx_param_;		//< 互斥锁: 配置参数访问地址
 
 //////////////////////////////////////////////////////////////////////////////
-	ParamPtr param_;	//< 配置参数
+	ParamPtr param_;	//< 配置参数. 服务启动后经get_param()/set_param()访问
 	NTPPtr ntp_;		//< NTP时钟同步接口
 	AstroUtil::ATimeSpace ats_;	//< 天文时空变换接口
+	AstroUtil::AEphemCache ephem_;	//< 太阳位置缓存
+	AstroUtil::AAlmanac almanac_;	//< 日出日落与晨昏时刻表
+//////////////////////////////////////////////////////////////////////////////
+	/* 运行指标 */
+	MetricCounter* mslitcmd_[2][2];	//< 天窗指令数量. [0: 自动, 1: 手动][0: 打开, 1: 关闭]
+	MetricCounter* mweatherfail_;	//< 气象数据读取失败次数
+	MetricCounter* mweatherstale_;	//< 气象数据时标未更新次数
+	MetricGauge* mweatherlag_;		//< 气象数据时标落后于本机时间的时长, 量纲: 秒
+	MetricHistogram* mlockclient_;	//< 等待互斥锁耗时: 客户端
+	MetricHistogram* mlockdome_;	//< 等待互斥锁耗时: 圆顶
+	boost::signals2::connection conncollect_;	//< 运行指标采集回调
+	MetricHistogram* mlatency_[STAGE_MAX];	//< 自动开关天窗指令各阶段时延
+	MetricHistogram* memergency_;	//< 危险风速数据写入至关闭指令交给操作系统的时延
+	MetricHistogram* mreaction_;	//< 快速通道: 读取危险风速数据至关闭指令交给操作系统的时延
+	MetricCounter* mpushed_;	//< 推送给订阅者的天窗状态数量
+	MetricCounter* mevicted_;	//< 因发送积压被断开的订阅者数量
+	MetricCounter* mretry_;		//< 重发天窗指令次数
+	MetricCounter* mescalate_;	//< 天窗指令失败次数
+	MetricCounter* msilent_;	//< 圆顶被标记为静默的次数
+	MetricCounter* midleclose_[2];	//< 因超时未收到信息而断开的连接数量. [PEER_CLIENT, PEER_DOME]
+	boost::mutex mtx_trace_;	//< 互斥锁: 时延追踪
+	SlitTraceBuff traces_;		//< 等待发送完成的时延追踪
+	long idtrace_;				//< 最后一次使用的追踪编号
+
+//////////////////////////////////////////////////////////////////////////////
+	/* 天窗状态快照 */
+	boost::atomic<uint64_t> verdome_;	//< 天窗状态版本. 在mtx_tcpc_dome_保护下, 任一天窗变化时递增
+	uint64_t versnap_;	//< 快照对应的天窗状态版本. 仅由消息队列线程访问
+	string snapshot_;	//< 已封装的全部天窗状态. 仅由消息队列线程访问
 
 //////////////////////////////////////////////////////////////////////////////
 	/* 多线程 */
 	threadptr thrd_weather_;	//< 线程: 监测气象环境参数
+	threadptr thrd_emergency_;	//< 线程: 危险风速快速通道
 
 public:
 	/*!
@@ -115,6 +217,8 @@ protected:
 	void on_receive_dome  (const long param1, const long param2);
 	void on_close_client  (const long param1, const long param2);
 	void on_close_dome    (const long param1, const long param2);
+	void on_slit_timeout  (const long param1, const long param2);
+	void on_idle_timeout  (const long param1, const long param2);
 	/*!
 	 * @brief 解析与用户/数据库、转台、相机相关网络信息
 	 * @param client 网络资源
@@ -134,6 +238,22 @@ protected:
 	 * @param client 网络资源
 	 */
 	void process_protocol_dome(apbase proto, TCPClient* client);
+	/*!
+	 * @brief 订阅或取消订阅天窗状态变化
+	 * @param client 网络资源
+	 * @param gid    组标志. 为空时对应全部天窗
+	 * @param on     true: 订阅; false: 取消订阅
+	 */
+	void subscribe(TCPClient* client, const string &gid, bool on);
+	/*!
+	 * @brief 向订阅者推送天窗状态变化
+	 * @param gid   组标志
+	 * @param state 新状态
+	 * @note
+	 * 状态只编码一次, 全部订阅者共用. 待发送数据超过SUB_MAX_PENDING的订阅者被断开连接,
+	 * 以免慢速客户端占用内存或收到不完整的信息
+	 */
+	void publish_state(const string &gid, int state);
 
 protected:
 //////////////////////////////////////////////////////////////////////////////
@@ -172,17 +292,66 @@ protected:
 	 * @param ec     错误代码. 0: 正确
 	 */
 	void receive_dome(const long client, const long ec);
+	/*!
+	 * @brief 按远程主机类型启动或重新启动空闲定时器
+	 * @param client 网络资源
+	 * @param peer   远程主机类型
+	 */
+	void arm_idle(TCPClient* client, int peer);
+	/*!
+	 * @brief 空闲定时器到期, 转由消息队列处理
+	 * @param client 网络资源
+	 */
+	void idle_expired(const long client);
 
 protected:
 	/*!
 	 * @brief 读取天窗开关判据(风速)
+	 * @param param     配置参数
 	 * @param tmloc     时标
 	 * @param spdopen   用于判断是否打开天窗的风速
 	 * @param spdclose  用于判断是否关闭天窗的风速
+	 * @param trace     时延追踪. 记录气象数据的写入与读取时间
 	 * @return
 	 * 数据读取结果
 	 */
-	bool read_weather(string &tmloc, double &spdopen, double &spdclose);
+	bool read_weather(ParamPtr param, string &tmloc, double &spdopen, double &spdclose, SlitTrace &trace);
+	/*!
+	 * @brief 取得配置参数访问地址
+	 * @return
+	 * 配置参数. 各线程在每轮处理开始时取得一份, 本轮内不受重新加载影响
+	 */
+	ParamPtr get_param();
+	/*!
+	 * @brief 替换配置参数访问地址
+	 * @param param 新的配置参数
+	 */
+	void set_param(ParamPtr param);
+	/*!
+	 * @brief 加载IERS闰秒文件, 更新天文时空接口的闰秒表
+	 * @param filepath 文件路径. 为空时使用内置闰秒表
+	 */
+	void load_leap_second(const string &filepath);
+	/*!
+	 * @brief 映射日出日落与晨昏时刻表, 并检查其测站位置是否与配置参数一致
+	 * @param filepath 文件路径
+	 * @param param    配置参数
+	 */
+	void load_almanac(const string &filepath, ParamPtr param);
+	/*!
+	 * @brief 按配置参数设置各子系统的日志级别
+	 * @param param 配置参数
+	 */
+	void apply_log_level(ParamPtr param);
+	/*!
+	 * @brief 注册运行指标
+	 */
+	void register_metrics();
+	/*!
+	 * @brief 采集回调: 输出各网络连接的收发字节数
+	 * @param output 以Prometheus文本格式追加的指标
+	 */
+	void collect_metrics(string &output);
 	/*!
 	 * @brief 计算太阳高度角
 	 * @return
@@ -191,12 +360,69 @@ protected:
 	double sun_altitude();
 	/*!
 	 * @brief 检查并改变天窗开关状态
+	 * @param param    配置参数
 	 * @param dome     圆顶资源访问地址
 	 * @param odt      观测时段类型
 	 * @param spdopen  用于判断是否可以打开天窗的风速判据
 	 * @param spdclo   用于判断是否需要关闭天窗的风速判据
+	 * @param trace    气象数据的时延追踪
+	 */
+	void switch_slit(ParamPtr param, DomeNetwork &dome, int odt, double spdopen, double spdclo, const SlitTrace &trace);
+	/*!
+	 * @brief 天窗指令已交给操作系统, 记录各阶段时延
+	 * @param client 网络资源
+	 * @param id     追踪编号
+	 */
+	void slit_written(const long client, const long id);
+	/*!
+	 * @brief 查看全部天窗状态快照
+	 * @return
+	 * 已封装的全部天窗状态
+	 * @note
+	 * 天窗状态版本未变化时直接返回上次封装结果, 因此轮询的客户端数量不增加封装开销
+	 */
+	const string &dome_snapshot();
+	/*!
+	 * @brief 开始跟踪已发出的天窗指令
+	 * @param dome 圆顶资源访问地址. 调用者需持有mtx_tcpc_dome_
+	 * @param cmd  指令
+	 * @note
+	 * 在cmdAckTimeout秒内天窗状态未转向指令目标时重发指令, 每次重发后等待时间加倍;
+	 * 重发cmdRetry次后仍未响应, 或开始动作后cmdMoveTimeout秒内未到位时, 判定指令失败
+	 */
+	void track_command(DomeNetwork &dome, int cmd);
+	/*!
+	 * @brief 天窗状态变化时更新指令跟踪
+	 * @param dome 圆顶资源访问地址. 调用者需持有mtx_tcpc_dome_
+	 */
+	void update_command(DomeNetwork &dome);
+	/*!
+	 * @brief 启动指令定时器
+	 * @param dome 圆顶资源访问地址. 调用者需持有mtx_tcpc_dome_
+	 * @param secs 时限, 量纲: 秒
+	 */
+	void arm_command_timer(DomeNetwork &dome, int secs);
+	/*!
+	 * @brief 指令定时器到期, 转由消息队列处理
+	 * @param client 网络资源
+	 * @param seq    定时器序号
+	 */
+	void handle_command_timer(const long client, const long seq, const boost::system::error_code& ec);
+	/*!
+	 * @brief 判定指令失败: 记录故障并停止跟踪
+	 * @param dome   圆顶资源访问地址. 调用者需持有mtx_tcpc_dome_
+	 * @param reason 原因
 	 */
-	void switch_slit(DomeNetwork &dome, int odt, double spdopen, double spdclo);
+	void escalate_command(DomeNetwork &dome, const char *reason);
+	/*!
+	 * @brief 危险风速快速通道: 立即关闭全部自动模式下已打开或正在打开的天窗
+	 * @param param  配置参数
+	 * @param spdclo 风速
+	 * @param trace  气象数据的时延追踪
+	 * @note
+	 * 在圆顶锁内仅登记追踪并取出预先封装的关闭指令, 释放锁后经紧急通道发送
+	 */
+	void emergency_close(ParamPtr param, double spdclo, const SlitTrace &trace);
 
 protected:
 	/* 多线程 */
@@ -204,6 +430,11 @@ protected:
 	 * @brief 监测气象环境参数
 	 */
 	void thread_weather();
+	/*!
+	 * @brief 危险风速快速通道: 以EMERGENCY_POLL为周期检查气象数据文件, 文件更新后立即读取,
+	 *        风速超过危险阈值时关闭天窗, 不等待气象监测周期
+	 */
+	void thread_emergency();
 };
 
 #endif /* GENERALCONTROL_H_ */
@@ -15,8 +15,12 @@ IOServiceKeep::IOServiceKeep() {
 }
 
 IOServiceKeep::~IOServiceKeep() {
+	stop();
+}
+
+void IOServiceKeep::stop() {
 	ios_.stop();
-	thrd_keep_->join();
+	if (thrd_keep_->joinable()) thrd_keep_->join();
 }
 
 io_service& IOServiceKeep::get_service() {
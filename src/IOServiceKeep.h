@@ -38,6 +38,12 @@ private:
 public:
 	// 属性函数
 	io_service& get_service();
+	/*!
+	 * @brief 停止io_service并等待线程退出
+	 * @note
+	 * 用于在析构依赖io_service的对象之前, 确保不再有回调函数被执行
+	 */
+	void stop();
 };
 
 #endif /* IOSERVICEKEEP_H_ */
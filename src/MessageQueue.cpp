@@ -8,11 +8,17 @@
 #include <boost/make_shared.hpp>
 #include "MessageQueue.h"
 #include "GLog.h"
+#include "FlightRecorder.h"
 
 #define MQFUNC_SIZE		1024
+#define MQ_BACKLOG		8		//< 待处理消息数量不小于该值时记录飞行记录器事件
 
 MessageQueue::MessageQueue() {
 	funcs_.reset(new CallbackFunc[MQFUNC_SIZE]);
+	mposted_  = NULL;
+	mhandled_ = NULL;
+	mdepth_   = NULL;
+	mhandle_  = NULL;
 }
 
 MessageQueue::~MessageQueue() {
@@ -29,14 +35,14 @@ bool MessageQueue::RegisterMessage(const long id, const CBSlot& slot) {
 void MessageQueue::PostMessage(const long id, const long p1, const long p2) {
 	if (mq_.unique()) {
 		MSG_UNIT msg(id, p1, p2);
-		mq_->send(&msg, sizeof(MSG_UNIT), 1);
+		send_message(msg, 1);
 	}
 }
 
 void MessageQueue::SendMessage(const long id, const long p1, const long p2) {
 	if (mq_.unique()) {
 		MSG_UNIT msg(id, p1, p2);
-		mq_->send(&msg, sizeof(MSG_UNIT), 10);
+		send_message(msg, 10);
 	}
 }
 
@@ -44,6 +50,11 @@ bool MessageQueue::Start(const char* name) {
 	if (thrdmsg_.unique()) return true;
 
 	try {
+		std::string labels = std::string("queue=\"") + name + "\"";
+		mposted_  = _gMetrics.Counter("annaes_mq_posted_total", "Messages posted to queue", labels);
+		mhandled_ = _gMetrics.Counter("annaes_mq_handled_total", "Messages handled by queue thread", labels);
+		mdepth_   = _gMetrics.Gauge("annaes_mq_depth", "Messages waiting in queue", labels);
+		mhandle_  = _gMetrics.Histogram("annaes_mq_handle_seconds", "Time spent in message handlers", labels, 1E-6);
 		message_queue::remove(name);
 		mq_.reset(new message_queue(boost::interprocess::create_only, name, 1024, sizeof(MSG_UNIT)));
 		thrdmsg_.reset(new boost::thread(boost::bind(&MessageQueue::thread_message, this)));
@@ -74,16 +85,28 @@ void MessageQueue::interrupt_thread(threadptr& thrd) {
 	}
 }
 
+void MessageQueue::send_message(const MSG_UNIT& msg, unsigned int priority) {
+	mdepth_->Add(1.0);
+	mq_->send(&msg, sizeof(MSG_UNIT), priority);
+	mposted_->Add();
+}
+
 void MessageQueue::thread_message() {
 	MSG_UNIT msg;
 	message_queue::size_type szrcv;
 	message_queue::size_type szmsg = sizeof(MSG_UNIT);
 	uint32_t priority;
 	long pos;
+	uint64_t t0;
 
 	do {
 		mq_->receive(&msg, szmsg, szrcv, priority);
+		mdepth_->Add(-1.0);
+		if (mdepth_->Value() >= MQ_BACKLOG) _gRecorder.Record(FRE_QUEUE, int(mdepth_->Value()), mposted_->Value());
+		t0 = Metrics::Now();
 		if ((pos = msg.id - MSG_USER) >= 0 && pos < MQFUNC_SIZE)
 			(funcs_[pos])(msg.par1, msg.par2);
+		mhandle_->Record(Metrics::Now() - t0);
+		mhandled_->Add();
 	} while(msg.id != MSG_QUIT);
 }
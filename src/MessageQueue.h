@@ -12,6 +12,7 @@
 #include <boost/smart_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/interprocess/ipc/message_queue.hpp>
+#include "Metrics.h"
 
 class MessageQueue {
 public:
@@ -64,6 +65,11 @@ protected:
 	msgqptr mq_;			//< 消息队列
 	cbfarray funcs_;		//< 回调函数
 	threadptr thrdmsg_;		//< 消息响应线程
+	/* 运行指标 */
+	MetricCounter* mposted_;	//< 已投递消息数量
+	MetricCounter* mhandled_;	//< 已处理消息数量
+	MetricGauge* mdepth_;		//< 队列中待处理消息数量
+	MetricHistogram* mhandle_;	//< 消息响应耗时, 量纲: 微秒
 
 public:
 	// 接口
@@ -108,6 +114,12 @@ protected:
 	 * @param thrd 线程指针
 	 */
 	void interrupt_thread(threadptr& thrd);
+	/*!
+	 * @brief 投递消息并更新运行指标
+	 * @param msg      消息单元
+	 * @param priority 优先级
+	 */
+	void send_message(const MSG_UNIT& msg, unsigned int priority);
 	/*!
 	 * @brief 线程, 监测/响应消息
 	 */
@@ -0,0 +1,399 @@
+/*
+ * @file Metrics.cpp 类Metrics的定义文件
+ * @version      0.1
+ * @date         2026年10月19日
+ */
+
+#include <time.h>
+#include <string.h>
+#include <stdio.h>
+#include <boost/bind.hpp>
+#include "Metrics.h"
+
+using std::string;
+using boost::asio::ip::tcp;
+
+/*!
+ * @brief 当前线程使用的分片
+ * @note
+ * 线程首次更新指标时按顺序分配分片, 使并发线程尽可能落在不同的缓存行
+ */
+static int shard_index() {
+	static boost::atomic<unsigned> next(0);
+	static thread_local int index = -1;
+
+	if (index < 0) index = next.fetch_add(1, boost::memory_order_relaxed) % METRIC_SHARDS;
+	return index;
+}
+
+static void append_value(string& output, double value) {
+	char buff[40];
+	snprintf(buff, sizeof(buff), "%.9g", value);
+	output += buff;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- MetricCounter ----------------*/
+MetricCounter::MetricCounter() {
+	for (int i = 0; i < METRIC_SHARDS; ++i) shards_[i].value = 0;
+}
+
+void MetricCounter::Add(uint64_t n) {
+	shards_[shard_index()].value.fetch_add(n, boost::memory_order_relaxed);
+}
+
+uint64_t MetricCounter::Value() const {
+	uint64_t sum(0);
+	for (int i = 0; i < METRIC_SHARDS; ++i) sum += shards_[i].value.load(boost::memory_order_relaxed);
+	return sum;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- MetricGauge ----------------*/
+MetricGauge::MetricGauge() {
+	Set(0.0);
+}
+
+void MetricGauge::Set(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bits_.store(bits, boost::memory_order_relaxed);
+}
+
+void MetricGauge::Add(double delta) {
+	uint64_t bits = bits_.load(boost::memory_order_relaxed), next;
+	double value;
+
+	do {
+		memcpy(&value, &bits, sizeof(value));
+		value += delta;
+		memcpy(&next, &value, sizeof(next));
+	} while (!bits_.compare_exchange_weak(bits, next, boost::memory_order_relaxed));
+}
+
+double MetricGauge::Value() const {
+	uint64_t bits = bits_.load(boost::memory_order_relaxed);
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- MetricHistogram ----------------*/
+MetricHistogram::MetricHistogram(double scale) {
+	scale_ = scale;
+	shards_.reset(new shard[METRIC_SHARDS]);
+	for (int i = 0; i < METRIC_SHARDS; ++i) {
+		for (int j = 0; j < METRIC_BUCKETS; ++j) shards_[i].count[j] = 0;
+		shards_[i].sum = 0;
+	}
+}
+
+int MetricHistogram::BucketOf(uint64_t value) {
+	if (value < (1ULL << METRIC_SUBBITS)) return int(value);
+
+	int e = 63 - __builtin_clzll(value);	// 最高有效位
+	int sub = int(value >> (e - METRIC_SUBBITS)) & ((1 << METRIC_SUBBITS) - 1);
+	return ((e - METRIC_SUBBITS + 1) << METRIC_SUBBITS) + sub;
+}
+
+uint64_t MetricHistogram::BucketUpper(int bucket) {
+	if (bucket < (1 << METRIC_SUBBITS)) return uint64_t(bucket);
+
+	int e = (bucket >> METRIC_SUBBITS) + METRIC_SUBBITS - 1;
+	uint64_t sub   = bucket & ((1 << METRIC_SUBBITS) - 1);
+	uint64_t width = 1ULL << (e - METRIC_SUBBITS);
+	return (((1ULL << METRIC_SUBBITS) + sub) << (e - METRIC_SUBBITS)) + (width - 1);
+}
+
+void MetricHistogram::Record(uint64_t value) {
+	shard& s = shards_[shard_index()];
+	s.count[BucketOf(value)].fetch_add(1, boost::memory_order_relaxed);
+	s.sum.fetch_add(value, boost::memory_order_relaxed);
+}
+
+uint64_t MetricHistogram::Snapshot(std::vector<uint64_t>& counts, uint64_t& sum) const {
+	uint64_t total(0), n;
+
+	counts.assign(METRIC_BUCKETS, 0);
+	sum = 0;
+	for (int i = 0; i < METRIC_SHARDS; ++i) {
+		for (int j = 0; j < METRIC_BUCKETS; ++j) {
+			if ((n = shards_[i].count[j].load(boost::memory_order_relaxed))) {
+				counts[j] += n;
+				total     += n;
+			}
+		}
+		sum += shards_[i].sum.load(boost::memory_order_relaxed);
+	}
+	return total;
+}
+
+double MetricHistogram::Percentile(double q) const {
+	std::vector<uint64_t> counts;
+	uint64_t sum, total = Snapshot(counts, sum), rank, cumulated(0);
+
+	if (!total) return 0.0;
+	if (q < 0.0) q = 0.0;
+	else if (q > 1.0) q = 1.0;
+	if ((rank = uint64_t(q * total + 0.5)) < 1) rank = 1;
+	for (int i = 0; i < METRIC_BUCKETS; ++i) {
+		if ((cumulated += counts[i]) >= rank) return BucketUpper(i) * scale_;
+	}
+	return BucketUpper(METRIC_BUCKETS - 1) * scale_;
+}
+
+double MetricHistogram::Scale() const {
+	return scale_;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- Metrics ----------------*/
+struct Metrics::http_session {
+	tcp::socket sock;
+	boost::asio::streambuf request;
+	boost::asio::deadline_timer timer;	//< 连接时限
+	string response;
+
+public:
+	http_session(boost::asio::io_service& ios)
+		: sock(ios), request(METRIC_HTTP_REQUEST), timer(ios) {
+	}
+};
+
+Metrics::Metrics() {
+}
+
+Metrics::~Metrics() {
+	StopServer();
+}
+
+uint64_t Metrics::Now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+Metrics::entryptr Metrics::lookup(int type, const string& name, const string& help, const string& labels) {
+	mutex_lock lck(mtx_);
+	for (std::vector<entryptr>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+		if ((*it)->type == type && (*it)->name == name && (*it)->labels == labels) return *it;
+	}
+
+	entryptr entry = boost::make_shared<metric_entry>();
+	entry->type   = type;
+	entry->name   = name;
+	entry->help   = help;
+	entry->labels = labels;
+	entries_.push_back(entry);
+	return entry;
+}
+
+MetricCounter* Metrics::Counter(const string& name, const string& help, const string& labels) {
+	entryptr entry = lookup(METRIC_COUNTER, name, help, labels);
+	mutex_lock lck(mtx_);
+	if (!entry->counter) entry->counter = boost::make_shared<MetricCounter>();
+	return entry->counter.get();
+}
+
+MetricGauge* Metrics::Gauge(const string& name, const string& help, const string& labels) {
+	entryptr entry = lookup(METRIC_GAUGE, name, help, labels);
+	mutex_lock lck(mtx_);
+	if (!entry->gauge) entry->gauge = boost::make_shared<MetricGauge>();
+	return entry->gauge.get();
+}
+
+MetricHistogram* Metrics::Histogram(const string& name, const string& help, const string& labels, double scale) {
+	entryptr entry = lookup(METRIC_HISTOGRAM, name, help, labels);
+	mutex_lock lck(mtx_);
+	if (!entry->histogram) entry->histogram = boost::make_shared<MetricHistogram>(scale);
+	return entry->histogram.get();
+}
+
+boost::signals2::connection Metrics::RegisterCollect(const CBSlot& slot) {
+	return collect_.connect(slot);
+}
+
+void Metrics::format_entry(const entryptr& entry, string& output) {
+	const string& name = entry->name;
+	const string& labels = entry->labels;
+
+	if (entry->type == METRIC_COUNTER || entry->type == METRIC_GAUGE) {
+		output += name;
+		if (!labels.empty()) output += "{" + labels + "}";
+		output += " ";
+		if (entry->type == METRIC_COUNTER) append_value(output, double(entry->counter->Value()));
+		else append_value(output, entry->gauge->Value());
+		output += "\n";
+	}
+	else {// 直方图: 以2的幂为界输出累计数量
+		MetricHistogram* hist = entry->histogram.get();
+		std::vector<uint64_t> counts;
+		uint64_t sum, total = hist->Snapshot(counts, sum), cumulated(0);
+		string prefix = name + "_bucket{" + labels + (labels.empty() ? "" : ",") + "le=\"";
+		int i, k, last(METRIC_BUCKETS - 1);
+
+		for (; last > 0 && !counts[last]; --last);
+		// 桶BucketOf(2^k)之前的记录值均小于2^k. Prometheus的le为闭区间, 以这些桶的上限2^k-1(含)标记
+		for (k = 0, i = 0; k < 64; ++k) {
+			int upto = MetricHistogram::BucketOf(1ULL << k);
+			for (; i < upto; ++i) cumulated += counts[i];
+			output += prefix;
+			append_value(output, double(MetricHistogram::BucketUpper(upto - 1)) * hist->Scale());
+			output += "\"} ";
+			append_value(output, double(cumulated));
+			output += "\n";
+			if (upto > last) break;
+		}
+		output += prefix + "+Inf\"} ";
+		append_value(output, double(total));
+		output += "\n";
+
+		output += name + "_sum";
+		if (!labels.empty()) output += "{" + labels + "}";
+		output += " ";
+		append_value(output, sum * hist->Scale());
+		output += "\n";
+		output += name + "_count";
+		if (!labels.empty()) output += "{" + labels + "}";
+		output += " ";
+		append_value(output, double(total));
+		output += "\n";
+	}
+}
+
+string Metrics::Exposition() {
+	const char* types[] = {"counter", "gauge", "histogram"};
+	std::vector<entryptr> entries;
+	std::vector<bool> done;
+	string output;
+
+	{// 复制注册表, 避免采集时阻塞注册
+		mutex_lock lck(mtx_);
+		entries = entries_;
+	}
+	done.assign(entries.size(), false);
+	// 同名指标连续输出, 共用HELP与TYPE
+	for (std::size_t i = 0; i < entries.size(); ++i) {
+		if (done[i]) continue;
+		output += "# HELP " + entries[i]->name + " " + entries[i]->help + "\n";
+		output += "# TYPE " + entries[i]->name + " " + types[entries[i]->type] + "\n";
+		for (std::size_t j = i; j < entries.size(); ++j) {
+			if (!done[j] && entries[j]->name == entries[i]->name) {
+				format_entry(entries[j], output);
+				done[j] = true;
+			}
+		}
+	}
+	collect_(output);
+
+	return output;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- HTTP导出服务 ----------------*/
+int Metrics::StartServer(const string& address, const uint16_t port) {
+	if (acceptor_.unique()) return 0;
+
+	try {
+		keep_ = boost::make_shared<IOServiceKeep>();
+		tcp::endpoint endpoint(boost::asio::ip::address::from_string(address), port);
+		acceptor_.reset(new tcp::acceptor(keep_->get_service()));
+		acceptor_->open(endpoint.protocol());
+		acceptor_->set_option(tcp::acceptor::reuse_address(true));
+		acceptor_->bind(endpoint);
+		acceptor_->listen();
+		tmaccept_.reset(new boost::asio::deadline_timer(keep_->get_service()));
+		start_accept();
+		return 0;
+	}
+	catch(boost::system::system_error& ex) {
+		acceptor_.reset();
+		tmaccept_.reset();
+		keep_.reset();
+		return ex.code().value();
+	}
+}
+
+void Metrics::StopServer() {
+	if (keep_.unique()) {
+		keep_->stop();
+		acceptor_.reset();
+		tmaccept_.reset();
+		keep_.reset();
+	}
+}
+
+void Metrics::start_accept() {
+	sessionptr session(new http_session(keep_->get_service()));
+	acceptor_->async_accept(session->sock,
+			boost::bind(&Metrics::handle_accept, this, session, boost::asio::placeholders::error));
+}
+
+void Metrics::handle_accept(sessionptr session, const boost::system::error_code& ec) {
+	if (ec == boost::asio::error::operation_aborted) return;
+	if (ec) {// 例如文件描述符耗尽: 延时后再等待连接, 避免空转
+		boost::system::error_code ec1;
+		tmaccept_->expires_from_now(boost::posix_time::seconds(METRIC_ACCEPT_RETRY), ec1);
+		tmaccept_->async_wait(boost::bind(&Metrics::handle_retry, this, boost::asio::placeholders::error));
+		return;
+	}
+
+	boost::system::error_code ec1;
+	session->timer.expires_from_now(boost::posix_time::seconds(METRIC_HTTP_TIMEOUT), ec1);
+	session->timer.async_wait(boost::bind(&Metrics::handle_timeout, this, session, boost::asio::placeholders::error));
+	boost::asio::async_read_until(session->sock, session->request, "\r\n\r\n",
+			boost::bind(&Metrics::handle_request, this, session,
+					boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+	start_accept();
+}
+
+void Metrics::handle_retry(const boost::system::error_code& ec) {
+	if (!ec) start_accept();
+}
+
+void Metrics::handle_timeout(sessionptr session, const boost::system::error_code& ec) {
+	if (ec == boost::asio::error::operation_aborted) return;
+	boost::system::error_code ec1;
+	session->sock.close(ec1);
+}
+
+void Metrics::handle_request(sessionptr session, const boost::system::error_code& ec, std::size_t) {
+	if (ec) {// 请求头超长、对方断开或已超时
+		boost::system::error_code ec1;
+		session->timer.cancel(ec1);
+		return;
+	}
+
+	std::istream is(&session->request);
+	string method, path, body, status;
+	is >> method >> path;
+	if (method != "GET") {
+		status = "405 Method Not Allowed";
+		body   = "only GET is supported\n";
+	}
+	else if (path != "/" && path != "/metrics") {
+		status = "404 Not Found";
+		body   = "metrics are served on /metrics\n";
+	}
+	else {
+		status = "200 OK";
+		body   = Exposition();
+	}
+
+	char head[200];
+	snprintf(head, sizeof(head), "HTTP/1.0 %s\r\n"
+			"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+			"Content-Length: %lu\r\n"
+			"Connection: close\r\n\r\n", status.c_str(), (unsigned long) body.size());
+	session->response = head + body;
+	boost::asio::async_write(session->sock, boost::asio::buffer(session->response),
+			boost::bind(&Metrics::handle_write, this, session, boost::asio::placeholders::error));
+}
+
+void Metrics::handle_write(sessionptr session, const boost::system::error_code& ec) {
+	boost::system::error_code ec1;
+	session->timer.cancel(ec1);
+	if (!ec) session->sock.shutdown(tcp::socket::shutdown_both, ec1);
+	session->sock.close(ec1);
+}
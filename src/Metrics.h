@@ -0,0 +1,300 @@
+/*
+ * @file Metrics.h  类Metrics声明文件
+ * @description  进程内运行指标: 计数器、测量值和直方图, 并以Prometheus文本格式对外提供
+ * @version      0.1
+ * @date         2026年10月19日
+ * @note
+ * (1) 计数器与直方图按线程分片累加, 各分片独占缓存行. 更新仅需一次relaxed原子加法, 不加锁
+ * (2) 直方图采用HDR风格的对数-线性分桶: 每个2的幂区间等分为2^METRIC_SUBBITS个子区间,
+ *     相对误差不超过1/2^METRIC_SUBBITS. 记录值为非负整数(如微秒), 导出时乘以换算系数
+ * (3) 指标对象由注册表持有, 注册后地址不变. 调用方在初始化时保存指针, 此后直接更新
+ * (4) 以名称和标签区分指标. 同名指标构成一族, 导出时共用HELP与TYPE
+ * (5) 采集回调在导出时被调用, 用于输出数量可变的指标(如每个网络连接的收发字节数)
+ * (6) 内置HTTP服务仅响应GET请求, 返回全部指标. 缺省仅监听本机地址.
+ *     请求头长度不超过METRIC_HTTP_REQUEST, 连接在METRIC_HTTP_TIMEOUT秒后强制关闭
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/signals2.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include "IOServiceKeep.h"
+
+#define METRIC_SHARDS	8	//< 计数器与直方图的分片数量
+#define METRIC_SUBBITS	3	//< 直方图: 每个2的幂区间的子区间数量为2^METRIC_SUBBITS
+#define METRIC_BUCKETS	((64 - METRIC_SUBBITS + 1) << METRIC_SUBBITS)	//< 直方图: 覆盖64位整数的分桶数量
+#define METRIC_LINE		64	//< 缓存行长度, 量纲: 字节
+#define METRIC_HTTP_REQUEST	8192	//< HTTP请求头的最大长度, 量纲: 字节
+#define METRIC_HTTP_TIMEOUT	10		//< HTTP连接的最长时间, 量纲: 秒
+#define METRIC_ACCEPT_RETRY	1		//< 接受连接出错后重新等待连接的延时, 量纲: 秒
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- MetricCounter: 单调递增计数器 ----------------*/
+class MetricCounter {
+public:
+	MetricCounter();
+
+protected:
+	struct shard {// 分片, 独占缓存行
+		boost::atomic<uint64_t> value;
+		char pad[METRIC_LINE - sizeof(boost::atomic<uint64_t>)];
+	};
+	shard shards_[METRIC_SHARDS];
+
+public:
+	/*!
+	 * @brief 累加计数
+	 * @param n 增量
+	 */
+	void Add(uint64_t n = 1);
+	/*!
+	 * @brief 查看计数
+	 * @return
+	 * 各分片计数之和
+	 */
+	uint64_t Value() const;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- MetricGauge: 可增可减的测量值 ----------------*/
+class MetricGauge {
+public:
+	MetricGauge();
+
+protected:
+	boost::atomic<uint64_t> bits_;	//< 以整数形式保存的双精度值
+
+public:
+	/*!
+	 * @brief 设置测量值
+	 */
+	void Set(double value);
+	/*!
+	 * @brief 累加测量值
+	 */
+	void Add(double delta);
+	/*!
+	 * @brief 查看测量值
+	 */
+	double Value() const;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- MetricHistogram: 对数-线性分桶直方图 ----------------*/
+class MetricHistogram {
+public:
+	/*!
+	 * @brief 构造函数
+	 * @param scale 导出时的换算系数. 例如记录值为微秒, 以秒导出时为1E-6
+	 */
+	MetricHistogram(double scale = 1.0);
+
+protected:
+	struct shard {// 分片
+		boost::atomic<uint64_t> count[METRIC_BUCKETS];	//< 各桶的记录数量
+		boost::atomic<uint64_t> sum;	//< 记录值之和
+		char pad[METRIC_LINE];
+	};
+
+	double scale_;	//< 换算系数
+	boost::scoped_array<shard> shards_;	//< 分片
+
+public:
+	/*!
+	 * @brief 记录一个值
+	 * @param value 记录值
+	 */
+	void Record(uint64_t value);
+	/*!
+	 * @brief 合并各分片
+	 * @param counts 各桶的记录数量, 长度为METRIC_BUCKETS
+	 * @param sum    记录值之和
+	 * @return
+	 * 记录总数
+	 */
+	uint64_t Snapshot(std::vector<uint64_t>& counts, uint64_t& sum) const;
+	/*!
+	 * @brief 估计分位数
+	 * @param q 分位, 0~1
+	 * @return
+	 * 分位数所在桶的上限, 已乘以换算系数. 无记录时返回0
+	 */
+	double Percentile(double q) const;
+	/*!
+	 * @brief 查看换算系数
+	 */
+	double Scale() const;
+	/*!
+	 * @brief 计算记录值所在的桶
+	 */
+	static int BucketOf(uint64_t value);
+	/*!
+	 * @brief 计算桶的上限(含)
+	 */
+	static uint64_t BucketUpper(int bucket);
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/*---------------- Metrics: 指标注册表与导出服务 ----------------*/
+class Metrics {
+public:
+	Metrics();
+	virtual ~Metrics();
+
+public:
+	/* 数据类型 */
+	enum METRIC_TYPE {// 指标类型
+		METRIC_COUNTER,
+		METRIC_GAUGE,
+		METRIC_HISTOGRAM
+	};
+
+	/*!
+	 * 采集回调函数类型. 在导出时被调用, 以Prometheus文本格式追加指标
+	 */
+	typedef boost::signals2::signal<void (std::string&)> CollectFunc;
+	typedef CollectFunc::slot_type CBSlot;
+	typedef boost::unique_lock<boost::mutex> mutex_lock;	//< 互斥锁
+
+protected:
+	struct metric_entry {// 已注册指标
+		int type;			//< 指标类型
+		std::string name;	//< 名称
+		std::string help;	//< 说明
+		std::string labels;	//< 标签, 格式: key="value",key="value"
+		boost::shared_ptr<MetricCounter> counter;
+		boost::shared_ptr<MetricGauge> gauge;
+		boost::shared_ptr<MetricHistogram> histogram;
+	};
+	typedef boost::shared_ptr<metric_entry> entryptr;
+
+	struct http_session;	//< HTTP连接
+	typedef boost::shared_ptr<http_session> sessionptr;
+
+protected:
+	boost::mutex mtx_;		//< 互斥锁: 注册表
+	std::vector<entryptr> entries_;	//< 已注册指标, 按注册顺序排列
+	CollectFunc collect_;	//< 采集回调函数
+	/* 导出服务 */
+	boost::shared_ptr<IOServiceKeep> keep_;	//< 提供io_service对象
+	boost::shared_ptr<boost::asio::ip::tcp::acceptor> acceptor_;	//< 服务套接口
+	boost::shared_ptr<boost::asio::deadline_timer> tmaccept_;		//< 接受连接出错后的退避定时器
+
+public:
+	/*!
+	 * @brief 注册或查找计数器
+	 * @param name   名称. 按Prometheus约定, 计数器以_total结尾
+	 * @param help   说明
+	 * @param labels 标签, 格式: key="value",key="value"
+	 * @return
+	 * 计数器地址. 在注册表生命周期内有效
+	 */
+	MetricCounter* Counter(const std::string& name, const std::string& help, const std::string& labels = "");
+	/*!
+	 * @brief 注册或查找测量值
+	 */
+	MetricGauge* Gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+	/*!
+	 * @brief 注册或查找直方图
+	 * @param scale 导出时的换算系数. 仅在首次注册时有效
+	 */
+	MetricHistogram* Histogram(const std::string& name, const std::string& help, const std::string& labels = "",
+			double scale = 1.0);
+	/*!
+	 * @brief 注册采集回调函数
+	 * @param slot 函数插槽
+	 * @return
+	 * 连接对象. 对象析构前应断开连接
+	 */
+	boost::signals2::connection RegisterCollect(const CBSlot& slot);
+	/*!
+	 * @brief 以Prometheus文本格式输出全部指标
+	 */
+	std::string Exposition();
+	/*!
+	 * @brief 启动HTTP导出服务
+	 * @param address 监听地址
+	 * @param port    监听端口
+	 * @return
+	 * 0 -- 成功
+	 * 其它 -- 错误代码
+	 */
+	int StartServer(const std::string& address, const uint16_t port);
+	/*!
+	 * @brief 停止HTTP导出服务
+	 */
+	void StopServer();
+	/*!
+	 * @brief 查看单调时钟
+	 * @return
+	 * 单调时钟, 量纲: 微秒
+	 */
+	static uint64_t Now();
+
+protected:
+	/*!
+	 * @brief 查找或创建指标
+	 */
+	entryptr lookup(int type, const std::string& name, const std::string& help, const std::string& labels);
+	/*!
+	 * @brief 输出单个指标
+	 */
+	void format_entry(const entryptr& entry, std::string& output);
+	/*!
+	 * @brief 等待HTTP连接
+	 */
+	void start_accept();
+	/*!
+	 * @brief 处理HTTP连接
+	 */
+	void handle_accept(sessionptr session, const boost::system::error_code& ec);
+	/*!
+	 * @brief 接受连接出错后的延时结束, 重新等待连接
+	 */
+	void handle_retry(const boost::system::error_code& ec);
+	/*!
+	 * @brief HTTP连接超时, 关闭连接
+	 */
+	void handle_timeout(sessionptr session, const boost::system::error_code& ec);
+	/*!
+	 * @brief 处理HTTP请求
+	 */
+	void handle_request(sessionptr session, const boost::system::error_code& ec, std::size_t);
+	/*!
+	 * @brief 应答发送完毕, 关闭连接
+	 */
+	void handle_write(sessionptr session, const boost::system::error_code& ec);
+};
+
+extern Metrics _gMetrics;	//< 运行指标
+
+//////////////////////////////////////////////////////////////////////////////
+/*!
+ * @class MetricTimedLock 加锁并记录等待时间
+ * @note
+ * 在构造函数中加锁, 等待时间以微秒计入直方图; 析构时解锁
+ */
+class MetricTimedLock {
+public:
+	MetricTimedLock(boost::mutex& mtx, MetricHistogram* hist)
+		: lck_(mtx, boost::defer_lock) {
+		if (lck_.try_lock()) {
+			if (hist) hist->Record(0);
+		}
+		else {
+			uint64_t t0 = Metrics::Now();
+			lck_.lock();
+			if (hist) hist->Record(Metrics::Now() - t0);
+		}
+	}
+
+protected:
+	boost::unique_lock<boost::mutex> lck_;
+};
+
+#endif /* METRICS_H_ */
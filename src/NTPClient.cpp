@@ -8,201 +8,438 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include <algorithm>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+#include <sys/timex.h>
+#endif
 #include <boost/make_shared.hpp>
+#include <boost/bind.hpp>
+#include <boost/algorithm/string.hpp>
 #include "NTPClient.h"
 #include "GLog.h"
 
 #define JAN_1970			0x83AA7E80
-#define NTP_PCK_LEN		48
-
-#define NTPFRAC(x)	(4294 * (x) + ((1981 * (x)) >> 11))
-#define USEC(x)		(((x) >> 12) - 759 * ((((x) >> 10) + 32768) >> 16))
 
 #define LI			0
-#define VN			3
+#define VN			4
 #define MODE			3
 #define STRATUM		0
 #define POLL			4
 #define PREC			-6
-#define UINTMAX		4294967295.0
+#define FRAC32		4294967296.0
+
+using namespace boost::asio;
+using namespace boost::posix_time;
 
 NTPPtr make_ntp(const char* hostIP, const uint16_t port, const int tSync) {
 	return boost::make_shared<NTPClient>(hostIP, port, tSync);
 }
 
+/* 读取网络字节序的NTP时标 */
+static double ntp_timestamp(const unsigned char *data) {
+	uint32_t coarse, fine;
+	memcpy(&coarse, data, 4);
+	memcpy(&fine, data + 4, 4);
+	return ntohl(coarse) + ntohl(fine) / FRAC32;
+}
+
 NTPClient::NTPClient(const char* hostIP, const uint16_t port, const int tSync) {
 	host_ = hostIP;
 	port_ = port;
-	sock_ = -1;
+	reset_ = true;
 	tSync_ = tSync * 0.001;
-	pack_.reset(new char[NTP_PCK_LEN * 8]);
 	offset_ = 0.0;
+	delay_  = 0.0;
 	valid_  = false;
-	nfail_  = 0;
 	autoSync_ = false;
-	thrd_.reset(new boost::thread(boost::bind(&NTPClient::thread_body, this)));;
+	discipline_ = false;
+	tPanic_   = 1.0;
+	filtered_ = 0.0;
+	freq_     = 0.0;
+	adjfail_  = false;
+	window_.set_capacity(NTP_FILTER);
+	mquery_   = _gMetrics.Counter("annaes_ntp_queries_total",  "NTP requests sent");
+	mreply_   = _gMetrics.Counter("annaes_ntp_replies_total",  "Valid NTP replies received");
+	mtimeout_ = _gMetrics.Counter("annaes_ntp_timeouts_total", "NTP requests without reply");
+	mfail_    = _gMetrics.Counter("annaes_ntp_failures_total", "NTP requests failed to send or with invalid reply");
+	moffset_  = _gMetrics.Gauge("annaes_ntp_offset_seconds", "Selected clock offset. NTP time minus local time");
+	mdelay_   = _gMetrics.Gauge("annaes_ntp_delay_seconds",  "Round trip delay of selected clock offset");
+	mfreq_    = _gMetrics.Gauge("annaes_ntp_frequency_ppm",  "Frequency correction of local clock in discipline mode");
+	mvalid_   = _gMetrics.Gauge("annaes_ntp_valid",          "Selected clock offset is valid");
+	mrtt_     = _gMetrics.Histogram("annaes_ntp_rtt_seconds", "Round trip delay of NTP replies", "", 1E-6);
+	tmpoll_.reset(new deadline_timer(keep_.get_service()));
+	tmround_.reset(new deadline_timer(keep_.get_service()));
+	// 启动后首先查询一次
+	tmpoll_->expires_from_now(seconds(1));
+	tmpoll_->async_wait(boost::bind(&NTPClient::handle_poll, this, placeholders::error));
 }
 
 NTPClient::~NTPClient() {
-	if (thrd_.unique()) {
-		thrd_->interrupt();
-		thrd_->join();
-	}
-	if (sock_ >= 0) close(sock_);
+	// 先停止异步操作, 再释放套接字和定时器
+	keep_.stop();
+	servers_.clear();
+	tmpoll_.reset();
+	tmround_.reset();
 }
 
 void NTPClient::SetHost(const char* ip, const uint16_t port) {
 	mutex_lock lock(mtx_);
 	host_ = ip;
 	port_ = port;
-	if (sock_ >= 0) {
-		close(sock_);
-		sock_ = -1;
-	}
+	reset_ = true;
 }
 
 void NTPClient::SetSyncLimit(const int tSync) {
 	tSync_ = tSync * 0.001;
 }
 
-void NTPClient::SynchClock() {
-	if (valid_ && (offset_ >= tSync_ || offset_ <= -tSync_)) {
-		struct timeval  tv;
-		double t;
+bool NTPClient::GetOffset(double& offset, double& delay) {
+	mutex_lock lock(mtx_);
+	offset = offset_;
+	delay  = delay_;
+	return valid_;
+}
 
-		gettimeofday(&tv, NULL);
-		t = tv.tv_sec + tv.tv_usec * 1E-6 + offset_;
-		tv.tv_sec = (time_t) t;
-		tv.tv_usec= (suseconds_t) ((t - tv.tv_sec) * 1E6);
-		settimeofday(&tv, NULL);
+bool NTPClient::GetDiscipline(double& offset, double& freq) {
+	mutex_lock lock(mtx_);
+	offset = filtered_;
+	freq   = freq_ * 1E6;
+	return discipline_;
+}
 
-		valid_ = false;
+void NTPClient::EnableDiscipline(bool enabled, const int tPanic) {
+	mutex_lock lock(mtx_);
+	discipline_ = enabled;
+	tPanic_     = tPanic * 0.001;
+	window_.clear();
+#ifdef __linux__
+	if (enabled) {// 沿用内核中已有的频率修正量
+		struct timex tx;
+		memset(&tx, 0, sizeof(tx));
+		if (adjtimex(&tx) >= 0) freq_ = tx.freq / 65536.0 * 1E-6;
 	}
+#endif
 }
 
-void NTPClient::thread_body() {
-	boost::chrono::minutes duration(1);
-	struct addrinfo *res = NULL;
-	struct ntp_packet pack;
+void NTPClient::SynchClock() {
+	mutex_lock lock(mtx_);
+	if (valid_ && (offset_ >= tSync_ || offset_ <= -tSync_)) step_clock(offset_);
+}
+
+void NTPClient::step_clock(double offset) {
 	struct timeval  tv;
-	double t1, t2, t3, t4, delay;
-	unsigned char *id;
-
-	while (1) {
-		boost::this_thread::sleep_for(duration);
-
-		if (sock_ < 0) {// 尝试建立网络连接
-			mutex_lock lock(mtx_);
-			char portstr[10];
-			struct addrinfo addr;
-
-			sprintf(portstr, "%d", port_);
-			memset(&addr, 0, sizeof(addr));
-			addr.ai_family   = AF_UNSPEC;
-			addr.ai_socktype = SOCK_DGRAM;
-			addr.ai_protocol = IPPROTO_UDP;
-			if (getaddrinfo(host_.c_str(), portstr, &addr, &res)
-					|| ((sock_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) < 0)) {
-				continue;
-			}
-		}
+	double t;
 
-		if (get_time(res, &pack)) {
-			gettimeofday(&tv, NULL);
-			t1 = pack.originate_timestamp.coarse + (double) pack.originate_timestamp.fine / UINTMAX;
-			t2 = pack.receive_timestamp.coarse   + (double) pack.receive_timestamp.fine   / UINTMAX;
-			t3 = pack.transmit_timestamp.coarse  + (double) pack.transmit_timestamp.fine  / UINTMAX;
-			t4 = JAN_1970 + tv.tv_sec + tv.tv_usec * 1E-6;
-
-			offset_ = ((t2 - t1) + (t3 - t4)) * 0.5;
-			delay   = (t4 - t1) - (t3 - t2);
-			valid_  = delay < 1E-3;
-
-			if (offset_ >= tSync_ || offset_ <= -tSync_) {
-				if (autoSync_) SynchClock();
-				id = pack.reference_identifier;
-				_gLog.Write(LOG_WARN, NULL, "Clock drifts %.6f seconds. RefSrc=%c%c%c%c. delay=%.3f msecs",
-						offset_, id[0], id[1], id[2], id[3], delay * 1000);
-			}
+	gettimeofday(&tv, NULL);
+	t = tv.tv_sec + tv.tv_usec * 1E-6 + offset;
+	tv.tv_sec = (time_t) t;
+	tv.tv_usec= (suseconds_t) ((t - tv.tv_sec) * 1E6);
+	settimeofday(&tv, NULL);
+
+	// 时钟已改变, 历史采样失效
+	for (servervec::iterator it = servers_.begin(); it != servers_.end(); ++it) (*it)->samples.clear();
+	window_.clear();
+	valid_ = false;
+}
+
+void NTPClient::shift_samples(double offset) {
+	for (servervec::iterator it = servers_.begin(); it != servers_.end(); ++it) {
+		samplebuff &samples = (*it)->samples;
+		for (samplebuff::iterator x = samples.begin(); x != samples.end(); ++x) x->offset -= offset;
+	}
+	for (samplebuff::iterator x = window_.begin(); x != window_.end(); ++x) x->offset -= offset;
+	offset_ -= offset;
+}
+
+bool NTPClient::set_frequency(double freq) {
+#ifdef __linux__
+	struct timex tx;
+	memset(&tx, 0, sizeof(tx));
+	tx.modes = ADJ_FREQUENCY;
+	tx.freq  = long(freq * 1E6 * 65536.0);
+	return adjtimex(&tx) >= 0;
+#else
+	return false;
+#endif
+}
+
+void NTPClient::discipline() {
+	mutex_lock lock(mtx_);
+	ntp_sample sample;
+	std::vector<double> offsets;
+
+	sample.offset = offset_;
+	sample.delay  = delay_;
+	sample.tloc   = local_time();
+	window_.push_back(sample);
+	for (samplebuff::iterator x = window_.begin(); x != window_.end(); ++x) offsets.push_back(x->offset);
+	std::nth_element(offsets.begin(), offsets.begin() + offsets.size() / 2, offsets.end());
+	filtered_ = offsets[offsets.size() / 2];
+
+	if (fabs(filtered_) >= tSync_) {
+		GLOG_RECORD_CAT(LOGC_NTP, LOG_WARN, NULL, "Clock drifts %.6f seconds. Server=%s. delay=%.3f msecs",
+				filtered_, source_, delay_ * 1000);
+	}
+	if (!autoSync_) return;
+	if (fabs(filtered_) >= tPanic_) {
+		_gLog.Write(LOG_WARN, NULL, "Clock offset %.6f seconds exceeds panic threshold. Step clock", filtered_);
+		step_clock(filtered_);
+		return;
+	}
+
+	// 比例-积分: 相位偏差由adjtime()在下一周期内修正, 其积分修正频率
+	// 相位限制在一个周期可完成的修正量之内, 避免大偏差使频率积分过冲
+	const double slewmax = NTP_SLEW_MAX * NTP_PERIOD;
+	double phase = filtered_ > slewmax ? slewmax : (filtered_ < -slewmax ? -slewmax : filtered_);
+	double freq  = freq_ + phase / (NTP_PERIOD * NTP_FREQ_GAIN);
+	struct timeval tv, olddelta;
+
+	if (freq > NTP_FREQ_MAX) freq = NTP_FREQ_MAX;
+	else if (freq < -NTP_FREQ_MAX) freq = -NTP_FREQ_MAX;
+	if (set_frequency(freq)) {
+		freq_ = freq;
+		mfreq_->Set(freq_ * 1E6);
+	}
+	else {// 无法设置频率时, 将频率修正并入相位
+		phase += (freq - freq_) * NTP_PERIOD;
+		if (phase > slewmax) phase = slewmax;
+		else if (phase < -slewmax) phase = -slewmax;
+	}
+	tv.tv_sec  = (time_t) floor(phase);
+	tv.tv_usec = (suseconds_t) ((phase - tv.tv_sec) * 1E6);
+	if (adjtime(&tv, &olddelta)) {
+		if (!adjfail_) _gLog.Write(LOG_WARN, "NTPClient::adjtime", strerror(errno));
+		adjfail_ = true;
+		return;
+	}
+	adjfail_ = false;
+	// 上一周期未完成的修正量被本次调用取消, 历史采样不应计入该部分
+	double applied = phase - (olddelta.tv_sec + olddelta.tv_usec * 1E-6);
+	shift_samples(applied);
+	filtered_ -= applied;
+}
+
+void NTPClient::EnableAutoSynch(bool bEnabled) {
+	autoSync_ = bEnabled;
+}
+
+double NTPClient::local_time() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return JAN_1970 + tv.tv_sec + tv.tv_usec * 1E-6;
+}
+
+void NTPClient::create_servers() {
+	std::vector<std::string> hosts;
+	std::string::size_type pos;
+
+	for (servervec::iterator it = servers_.begin(); it != servers_.end(); ++it) {
+		boost::system::error_code ec;
+		(*it)->tmout->cancel(ec);
+		if ((*it)->sock->is_open()) (*it)->sock->close(ec);
+	}
+	servers_.clear();
+
+	boost::split(hosts, host_, boost::is_any_of(", ;"), boost::token_compress_on);
+	for (std::vector<std::string>::iterator it = hosts.begin(); it != hosts.end(); ++it) {
+		if (it->empty()) continue;
+		serverptr server = boost::make_shared<ntp_server>();
+		if ((pos = it->find(':')) != std::string::npos) {
+			server->host = it->substr(0, pos);
+			server->port = (uint16_t) atoi(it->c_str() + pos + 1);
 		}
 		else {
-			_gLog.Write(LOG_WARN, NULL, "Failed to communicate with NTP server<%s:%u>", host_.c_str(), port_);
-			// 时钟偏差有效期: 5周期
-			if (++nfail_ >= 5 && valid_) valid_ = false;
+			server->host = *it;
+			server->port = port_;
 		}
+		server->sock.reset(new udp::socket(keep_.get_service()));
+		server->tmout.reset(new deadline_timer(keep_.get_service()));
+		servers_.push_back(server);
 	}
+	reset_ = false;
 }
 
-void NTPClient::construct_packet() {
-	char version = 1;
-	long tmp_wrd;
-	struct timeval tv;
-	char* data = pack_.get();
+void NTPClient::handle_poll(const boost::system::error_code& ec) {
+	if (ec == error::operation_aborted) return;
 
-	memset(data, 0, NTP_PCK_LEN);
-	version = 4;
-	tmp_wrd = htonl((LI << 30) | (version << 27)
-			| (MODE << 24) | (STRATUM << 16) | (POLL << 8) |(PREC & 0xff));
-	memcpy(data, &tmp_wrd, sizeof(tmp_wrd));
-	tmp_wrd = htonl(1 << 16);
-	memcpy (data + 4, &tmp_wrd, sizeof(tmp_wrd));
-	memcpy (data + 8, &tmp_wrd, sizeof(tmp_wrd));
-	gettimeofday(&tv, NULL);
-	tmp_wrd = htonl(JAN_1970 + tv.tv_sec);
-	memcpy (data + 40, &tmp_wrd, sizeof(tmp_wrd));
-	tmp_wrd = htonl((unsigned int) ((double) tv.tv_usec * UINTMAX * 1E-6));
-	memcpy(data + 44, &tmp_wrd, sizeof(tmp_wrd));
-}
-
-int NTPClient::get_time(struct addrinfo *addr, struct ntp_packet *ret_time) {
-	fd_set pending_data;
-	struct timeval block_time = {10, 0};
-	uint32_t len = addr->ai_addrlen;
-	int rslt(0);
-	char* data = pack_.get();
-
-	construct_packet();
-	if (sendto(sock_, data, NTP_PCK_LEN, 0, addr->ai_addr, len) < 0) {
-		_gLog.Write(LOG_WARN, "NTPClient::sendto", strerror(errno));
-		close(sock_);
-		sock_ = -1;
-	}
-	else {
-		FD_ZERO(&pending_data);
-		FD_SET(sock_, &pending_data);
-		if (select(sock_ + 1, &pending_data, NULL, NULL, &block_time) > 0) {
-			if (recvfrom(sock_, (void*)data, NTP_PCK_LEN * 8, 0, addr->ai_addr, &len) < 0) {
-				_gLog.Write(LOG_WARN, "NTPClient::recvfrom", strerror(errno));
-				close(sock_);
-				sock_ = -1;
-			}
-			else {
-				valid_ = true;
-				nfail_ = 0;
-				rslt   = 1;
-
-				ret_time->leap_ver_mode				= data[0];//ntohl(data[0]);
-				ret_time->stratum					= data[1];//ntohl(data[1]);
-				ret_time->poll						= data[2];//ntohl(data[2]);
-				ret_time->precision					= data[3];//ntohl(data[3]);
-				ret_time->root_delay				= ntohl(*(int*)&(data[4]));
-				ret_time->root_dispersion			= ntohl(*(int*)&(data[8]));
-				strcpy((char*) ret_time->reference_identifier, &data[12]);
-				ret_time->reference_timestamp.coarse= ntohl(*(int*)&(data[16]));
-				ret_time->reference_timestamp.fine	= ntohl(*(int*)&(data[20]));
-				ret_time->originate_timestamp.coarse= ntohl(*(int*)&(data[24]));
-				ret_time->originate_timestamp.fine	= ntohl(*(int*)&(data[28]));
-				ret_time->receive_timestamp.coarse	= ntohl(*(int*)&(data[32]));
-				ret_time->receive_timestamp.fine	= ntohl(*(int*)&(data[36]));
-				ret_time->transmit_timestamp.coarse	= ntohl(*(int*)&(data[40]));
-				ret_time->transmit_timestamp.fine	= ntohl(*(int*)&(data[44]));
+	{
+		mutex_lock lock(mtx_);
+		if (reset_) create_servers();
+	}
+	for (servervec::iterator it = servers_.begin(); it != servers_.end(); ++it) query(*it);
+
+	tmround_->expires_from_now(seconds(NTP_TIMEOUT) + millisec(100));
+	tmround_->async_wait(boost::bind(&NTPClient::handle_round, this, placeholders::error));
+	tmpoll_->expires_from_now(seconds(NTP_PERIOD));
+	tmpoll_->async_wait(boost::bind(&NTPClient::handle_poll, this, placeholders::error));
+}
+
+void NTPClient::query(serverptr server) {
+	boost::system::error_code ec;
+
+	if (server->pending) return;
+	if (!server->resolved) {
+		char portstr[10];
+		udp::resolver resolver(keep_.get_service());
+
+		sprintf(portstr, "%u", server->port);
+		udp::resolver::iterator it = resolver.resolve(udp::resolver::query(udp::v4(), server->host, portstr), ec);
+		if (ec || it == udp::resolver::iterator()) {
+			if (++server->nfail == 1) {
+				_gLog.Write(LOG_WARN, NULL, "Failed to resolve NTP server<%s:%u>", server->host.c_str(), server->port);
 			}
+			return;
 		}
+		server->remote   = *it;
+		server->resolved = true;
+	}
+	if (!server->sock->is_open()) {
+		server->sock->open(udp::v4(), ec);
+		if (ec) return;
 	}
 
-	return rslt;
+	unsigned char *data = server->buff;
+	uint32_t word;
+	double t1;
+
+	memset(data, 0, NTP_PCK_LEN);
+	word = htonl((LI << 30) | (VN << 27) | (MODE << 24) | (STRATUM << 16) | (POLL << 8) | (PREC & 0xff));
+	memcpy(data, &word, 4);
+	word = htonl(1 << 16);
+	memcpy(data + 4, &word, 4);
+	memcpy(data + 8, &word, 4);
+	server->t1 = t1 = local_time();
+	word = htonl((uint32_t) t1);
+	memcpy(data + 40, &word, 4);
+	word = htonl((uint32_t) ((t1 - (uint32_t) t1) * FRAC32));
+	memcpy(data + 44, &word, 4);
+	memcpy(server->origin, data + 40, 8);
+
+	server->sock->send_to(buffer(data, NTP_PCK_LEN), server->remote, 0, ec);
+	mquery_->Add();
+	if (ec) {
+		mfail_->Add();
+		_gLog.Write(LOG_WARN, "NTPClient::send_to", "%s:%u, %s", server->host.c_str(), server->port, ec.message().c_str());
+		++server->nfail;
+		server->sock->close(ec);
+		server->resolved = false;
+		return;
+	}
+	server->pending = true;
+	server->sock->async_receive_from(buffer(server->buff, sizeof(server->buff)), server->sender,
+			boost::bind(&NTPClient::handle_receive, this, server, placeholders::error, placeholders::bytes_transferred));
+	server->tmout->expires_from_now(seconds(NTP_TIMEOUT));
+	server->tmout->async_wait(boost::bind(&NTPClient::handle_timeout, this, server, placeholders::error));
 }
 
-void NTPClient::EnableAutoSynch(bool bEnabled) {
-	autoSync_ = bEnabled;
+void NTPClient::handle_receive(serverptr server, const boost::system::error_code& ec, std::size_t n) {
+	double t4 = local_time();
+
+	if (ec == error::operation_aborted) return;	// 超时或重建服务器
+	const unsigned char *data = server->buff;
+	if (!ec && n >= NTP_PCK_LEN && memcmp(data + 24, server->origin, 8)) {// 上一轮的迟到反馈, 继续等待
+		server->sock->async_receive_from(buffer(server->buff, sizeof(server->buff)), server->sender,
+				boost::bind(&NTPClient::handle_receive, this, server, placeholders::error, placeholders::bytes_transferred));
+		return;
+	}
+
+	boost::system::error_code ec1;
+	int mode = data[0] & 0x07;
+	int stratum = data[1];
+
+	server->tmout->cancel(ec1);
+	server->pending = false;
+	if (ec || n < NTP_PCK_LEN || mode != 4 || stratum < 1 || stratum > 15) {
+		++server->nfail;
+		mfail_->Add();
+		return;
+	}
+
+	double t1 = server->t1;
+	double t2 = ntp_timestamp(data + 32);
+	double t3 = ntp_timestamp(data + 40);
+	ntp_sample sample;
+
+	sample.offset = ((t2 - t1) + (t3 - t4)) * 0.5;
+	sample.delay  = (t4 - t1) - (t3 - t2);
+	sample.tloc   = t4;
+	server->nfail = 0;
+	mreply_->Add();
+	if (sample.delay > 0.0) mrtt_->Record(uint64_t(sample.delay * 1E6));
+
+	GLOG_DEBUG(LOGC_NTP, NULL, "NTP server<%s>: offset=%.6f, delay=%.6f", server->host, sample.offset, sample.delay);
+	mutex_lock lock(mtx_);
+	server->samples.push_back(sample);
+}
+
+void NTPClient::handle_timeout(serverptr server, const boost::system::error_code& ec) {
+	if (ec == error::operation_aborted || !server->pending) return;
+
+	boost::system::error_code ec1;
+	server->sock->cancel(ec1);
+	server->pending = false;
+	mtimeout_->Add();
+	if (++server->nfail == 1) {
+		GLOG_RECORD_CAT(LOGC_NTP, LOG_WARN, NULL, "Failed to communicate with NTP server<%s:%u>", server->host, server->port);
+	}
+}
+
+void NTPClient::handle_round(const boost::system::error_code& ec) {
+	if (ec == error::operation_aborted) return;
+	if (!select_offset()) return;
+	if (discipline_) {
+		discipline();
+		return;
+	}
+
+	double offset, delay;
+	std::string source;
+	{
+		mutex_lock lock(mtx_);
+		offset = offset_;
+		delay  = delay_;
+		source = source_;
+	}
+	if (offset >= tSync_ || offset <= -tSync_) {
+		GLOG_RECORD_CAT(LOGC_NTP, LOG_WARN, NULL, "Clock drifts %.6f seconds. Server=%s. delay=%.3f msecs",
+				offset, source, delay * 1000);
+		if (autoSync_) SynchClock();
+	}
+}
+
+bool NTPClient::select_offset() {
+	mutex_lock lock(mtx_);
+	double tnow = local_time();
+	double tmin = tnow - NTP_HISTORY * NTP_PERIOD;
+	const ntp_sample *best = NULL;
+	const ntp_server *from = NULL;
+
+	for (servervec::iterator it = servers_.begin(); it != servers_.end(); ++it) {
+		samplebuff &samples = (*it)->samples;
+		// 丢弃过期采样. 直接设置时钟后历史采样已被清除, 渐进修正后历史采样已换算
+		while (!samples.empty() && samples.front().tloc < tmin) samples.pop_front();
+		for (samplebuff::iterator x = samples.begin(); x != samples.end(); ++x) {
+			if (!best || x->delay < best->delay) {
+				best = &(*x);
+				from = it->get();
+			}
+		}
+	}
+
+	if (best) {
+		offset_ = best->offset;
+		delay_  = best->delay;
+		source_ = from->host;
+		valid_  = delay_ < tSync_;
+		moffset_->Set(offset_);
+		mdelay_->Set(delay_);
+	}
+	else valid_ = false;
+	mvalid_->Set(valid_ ? 1.0 : 0.0);
+	return valid_;
 }
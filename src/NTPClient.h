@@ -8,58 +8,94 @@
  * (1) 每分钟检查一次本机与NTP的时间偏差. 当时间偏差较大时, 在日志文件中记录并提示
  * (2) 当需要修正本机时钟时, 直接采用最近一次的时间偏差
  * (3) 修正本机时钟
+ *
+ * @version      2.0
+ * @date         2026年10月19日
+ * @note
+ * (1) 基于boost::asio异步查询, 同时向多个NTP服务器发送请求, 单个服务器超时不影响其它服务器
+ * (2) 每个服务器保留最近NTP_HISTORY次采样. 选择各服务器历史中网络延迟最小的采样,
+ *     再从各服务器中选择延迟最小者作为时钟偏差
+ * (3) 时钟偏差误差不超过延迟的一半, 因此仅当延迟小于修正阈值时视为有效
+ * (4) 驯服模式: 对最近NTP_FILTER轮的时钟偏差取中值, 以adjtime()渐进修正相位,
+ *     并以比例-积分方式估计本机时钟频率偏差(Linux下由adjtimex()设置). 仅当偏差超过
+ *     跳变阈值时直接设置时钟, 避免时间跳变影响依赖second_clock的逻辑
+ * (5) 每周期的相位修正量不超过adjtime()在一个周期内可完成的量, 积分输入受同一限制.
+ *     历史采样只按实际完成的修正量平移
  */
 
 #ifndef NTPCLIENT_H_
 #define NTPCLIENT_H_
 
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netdb.h>
 #include <string>
+#include <vector>
 #include <boost/thread.hpp>
 #include <boost/smart_ptr.hpp>
+#include <boost/circular_buffer.hpp>
+#include "IOServiceKeep.h"
+#include "Metrics.h"
+
+using boost::asio::ip::udp;
+
+#define NTP_PCK_LEN		48		//< NTP数据包长度, 量纲: 字节
+#define NTP_HISTORY		8		//< 每个服务器保留的采样数量
+#define NTP_PERIOD		60		//< 查询周期, 量纲: 秒
+#define NTP_TIMEOUT		2		//< 单次查询超时, 量纲: 秒
+#define NTP_FILTER		5		//< 驯服模式: 时钟偏差滤波窗口, 量纲: 轮
+#define NTP_FREQ_GAIN	16		//< 驯服模式: 频率修正的积分时间常数, 量纲: 周期
+#define NTP_FREQ_MAX	500E-6	//< 驯服模式: 最大频率偏差
+#define NTP_SLEW_MAX	500E-6	//< 驯服模式: adjtime()的校正速率
 
 class NTPClient {
 public:
-	typedef struct _ntp_time {
-		unsigned int coarse;
-		unsigned int fine;
-	}ntp_time;
-
 	/**
 	 * offset = ((T2 - T1) + (T3 - T4)) / 2
 	 * delay  = (T4 - T1) - (T3 - T2)
 	 *
 	 * local_time_corrected = local_time_pc + offset
 	 */
+	struct ntp_sample {// 单次采样
+		double offset;	//< 时钟偏差, 量纲: 秒
+		double delay;	//< 网络往返延迟, 量纲: 秒
+		double tloc;	//< 采样时的本机时间, 量纲: 秒
+	};
+	typedef boost::circular_buffer<ntp_sample> samplebuff;
 
-	struct ntp_packet {
-		unsigned char leap_ver_mode;
-		unsigned char stratum;
-		char poll;
-		char precision;
-		int root_delay;
-		int root_dispersion;
-		unsigned char reference_identifier[4];		// in the case of stratum 0 or 1, this is a four-octet, left-justified
-										// zero-padded ASCII string, referring to clock resource.
-										// in the case of stratum 2 and greater, this is the four-octet internet
-										// address of the primary reference host
-		ntp_time reference_timestamp;	// 本地时钟最后设置或修正的时间
-		ntp_time originate_timestamp;	// T1: 由本机向NTP服务器发送请求的本机时间
-		ntp_time receive_timestamp;		// T2: 请求抵达服务器时的本地时间
-		ntp_time transmit_timestamp;	// T3: 反馈离开服务器时的本地实际
-										// T4: 反馈抵达本机时的时间
+	struct ntp_server {// NTP服务器
+		std::string host;		//< 地址
+		uint16_t port;			//< 端口
+		udp::endpoint remote;	//< 解析后的地址
+		udp::endpoint sender;	//< 反馈信息的来源地址
+		bool resolved;			//< 地址已解析
+		bool pending;			//< 等待反馈
+		int nfail;				//< 连续失败次数
+		unsigned char buff[NTP_PCK_LEN * 8];	//< 收发缓冲区
+		unsigned char origin[8];	//< 请求中的发送时标, 用于匹配反馈
+		double t1;					//< 请求发送时的本机时间, 量纲: 秒
+		samplebuff samples;			//< 采样历史
+		boost::shared_ptr<udp::socket> sock;	//< 套接字
+		boost::shared_ptr<boost::asio::deadline_timer> tmout;	//< 超时定时器
+
+	public:
+		ntp_server() {
+			port     = 123;
+			resolved = false;
+			pending  = false;
+			nfail    = 0;
+			t1       = 0.0;
+			samples.set_capacity(NTP_HISTORY);
+		}
 	};
+	typedef boost::shared_ptr<ntp_server> serverptr;
+	typedef std::vector<serverptr> servervec;
+
 	/* 声明数据类型 */
 	typedef boost::unique_lock<boost::mutex> mutex_lock; //< 基于boost::mutex的互斥锁
-	typedef boost::shared_ptr<boost::thread> threadptr;  //< 线程指针类型
-	typedef boost::shared_array<char> carray;		//< 字符型数组
+	typedef boost::shared_ptr<boost::asio::deadline_timer> timerptr;	//< 定时器指针
 
 public:
 	/*!
 	 * @brief 构造函数
-	 * @param hostIP  NTP服务IPv4地址
+	 * @param hostIP  NTP服务地址. 多个服务器以逗号或空格分隔, 单个服务器可写作host:port
 	 * @param port    NTP服务端口, 默认123
 	 * @param tSyn    修正时钟的最大时钟偏差, 量纲: 毫秒
 	 */
@@ -68,39 +104,98 @@ public:
 
 protected:
 	/* 声明成员变量 */
+	IOServiceKeep keep_;	//< 提供io_service对象
 	boost::mutex mtx_;		//< 互斥区
-	threadptr    thrd_;		//< 线程指针
-	std::string  host_;		//< NTP服务器的IPv4地址
-	uint16_t     port_;		//< NTP服务器的端口
-	int          sock_;		//< SOCKET套接字
-	carray       pack_;		//< 网络交互信息
+	std::string  host_;		//< NTP服务器地址列表
+	uint16_t     port_;		//< NTP服务器的缺省端口
+	bool         reset_;	//< 服务器列表已变更
+	servervec    servers_;	//< NTP服务器
 	double       offset_;	//< 时钟偏差, 量纲: 秒
-	bool         valid_;		//< 数据有效性
-	int          nfail_;		//< 时钟偏差检查失败次数
-	double       tSync_;		//< 修正本地时钟的最大时钟偏差
+	double       delay_;	//< 时钟偏差对应的网络延迟, 量纲: 秒
+	std::string  source_;	//< 时钟偏差对应的服务器
+	bool         valid_;	//< 数据有效性
+	double       tSync_;	//< 修正本地时钟的最大时钟偏差
 	bool         autoSync_;	//< 是否自动修正时钟偏差
+	bool         discipline_;	//< 启用驯服模式
+	double       tPanic_;		//< 驯服模式: 直接设置时钟的偏差阈值, 量纲: 秒
+	samplebuff   window_;		//< 驯服模式: 最近各轮选定的时钟偏差
+	double       filtered_;		//< 驯服模式: 滤波后的时钟偏差, 量纲: 秒
+	double       freq_;			//< 驯服模式: 本机时钟频率修正量. 正值使时钟加快
+	bool         adjfail_;		//< 驯服模式: adjtime()失败, 避免重复记录日志
+	timerptr     tmpoll_;	//< 定时器: 查询周期
+	timerptr     tmround_;	//< 定时器: 单轮查询结束
+	/* 运行指标 */
+	MetricCounter*   mquery_;	//< 已发送请求数量
+	MetricCounter*   mreply_;	//< 有效反馈数量
+	MetricCounter*   mtimeout_;	//< 超时数量
+	MetricCounter*   mfail_;	//< 无效反馈或发送失败数量
+	MetricGauge*     moffset_;	//< 选定的时钟偏差, 量纲: 秒
+	MetricGauge*     mdelay_;	//< 选定偏差对应的网络延迟, 量纲: 秒
+	MetricGauge*     mfreq_;	//< 驯服模式: 本机时钟频率修正量, 量纲: ppm
+	MetricGauge*     mvalid_;	//< 时钟偏差有效性
+	MetricHistogram* mrtt_;		//< 网络往返延迟分布, 量纲: 微秒
 
 protected:
 	/*!
-	 * @brief 构建待发送网络信息
+	 * @brief 按地址列表重建服务器
+	 */
+	void create_servers();
+	/*!
+	 * @brief 开始一轮查询
 	 */
-	void construct_packet();
+	void handle_poll(const boost::system::error_code& ec);
 	/*!
-	 * @brief 采集NTP时钟
-	 * @param addr      地址
-	 * @param ret_time  NTP数据包
+	 * @brief 向服务器发送请求
+	 */
+	void query(serverptr server);
+	/*!
+	 * @brief 处理服务器反馈
+	 */
+	void handle_receive(serverptr server, const boost::system::error_code& ec, std::size_t n);
+	/*!
+	 * @brief 处理单次查询超时
+	 */
+	void handle_timeout(serverptr server, const boost::system::error_code& ec);
+	/*!
+	 * @brief 一轮查询结束, 选择时钟偏差
+	 */
+	void handle_round(const boost::system::error_code& ec);
+	/*!
+	 * @brief 从所有服务器的采样中选择延迟最小者
 	 * @return
+	 * 是否存在可用采样
 	 */
-	int get_time(struct addrinfo* addr, struct ntp_packet* ret_time);
+	bool select_offset();
 	/*!
-	 * @brief 线程主体
+	 * @brief 驯服模式: 滤波时钟偏差并渐进修正本机时钟
 	 */
-	void thread_body();
+	void discipline();
+	/*!
+	 * @brief 直接设置本机时钟, 并清除已失效的采样
+	 * @param offset 时钟偏差, 量纲: 秒
+	 */
+	void step_clock(double offset);
+	/*!
+	 * @brief 本机时钟已修正offset, 将历史采样换算到修正后的时钟
+	 */
+	void shift_samples(double offset);
+	/*!
+	 * @brief 设置内核时钟频率修正量
+	 * @return
+	 * 设置结果
+	 */
+	bool set_frequency(double freq);
+	/*!
+	 * @brief 查看本机时间
+	 * @return
+	 * 本机时间, 自1900年1月1日起的秒数
+	 */
+	double local_time();
 
 public:
 	/*!
 	 * @brief 设置NTP服务器
-	 * @param ip   IPv4地址
+	 * @param ip   地址列表, 格式与构造函数相同
 	 * @param port 服务端口
 	 */
 	void SetHost(const char* ip, const uint16_t port = 123);
@@ -109,6 +204,30 @@ public:
 	 * @param tSync 时钟修正阈值, 量纲: 毫秒
 	 */
 	void SetSyncLimit(const int tSync = 5);
+	/*!
+	 * @brief 查看时钟偏差
+	 * @param offset 时钟偏差, 量纲: 秒. 本机时钟加上该值为NTP时钟
+	 * @param delay  网络延迟, 量纲: 秒
+	 * @return
+	 * 时钟偏差有效性
+	 */
+	bool GetOffset(double& offset, double& delay);
+	/*!
+	 * @brief 查看驯服模式状态
+	 * @param offset 滤波后的时钟偏差, 量纲: 秒
+	 * @param freq   本机时钟频率修正量, 量纲: ppm. 正值使时钟加快
+	 * @return
+	 * 是否已启用驯服模式
+	 */
+	bool GetDiscipline(double& offset, double& freq);
+	/*!
+	 * @brief 启用或禁止驯服模式
+	 * @param enabled 启用标志. 禁止时沿用直接设置时钟的方式
+	 * @param tPanic  跳变阈值, 量纲: 毫秒. 偏差超过该值时直接设置时钟
+	 * @note
+	 * 驯服模式仅在EnableAutoSynch(true)时修正时钟
+	 */
+	void EnableDiscipline(bool enabled = true, const int tPanic = 1000);
 	/*!
 	 * @brief 同步本机时钟
 	 */
@@ -0,0 +1,115 @@
+/*
+ * @file TimerWheel.cpp 类TimerWheel的定义文件
+ * @version      0.1
+ * @date         2026年10月19日
+ */
+
+#include <vector>
+#include <boost/bind.hpp>
+#include "TimerWheel.h"
+
+using namespace boost::asio;
+using namespace boost::posix_time;
+
+TimerNode::TimerNode() {
+	prev   = next = NULL;
+	wheel  = NULL;
+	expire = 0;
+	tag    = 0;
+}
+
+TimerNode::~TimerNode() {
+	TimerWheel *owner = wheel.load();
+	if (owner) owner->Cancel(this);	// 在锁内复核, 期间已到期的节点不再处理
+}
+
+//////////////////////////////////////////////////////////////////////////////
+TimerWheel::TimerWheel() {
+	for (int i = 0; i < TW_SLOTS; ++i) slots_[i].prev = slots_[i].next = &slots_[i];
+	now_   = 0;
+	armed_ = 0;
+	tmtick_.reset(new deadline_timer(keep_.get_service()));
+	tmtick_->expires_from_now(millisec(TW_TICK));
+	tmtick_->async_wait(boost::bind(&TimerWheel::handle_tick, this, placeholders::error));
+}
+
+TimerWheel::~TimerWheel() {
+	Stop();
+	// 解除尚未释放的节点与时间轮的关联
+	for (int i = 0; i < TW_SLOTS; ++i) {
+		while (slots_[i].next != &slots_[i]) unlink(slots_[i].next);
+		slots_[i].prev = slots_[i].next = NULL;
+	}
+}
+
+void TimerWheel::RegisterExpire(const CBSlot& slot) {
+	if (!cbexpire_.empty()) cbexpire_.disconnect_all_slots();
+	cbexpire_.connect(slot);
+}
+
+void TimerWheel::Arm(TimerNode* node, int secs) {
+	if (secs <= 0) {
+		Cancel(node);
+		return;
+	}
+
+	mutex_lock lck(mtx_);
+	if (node->wheel) unlink(node);
+	uint64_t ticks = (uint64_t(secs) * 1000 + TW_TICK - 1) / TW_TICK;
+	TimerNode *head = &slots_[(node->expire = now_ + ticks) & (TW_SLOTS - 1)];
+	node->wheel = this;
+	node->prev  = head->prev;
+	node->next  = head;
+	head->prev->next = node;
+	head->prev  = node;
+	++armed_;
+}
+
+void TimerWheel::Cancel(TimerNode* node) {
+	mutex_lock lck(mtx_);
+	if (node->wheel == this) unlink(node);
+}
+
+int TimerWheel::Armed() {
+	mutex_lock lck(mtx_);
+	return armed_;
+}
+
+void TimerWheel::Stop() {
+	keep_.stop();
+}
+
+void TimerWheel::unlink(TimerNode* node) {
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->prev = node->next = NULL;
+	node->wheel = NULL;
+	--armed_;
+}
+
+void TimerWheel::start_tick() {
+	boost::system::error_code ec;
+	tmtick_->expires_at(tmtick_->expires_at() + millisec(TW_TICK), ec);
+	tmtick_->async_wait(boost::bind(&TimerWheel::handle_tick, this, placeholders::error));
+}
+
+void TimerWheel::handle_tick(const boost::system::error_code& ec) {
+	if (ec == error::operation_aborted) return;
+
+	std::vector<long> expired;
+	{
+		mutex_lock lck(mtx_);
+		TimerNode *head = &slots_[++now_ & (TW_SLOTS - 1)], *node, *next;
+		for (node = head->next; node != head; node = next) {
+			next = node->next;
+			if (node->expire <= now_) {
+				expired.push_back(node->tag);
+				unlink(node);
+			}
+		}
+	}
+	for (std::vector<long>::iterator it = expired.begin(); it != expired.end(); ++it) {
+		if (!cbexpire_.empty()) cbexpire_(*it);
+	}
+	start_tick();
+}
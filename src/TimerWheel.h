@@ -0,0 +1,112 @@
+/*
+ * @file TimerWheel.h  类TimerWheel声明文件
+ * @description  哈希时间轮: 管理大量网络连接的空闲与心跳时限
+ * @version      0.1
+ * @date         2026年10月19日
+ * @note
+ * (1) 时间轮由TW_SLOTS个槽构成, 每个节拍前进一槽. 到期节拍为t的定时器挂在第t % TW_SLOTS个槽的
+ *     双向链表上; 时限超过一圈的定时器留在链表中, 到达其节拍时才触发
+ * (2) 定时器节点由调用者持有(侵入式), 启动、重新启动与取消均为O(1), 不分配内存.
+ *     因此可在收到每条信息时重新启动定时器
+ * (3) 到期回调在时间轮线程中、互斥锁之外执行, 参数为节点的标记. 回调执行时节点可能已被释放,
+ *     调用者应以标记查找资源, 而不是访问节点
+ * (4) 节拍以绝对时间推进, 不累积误差. 时限精度为一个节拍
+ */
+
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+#include <boost/signals2.hpp>
+#include <boost/smart_ptr.hpp>
+#include "IOServiceKeep.h"
+
+#define TW_SLOTS	512		//< 槽数量, 须为2的幂
+#define TW_TICK		1000	//< 节拍, 量纲: 毫秒
+
+class TimerWheel;
+
+/*!
+ * @struct TimerNode 时间轮定时器节点
+ * @note
+ * 节点析构时自动取消定时器
+ */
+struct TimerNode {
+	TimerNode *prev;	//< 链表: 前一节点
+	TimerNode *next;	//< 链表: 后一节点
+	boost::atomic<TimerWheel*> wheel;	//< 所在时间轮. NULL: 未启动. 在时间轮互斥锁保护下修改, 析构时无锁读取
+	uint64_t expire;	//< 到期节拍
+	long tag;			//< 调用者定义的标记, 到期时作为回调参数
+
+public:
+	TimerNode();
+	~TimerNode();
+};
+
+class TimerWheel {
+public:
+	TimerWheel();
+	virtual ~TimerWheel();
+
+public:
+	/* 数据类型 */
+	typedef boost::signals2::signal<void (const long)> CallbackFunc;	//< 到期回调函数类型
+	typedef CallbackFunc::slot_type CBSlot;
+	typedef boost::unique_lock<boost::mutex> mutex_lock;	//< 互斥锁
+	typedef boost::shared_ptr<boost::asio::deadline_timer> timerptr;	//< 定时器指针
+
+protected:
+	/* 成员变量 */
+	IOServiceKeep keep_;	//< 提供io_service对象
+	timerptr tmtick_;		//< 节拍定时器
+	boost::mutex mtx_;		//< 互斥锁: 槽与节点链表
+	TimerNode slots_[TW_SLOTS];	//< 槽: 各链表的哨兵节点
+	uint64_t now_;			//< 当前节拍
+	int armed_;				//< 已启动的定时器数量
+	CallbackFunc cbexpire_;	//< 到期回调函数
+
+public:
+	/*!
+	 * @brief 注册到期回调函数
+	 */
+	void RegisterExpire(const CBSlot& slot);
+	/*!
+	 * @brief 启动或重新启动定时器
+	 * @param node 定时器节点
+	 * @param secs 时限, 量纲: 秒. 小于等于0时取消定时器
+	 */
+	void Arm(TimerNode* node, int secs);
+	/*!
+	 * @brief 取消定时器
+	 */
+	void Cancel(TimerNode* node);
+	/*!
+	 * @brief 查看已启动的定时器数量
+	 */
+	int Armed();
+	/*!
+	 * @brief 停止节拍
+	 * @note
+	 * 停止后不再回调
+	 */
+	void Stop();
+
+protected:
+	/*!
+	 * @brief 从链表中移除节点
+	 * @note
+	 * 调用者需持有mtx_
+	 */
+	void unlink(TimerNode* node);
+	/*!
+	 * @brief 启动下一个节拍
+	 */
+	void start_tick();
+	/*!
+	 * @brief 处理节拍: 收集并回调当前槽中到期的定时器
+	 */
+	void handle_tick(const boost::system::error_code& ec);
+};
+
+#endif /* TIMERWHEEL_H_ */
@@ -10,22 +10,61 @@
 #include "globaldef.h"
 #include "daemon.h"
 #include "GLog.h"
+#include "Metrics.h"
+#include "FlightRecorder.h"
 #include "parameter.h"
 #include "GeneralControl.h"
+#include "ATimeSpace.h"
+#include "AAlmanac.h"
 
 GLog _gLog;
+Metrics _gMetrics;
+FlightRecorder _gRecorder;
+
+/*!
+ * @brief 收到SIGUSR1时将飞行记录器写入文件
+ */
+static void dump_flight(boost::asio::signal_set *signals, const boost::system::error_code &ec, int) {
+	if (ec) return;
+	int rslt = _gRecorder.Dump("signal");
+	if (rslt) _gLog.Write(LOG_WARN, NULL, "failed to dump flight recorder, error code<%d>", rslt);
+	else _gLog.Write("dumped flight recorder on signal");
+	signals->async_wait(boost::bind(&dump_flight, signals, _1, _2));
+}
+
 int main(int argc, char **argv) {
 	if (argc >= 2) {// 处理命令行参数
 		if (strcmp(argv[1], "-d") == 0) {
 			Parameter param;
 			param.InitFile("annaes.xml");
 		}
-		else _gLog.Write("Usage: annaes <-d>\n");
+		else if (strcmp(argv[1], "-a") == 0) {// 生成自今年起若干年的时刻表
+			Parameter param;
+			AstroUtil::ATimeSpace ats;
+			int years = argc >= 3 ? atoi(argv[2]) : 3;
+			int iy = second_clock::universal_time().date().year();
+			int mjd0, rslt;
+
+			if (years <= 0) years = 3;
+			if (!param.LoadFile(gConfigPath) || param.pathAlmanac.empty()) {
+				_gLog.Write(LOG_FAULT, NULL, "failed to access configuration file[%s] or almanac path", gConfigPath);
+				return 1;
+			}
+			mjd0 = int(ats.ModifiedJulianDay(iy, 1, 1, 0.0));
+			rslt = AstroUtil::AAlmanac::Generate(param.pathAlmanac.c_str(), param.siteLon, param.siteLat,
+					param.siteAlt, param.timezone, mjd0, int(ats.ModifiedJulianDay(iy + years, 1, 1, 0.0)) - mjd0);
+			if (rslt) _gLog.Write(LOG_FAULT, NULL, "failed to generate almanac file[%s], error code<%d>",
+					param.pathAlmanac.c_str(), rslt);
+			else _gLog.Write("generated almanac file[%s] for %d years since %d", param.pathAlmanac.c_str(), years, iy);
+		}
+		else _gLog.Write("Usage: annaes <-d | -a [years]>\n");
 	}
 	else {// 常规工作模式
 		boost::asio::io_service ios;
 		boost::asio::signal_set signals(ios, SIGINT, SIGTERM);  // interrupt signal
 		signals.async_wait(boost::bind(&boost::asio::io_service::stop, &ios));
+		boost::asio::signal_set sigdump(ios, SIGUSR1);	// 写入飞行记录器
+		sigdump.async_wait(boost::bind(&dump_flight, &sigdump, _1, _2));
 
 		if (!MakeItDaemon(ios)) return 1;
 		if (!isProcSingleton(gPIDPath)) {
@@ -33,6 +72,9 @@ int main(int argc, char **argv) {
 			return 2;
 		}
 
+		_gLog.EnableAsync();
+		_gRecorder.Install();
+		_gLog.SetFaultHook(&FlightRecorder::OnFault);
 		_gLog.Write("Try to launch %s %s %s as daemon", DAEMON_NAME, DAEMON_VERSION, DAEMON_AUTHORITY);
 		// 主程序入口
 		boost::shared_ptr<GeneralControl> gc = boost::make_shared<GeneralControl>();
@@ -45,6 +87,8 @@ int main(int argc, char **argv) {
 		else {
 			_gLog.Write(LOG_FAULT, NULL, "Fail to launch %s", DAEMON_NAME);
 		}
+		_gLog.SetFaultHook(NULL);
+		_gLog.EnableAsync(false);
 	}
 
 	return 0;
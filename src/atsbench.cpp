@@ -0,0 +1,208 @@
+/*
+ Name        : atsbench.cpp
+ Version     : 0.1
+ Copyright   : SVOM@NAOC, CAS
+ Description : ATimeSpace耗时测试与精度回归检查
+ @note
+ - 逐项测量标量接口与批量接口的单次耗时
+ - 与内置参考值比较, 任一项超差时返回非0值
+ - 参考值来源: Jean Meeus <Astronomical Algorithms>第2版例题, sofa测试用例(t_sofa_c.c), IERS闰秒表
+ @note
+ 用法: atsbench [循环次数]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "ADefine.h"
+#include "ATimeSpace.h"
+
+using namespace AstroUtil;
+using namespace boost::posix_time;
+
+static int nfail = 0;		//< 超差项数量
+static volatile double sink;	//< 避免测试循环被优化
+
+/*!
+ * @brief 比较计算值与参考值
+ * @param name  项目名称
+ * @param value 计算值
+ * @param ref   参考值
+ * @param tol   允许偏差
+ * @param unit  量纲
+ */
+static void check(const char *name, double value, double ref, double tol, const char *unit) {
+	double diff = value - ref;
+	bool pass = fabs(diff) <= tol;
+
+	if (!pass) ++nfail;
+	printf("  %-36s %18.9f %18.9f %12.3g %-6s %s\n", name, value, ref, diff, unit, pass ? "PASS" : "FAIL");
+}
+
+/*!
+ * @brief 打印单次耗时
+ * @param name 项目名称
+ * @param t0   起始时间
+ * @param n    调用次数
+ */
+static void report(const char *name, const ptime &t0, int n) {
+	double ns = (microsec_clock::universal_time() - t0).total_microseconds() * 1E3 / n;
+	printf("  %-36s %12.1f ns\n", name, ns);
+}
+
+static void accuracy() {
+	ATimeSpace ats;
+	double t, ra, dec, nl, no, rise, set;
+
+	printf("Accuracy                               computed          reference           diff\n");
+	/* 太阳视位置. Meeus例25.a: 1992-10-13 0h TD */
+	t = ats.JulianCentury(ats.ModifiedJulianDay(1992, 10, 13, 0.0));
+	ats.SunPosition(t, ra, dec);
+	check("SunPosition RA", ra * R2D, 198.38083, 0.01, "deg");
+	check("SunPosition Dec", dec * R2D, -7.78507, 0.01, "deg");
+
+	/* 章动. sofa t_nut00b: MJD 53736 TT */
+	t = ats.JulianCentury(53736.0);
+	ats.Nutation(t, nl, no);
+	check("Nutation longitude", nl * R2AS, -0.9632552291148362783E-5 * R2AS, 1E-3, "as");
+	check("Nutation obliquity", no * R2AS, 0.4063197106621159367E-4 * R2AS, 1E-3, "as");
+
+	/* 恒星时. Meeus例12.a: 1987-04-10 0h UT */
+	ats.SetUTC(1987, 4, 10, 0.0);
+	check("GreenwichMeanSiderealTime", ats.GreenwichMeanSiderealTime() * R2D / 15.0 * 3600.0,
+			13 * 3600 + 10 * 60 + 46.3668, 1E-3, "s");
+	check("GreenwichSiderealTime", ats.GreenwichSiderealTime() * R2D / 15.0 * 3600.0,
+			13 * 3600 + 10 * 60 + 46.1351, 5E-3, "s");
+
+	/*
+	 * 视位置. Meeus例23.a: theta Persei, 2028-11-13.19 TD
+	 * 输入为例题中已计入自行的起始位置, 参考值采用IAU1980章动与FK5光行差
+	 */
+	ats.SetUTC(2028, 11, 13, 0.19);
+	ats.EqTransfer(41.0540613 * D2R, 49.2277489 * D2R, ra, dec);
+	check("EqTransfer RA", ra * R2AS, 41.5599646 * 3600.0, 0.1, "as");
+	check("EqTransfer Dec", dec * R2AS, 49.3520685 * 3600.0, 0.1, "as");
+	{
+		double ri[] = {41.0540613 * D2R}, di[] = {49.2277489 * D2R}, ro[1], dO[1];
+		ats.EqTransfer(1, ri, di, ro, dO);
+		check("EqTransfer batch RA", ro[0] * R2AS, 41.5599646 * 3600.0, 0.1, "as");
+		check("EqTransfer batch Dec", dO[0] * R2AS, 49.3520685 * 3600.0, 0.1, "as");
+	}
+
+	/* 日出日落. 格林尼治天文台 2020-06-21, 上边缘并计入大气折射: 03:43, 20:21 UTC */
+	ats.SetSite(0.0, 51.4769, 46.0, 0);
+	ats.SetUTC(2020, 6, 21, 0.0);
+	ats.TimeOfSunAlt(rise, set, -0.8333);
+	check("TimeOfSunAlt sunrise", rise * 60.0, 3 * 60 + 43, 1.0, "min");
+	check("TimeOfSunAlt sunset", set * 60.0, 20 * 60 + 21, 1.0, "min");
+
+	/* 闰秒. sofa t_dat与IERS闰秒表 */
+	check("DeltaAT 1970-01-01", ats.DeltaAT(1970, 1, 1, 0.0), 8.0000820, 1E-6, "s");
+	check("DeltaAT 2003-06-01", ats.DeltaAT(2003, 6, 1, 0.0), 32.0, 0.0, "s");
+	check("DeltaAT 2008-01-17", ats.DeltaAT(2008, 1, 17, 0.0), 33.0, 0.0, "s");
+	check("DeltaAT 2016-12-31", ats.DeltaAT(2016, 12, 31, 0.5), 36.0, 0.0, "s");
+	check("DeltaAT 2017-09-01", ats.DeltaAT(2017, 9, 1, 0.0), 37.0, 0.0, "s");
+}
+
+static void speed(int loop) {
+	ATimeSpace ats;
+	std::vector<double> ra(loop), dec(loop), rao(loop), deco(loop);
+	double mjd0 = 60000.0, x, y, t;
+	ptime t0;
+	int i;
+
+	for (i = 0; i < loop; ++i) {
+		ra[i]  = A2PI * i / loop;
+		dec[i] = asin(2.0 * (i + 0.5) / loop - 1.0);
+	}
+	ats.SetSite(93.9, 38.6, 4200.0, 8);
+	printf("Speed (%d calls)\n", loop);
+
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) {
+		ats.SunPosition(ats.JulianCentury(mjd0 + i * 1E-3), x, y);
+		sink = x + y;
+	}
+	report("SunPosition(t)", t0, loop);
+
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) {
+		ats.Nutation(ats.JulianCentury(mjd0 + i * 1E-3), x, y);
+		sink = x + y;
+	}
+	report("Nutation(t)", t0, loop);
+
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) sink = ats.GreenwichSiderealTime(mjd0 + i * 1E-3);
+	report("GreenwichSiderealTime(mjd)", t0, loop);
+
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) {
+		ats.SetMJD(mjd0 + i / DAYSEC);
+		sink = ats.GreenwichSiderealTime();
+	}
+	report("SetMJD + GreenwichSiderealTime()", t0, loop);
+
+	ats.SetMJD(mjd0);
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) {
+		ats.Advance(1.0);
+		sink = ats.GreenwichSiderealTime();
+	}
+	report("Advance + GreenwichSiderealTime()", t0, loop);
+
+	ats.SetMJD(mjd0);
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) {
+		ats.EqTransfer(ra[i], dec[i], x, y);
+		sink = x + y;
+	}
+	report("EqTransfer scalar", t0, loop);
+
+	t0 = microsec_clock::universal_time();
+	ats.EqTransfer(loop, &ra[0], &dec[0], &rao[0], &deco[0]);
+	report("EqTransfer batch, per position", t0, loop);
+
+	t = ats.LocalSiderealTime();
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) {
+		ats.Eq2Horizon(t - ra[i], dec[i], x, y);
+		sink = x + y;
+	}
+	report("Eq2Horizon scalar", t0, loop);
+
+	t0 = microsec_clock::universal_time();
+	ats.Eq2Horizon(loop, t, &ra[0], &dec[0], &rao[0], &deco[0]);
+	report("Eq2Horizon batch, per position", t0, loop);
+
+	int nday = loop / 100 > 0 ? loop / 100 : 1;
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < nday; ++i) {
+		ats.SetMJD(mjd0 + i);
+		ats.TimeOfSunAlt(x, y, -18.0);
+		sink = x + y;
+	}
+	report("SetMJD + TimeOfSunAlt", t0, nday);
+
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) sink = ats.DeltaAT(2000 + i % 20, 1 + i % 12, 1 + i % 28, 0.5);
+	report("DeltaAT, changing day", t0, loop);
+
+	t0 = microsec_clock::universal_time();
+	for (i = 0; i < loop; ++i) sink = ats.DeltaAT(2020, 6, 21, (i % 1000) * 1E-3);
+	report("DeltaAT, same day", t0, loop);
+}
+
+int main(int argc, char **argv) {
+	int loop = argc >= 2 ? atoi(argv[1]) : 100000;
+	if (loop <= 0) loop = 100000;
+
+	accuracy();
+	printf("\n");
+	speed(loop);
+	printf("\n%s: %d item(s) out of tolerance\n", nfail ? "FAILED" : "PASSED", nfail);
+
+	return nfail ? 1 : 0;
+}
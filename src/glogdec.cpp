@@ -0,0 +1,162 @@
+/*
+ Name        : glogdec.cpp
+ Version     : 0.1
+ Copyright   : SVOM@NAOC, CAS
+ Description : 将GLog二进制结构化日志或飞行记录器文件还原为文本
+ @note
+ - 输出格式与文本日志相同, 时标精确到微秒
+ - 文件中的格式定义可重复出现, 以最近一次定义为准
+ - 可直接读取已压缩的分段(.bin.gz)
+ - 飞行记录器的事件按序号输出, 丢弃写入文件时尚未完成的事件
+ @note
+ 用法: glogdec <file.bin | file.bin.gz> [...]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <zlib.h>
+#include "GLog.h"
+#include "FlightRecorder.h"
+
+struct format_def {// 格式定义
+	int type;
+	std::string where;
+	std::string format;
+};
+
+static void print_stamp(int64_t sec, int usec) {
+	time_t t = time_t(sec);
+	struct tm tmloc;
+
+	localtime_r(&t, &tmloc);
+	printf("%02d:%02d:%02d.%06d >> ", tmloc.tm_hour, tmloc.tm_min, tmloc.tm_sec, usec);
+}
+
+static bool event_less(const fr_event &x, const fr_event &y) {
+	return x.seq < y.seq;
+}
+
+/*!
+ * @brief 还原飞行记录器文件
+ * @return
+ * 0: 正确; 1: 文件格式错误
+ */
+static int decode_flight(const char *filepath, const std::vector<char> &data) {
+	fr_head head;
+	if (data.size() < sizeof(fr_head)) {
+		fprintf(stderr, "[%s] truncated\n", filepath);
+		return 1;
+	}
+	memcpy(&head, &data[0], sizeof(head));
+	if (head.size != sizeof(fr_event) || !head.count || (head.count & (head.count - 1))
+			|| data.size() < sizeof(fr_head) + size_t(head.count) * head.size) {
+		fprintf(stderr, "[%s] has unsupported event layout\n", filepath);
+		return 1;
+	}
+
+	std::vector<fr_event> events(head.count);
+	char text[GLOG_LINE];
+	size_t n(0);
+
+	memcpy(&events[0], &data[sizeof(fr_head)], size_t(head.count) * head.size);
+	for (uint32_t i = 0; i < head.count; ++i) {// 仅保留已完成且位置与序号一致的事件
+		fr_event &e = events[i];
+		if (e.seq && ((e.seq - 1) & (head.count - 1)) == i && e.type < FRE_MAX) events[n++] = e;
+	}
+	events.resize(n);
+	std::sort(events.begin(), events.end(), event_less);
+
+	head.reason[sizeof(head.reason) - 1] = 0;
+	printf("flight recorder dumped on %s: %lu events, %lu overwritten\n", head.reason, (unsigned long) n,
+			(unsigned long) (head.next - 1 - n));
+	for (size_t i = 0; i < n; ++i) {
+		print_stamp(events[i].usec / 1000000, int(events[i].usec % 1000000));
+		FlightRecorder::Render(events[i], text, sizeof(text));
+		printf("%s\n", text);
+	}
+
+	return 0;
+}
+
+/*!
+ * @brief 还原一个文件
+ * @return
+ * 0: 正确; 1: 无法读取文件或文件格式错误
+ */
+static int decode(const char *filepath) {
+	gzFile gz = gzopen(filepath, "rb");	// 同时支持未压缩的文件
+	if (!gz) {
+		fprintf(stderr, "failed to open file [%s]\n", filepath);
+		return 1;
+	}
+
+	std::vector<char> data;
+	char buff[65536];
+	int n;
+	while ((n = gzread(gz, buff, sizeof(buff))) > 0) data.insert(data.end(), buff, buff + n);
+	gzclose(gz);
+	if (data.size() >= 8 && !memcmp(&data[0], FR_MAGIC, 8)) return decode_flight(filepath, data);
+	if (data.size() < 8 || memcmp(&data[0], GLOG_MAGIC, 8)) {
+		fprintf(stderr, "[%s] is neither a binary log nor a flight recorder file\n", filepath);
+		return 1;
+	}
+
+	std::vector<format_def> defs;
+	const char *p = &data[8], *end = &data[0] + data.size();
+	char text[GLOG_LINE * 2];
+	uint16_t len, id;
+
+	while (end - p >= 3) {
+		memcpy(&len, p, 2);
+		const char *rec = p + 2, *next = rec + len;
+		if (next > end || len < 3) {
+			fprintf(stderr, "[%s] truncated at offset %ld\n", filepath, long(p - &data[0]));
+			return 1;
+		}
+		memcpy(&id, rec + 1, 2);
+
+		if (rec[0] == 'F') {// 格式定义
+			const char *where = rec + 4;
+			const char *format = where + strlen(where) + 1;
+			if (id >= defs.size()) defs.resize(id + 1);
+			defs[id].type   = rec[3];
+			defs[id].where  = where;
+			defs[id].format = format;
+		}
+		else if (rec[0] == 'E' && len >= GLOG_RECHEAD - 2) {// 事件
+			int64_t sec;
+			int32_t nsec;
+
+			memcpy(&sec, rec + 3, 8);
+			memcpy(&nsec, rec + 11, 4);
+			print_stamp(sec, nsec / 1000);
+			if (id < defs.size() && !defs[id].format.empty()) {
+				format_def &def = defs[id];
+				printf("%s", GLog::TypePrefix(def.type));
+				if (!def.where.empty()) printf("%s, ", def.where.c_str());
+				GLog::Render(def.format.c_str(), rec + GLOG_RECHEAD - 2, len - (GLOG_RECHEAD - 2), text, sizeof(text));
+				printf("%s\n", text);
+			}
+			else printf("<undefined format %u>\n", id);
+		}
+		p = next;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		printf("Usage: glogdec <file.bin | file.bin.gz> [...]\n");
+		return 1;
+	}
+
+	int rslt(0);
+	for (int i = 1; i < argc; ++i) rslt |= decode(argv[i]);
+
+	return rslt;
+}
@@ -0,0 +1,81 @@
+/*
+ Name        : ntpstandin.cpp
+ Version     : 0.1
+ Copyright   : SVOM@NAOC, CAS
+ Description : 本地UDP替身NTP服务器, 用于检验NTPClient
+ @note
+ - 以本机时钟加上指定偏差作为服务器时钟
+ - 在接收后与应答前各等待一半延迟, 模拟对称的网络往返延迟
+ - 可同时启动多个实例, 模拟偏差、延迟各不相同或无应答的服务器
+ @note
+ 用法: ntpstandin <端口> [偏差, 秒] [延迟, 毫秒] [丢弃比例, 0~1]
+ 示例: NTP IPv4="127.0.0.1:12301,127.0.0.1:12302"
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+using boost::asio::ip::udp;
+
+#define JAN_1970	0x83AA7E80
+#define FRAC32		4294967296.0
+
+/* 以网络字节序写入NTP时标 */
+static void put_timestamp(unsigned char *data, double t) {
+	uint32_t coarse = (uint32_t) t;
+	uint32_t fine   = (uint32_t) ((t - coarse) * FRAC32);
+	coarse = htonl(coarse);
+	fine   = htonl(fine);
+	memcpy(data, &coarse, 4);
+	memcpy(data + 4, &fine, 4);
+}
+
+static double server_time(double offset) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return JAN_1970 + tv.tv_sec + tv.tv_usec * 1E-6 + offset;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		printf("Usage: ntpstandin <port> [offset in sec] [delay in msec] [drop ratio]\n");
+		return 1;
+	}
+
+	int port = atoi(argv[1]);
+	double offset = argc >= 3 ? atof(argv[2]) : 0.0;
+	int delay     = argc >= 4 ? atoi(argv[3]) : 0;
+	double drop   = argc >= 5 ? atof(argv[4]) : 0.0;
+	boost::asio::io_service ios;
+	udp::socket sock(ios, udp::endpoint(udp::v4(), port));
+	udp::endpoint remote;
+	unsigned char data[512];
+	std::size_t n;
+
+	printf("ntpstandin on UDP %d: offset=%.6f sec, delay=%d msec, drop=%.2f\n", port, offset, delay, drop);
+	while (true) {
+		n = sock.receive_from(boost::asio::buffer(data, sizeof(data)), remote);
+		if (n < 48 || (data[0] & 0x07) != 3) continue;
+		if (drop > 0.0 && rand() < drop * RAND_MAX) continue;
+
+		if (delay > 0) boost::this_thread::sleep_for(boost::chrono::microseconds(delay * 500));
+		double t2 = server_time(offset);
+		// 请求的发送时标作为应答的起始时标
+		memcpy(data + 24, data + 40, 8);
+		put_timestamp(data + 32, t2);
+		data[0] = (data[0] & 0x38) | 0x04;	// LI=0, 保留版本号, 模式4: 服务器
+		data[1] = 2;						// 层级
+		memcpy(data + 12, "LOCL", 4);
+		put_timestamp(data + 16, t2);
+		put_timestamp(data + 40, server_time(offset));
+		if (delay > 0) boost::this_thread::sleep_for(boost::chrono::microseconds(delay * 500));
+		sock.send_to(boost::asio::buffer(data, 48), remote);
+	}
+
+	return 0;
+}
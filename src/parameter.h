@@ -13,6 +13,7 @@
 #include <boost/foreach.hpp>
 #include <boost/smart_ptr.hpp>
 #include "AstroDeviceDef.h"
+#include "GLog.h"
 
 using std::string;
 
@@ -21,16 +22,25 @@ struct Parameter {// 软件配置参数
 	int portDome;		//< 圆顶网络服务端口
 
 	bool ntpEnable;		//< NTP启用标志
-	string ntpHost;		//< NTP服务器IP地址
+	string ntpHost;		//< NTP服务器地址. 多个服务器以逗号分隔, 同时查询并选择网络延迟最小者
 	int ntpMaxDiff;		//< 采用自动校正时钟策略时, 本机时钟与NTP时钟所允许的最大偏差, 量纲: 毫秒
+	bool ntpDiscipline;	//< 驯服模式: 以adjtime()渐进修正时钟, 不直接设置时钟
+	int ntpPanic;		//< 驯服模式: 直接设置时钟的偏差阈值, 量纲: 毫秒
 
 	string sitename;	//< 测站名称
 	double siteLon;		//< 测站地理经度, 量纲: 角度. 东经为正
 	double siteLat;		//< 测站地理纬度, 量纲: 角度. 北纬为正
 	double siteAlt;		//< 海拔高度, 量纲: 米
 	int timezone;		//< 本地时时区, 量纲: 小时
+	string pathLeapSecond;	//< IERS闰秒文件(Leap_Second.dat)路径. 为空时使用内置闰秒表
+	string pathAlmanac;		//< 日出日落与晨昏时刻表文件路径. 由annaes -a生成
 
 	string pathWeather;	//< 气象环境参数文件路径
+	string logLevel[LOGC_MAX];	//< 各子系统的日志级别: trace, debug, normal, warn, fault, off
+
+	bool metricsEnable;		//< 启用运行指标导出服务
+	string metricsAddress;	//< 运行指标导出服务的监听地址
+	int metricsPort;		//< 运行指标导出服务的监听端口
 
 	/*
 	 * open_, 打开天窗的控制参数
@@ -49,6 +59,20 @@ struct Parameter {// 软件配置参数
 	double cloWindSpd;			//< 最大安全风速, 量纲: 米/秒
 	int cloContNum;				//< 风速大于阈值的连续次数
 
+	/*
+	 * cmd_, 天窗指令的确认与重发
+	 */
+	int cmdAckTimeout;	//< 发出指令后等待天窗状态变化的时限, 量纲: 秒. 每次重发后加倍. 不小于1
+	int cmdRetry;		//< 未确认指令的最大重发次数. 0~16
+	int cmdMoveTimeout;	//< 天窗开始动作后等待到位的时限, 量纲: 秒. 不小于1
+
+	/*
+	 * live_, 网络连接活跃检查. 时限为0时不检查
+	 */
+	int liveDomeHeartbeat;	//< 圆顶无信息的时长超过该值时标记为静默, 量纲: 秒. 0: 不检查
+	int liveDomeTimeout;	//< 圆顶无信息的时长超过该值时断开连接, 量纲: 秒. 0: 不检查
+	int liveClientIdle;		//< 客户端(订阅者除外)无信息的时长超过该值时断开连接, 量纲: 秒. 0: 不检查
+
 public:
 	/*!
 	 * @brief 初始化文件filepath, 存储缺省配置参数
@@ -72,6 +96,9 @@ public:
 		node2.add("<xmlattr>.IPv4",          "172.28.1.3");
 		node2.add("MaxDiff.<xmlattr>.Value", 100);
 		node2.add("<xmlcomment>", "Difference is in millisec");
+		node2.add("Discipline.<xmlattr>.Enable", true);
+		node2.add("Discipline.<xmlattr>.Panic",  1000);
+		node2.add("<xmlcomment>", "Discipline slews clock gradually. Clock is stepped only when difference exceeds Panic in millisec");
 
 		ptree& node3 = pt.add("ObservationSite", "");
 		node3.add("<xmlattr>.Name", "Lenghu");
@@ -80,8 +107,21 @@ public:
 		node3.add("Altitude.<xmlattr>.Value",  4500.0);
 		node3.add("Timezone.<xmlattr>.Value",       8);
 
+		pt.add("LeapSecond.<xmlattr>.Path", "/usr/local/etc/Leap_Second.dat");
+		pt.add("Almanac.<xmlattr>.Path",    "/usr/local/etc/annaes.alm");
+
 		pt.add("Weather.<xmlattr>.Path", "/Volumes/Fast_SSD/data/weather/realtime_weather.txt");
 
+		ptree& nodelog = pt.add("LogLevel", "");
+		for (int i = 0; i < LOGC_MAX; ++i) nodelog.add(string("<xmlattr>.") + GLog::CategoryName(i), "normal");
+		nodelog.add("<xmlcomment>", "Level: trace, debug, normal, warn, fault or off");
+
+		ptree& nodemet = pt.add("Metrics", "");
+		nodemet.add("<xmlattr>.Enable",  true);
+		nodemet.add("<xmlattr>.Address", "127.0.0.1");
+		nodemet.add("<xmlattr>.Port",    4022);
+		nodemet.add("<xmlcomment>", "Prometheus text format is served on http://Address:Port/metrics");
+
 		ptree& node4 = pt.add("SlitOpen", "");
 		node4.add("SunCenter.<xmlattr>.Altitude",       -5.0);
 		node4.add("UseWindSpeed.<xmlattr>.Option",         1);
@@ -101,6 +141,20 @@ public:
 		node5.add("WindSpeed.<xmlattr>.Threshold",      15.0);
 		node5.add("WindSpeed.<xmlattr>.ContinualNumber",   3);
 
+		ptree& node6 = pt.add("SlitCommand", "");
+		node6.add("<xmlattr>.AckTimeout",   10);
+		node6.add("<xmlattr>.Retry",         3);
+		node6.add("<xmlattr>.MoveTimeout", 300);
+		node6.add("<xmlcomment>", "Command is resent when slit state does not change within AckTimeout seconds, doubling the wait each time");
+		node6.add("<xmlcomment>", "Fault is raised after Retry resends, or when slit does not finish moving within MoveTimeout seconds");
+
+		ptree& node7 = pt.add("Liveness", "");
+		node7.add("<xmlattr>.DomeHeartbeat", 120);
+		node7.add("<xmlattr>.DomeTimeout",   300);
+		node7.add("<xmlattr>.ClientIdle",    600);
+		node7.add("<xmlcomment>", "Silent dome is flagged after DomeHeartbeat and disconnected after DomeTimeout seconds");
+		node7.add("<xmlcomment>", "Silent client, except subscribers, is disconnected after ClientIdle seconds. 0 disables the check");
+
 		boost::property_tree::xml_writer_settings<std::string> settings(' ', 4);
 		write_xml(filepath, pt, std::locale(), settings);
 	}
@@ -115,6 +169,16 @@ public:
 
 			ptree pt;
 			read_xml(filepath, pt, boost::property_tree::xml_parser::trim_whitespace);
+			// 旧版配置文件中没有的项
+			metricsEnable  = false;
+			metricsAddress = "127.0.0.1";
+			metricsPort    = 4022;
+			cmdAckTimeout  = 10;
+			cmdRetry       = 3;
+			cmdMoveTimeout = 300;
+			liveDomeHeartbeat = 0;
+			liveDomeTimeout   = 0;
+			liveClientIdle    = 0;
 			BOOST_FOREACH(ptree::value_type const &child, pt.get_child("")) {
 				if (boost::iequals(child.first, "NetworkServer")) {
 					portClient     = child.second.get("Client.<xmlattr>.Port",     4020);
@@ -124,10 +188,27 @@ public:
 					ntpEnable  = child.second.get("<xmlattr>.Enable",        true);
 					ntpHost    = child.second.get("<xmlattr>.IPv4",          "172.28.1.3");
 					ntpMaxDiff = child.second.get("MaxDiff.<xmlattr>.Value", 100);
+					ntpDiscipline = child.second.get("Discipline.<xmlattr>.Enable", false);
+					ntpPanic      = child.second.get("Discipline.<xmlattr>.Panic",  1000);
 				}
 				else if (boost::iequals(child.first, "Weather")) {
 					pathWeather = child.second.get("<xmlattr>.Path", "");
 				}
+				else if (boost::iequals(child.first, "LeapSecond")) {
+					pathLeapSecond = child.second.get("<xmlattr>.Path", "");
+				}
+				else if (boost::iequals(child.first, "LogLevel")) {
+					for (int i = 0; i < LOGC_MAX; ++i)
+						logLevel[i] = child.second.get(string("<xmlattr>.") + GLog::CategoryName(i), "normal");
+				}
+				else if (boost::iequals(child.first, "Metrics")) {
+					metricsEnable  = child.second.get("<xmlattr>.Enable",  true);
+					metricsAddress = child.second.get("<xmlattr>.Address", "127.0.0.1");
+					metricsPort    = child.second.get("<xmlattr>.Port",    4022);
+				}
+				else if (boost::iequals(child.first, "Almanac")) {
+					pathAlmanac = child.second.get("<xmlattr>.Path", "");
+				}
 				else if (boost::iequals(child.first, "ObservationSite")) {
 					sitename   = child.second.get("<xmlattr>.Name",             "");
 					siteLon    = child.second.get("Longitude.<xmlattr>.Value", 0.0);
@@ -148,6 +229,21 @@ public:
 					cloWindSpd  = child.second.get("WindSpeed.<xmlattr>.Threshold",      15.0);
 					cloContNum  = child.second.get("WindSpeed.<xmlattr>.ContinualNumber",   3);
 				}
+				else if (boost::iequals(child.first, "SlitCommand")) {
+					cmdAckTimeout  = child.second.get("<xmlattr>.AckTimeout",   10);
+					cmdRetry       = child.second.get("<xmlattr>.Retry",         3);
+					cmdMoveTimeout = child.second.get("<xmlattr>.MoveTimeout", 300);
+					// 时限为0时定时器立即到期, 重发次数过大时退避时长溢出
+					if (cmdAckTimeout < 1)  cmdAckTimeout  = 1;
+					if (cmdMoveTimeout < 1) cmdMoveTimeout = 1;
+					if (cmdRetry < 0)       cmdRetry = 0;
+					else if (cmdRetry > 16) cmdRetry = 16;
+				}
+				else if (boost::iequals(child.first, "Liveness")) {
+					liveDomeHeartbeat = child.second.get("<xmlattr>.DomeHeartbeat", 0);
+					liveDomeTimeout   = child.second.get("<xmlattr>.DomeTimeout",   0);
+					liveClientIdle    = child.second.get("<xmlattr>.ClientIdle",    0);
+				}
 			}
 			return true;
 		}
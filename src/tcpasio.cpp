@@ -7,6 +7,27 @@
 
 using std::string;
 using namespace boost::asio;
+
+/* 运行指标: 所有连接的合计值 */
+static MetricCounter* metric_received() {
+	static MetricCounter* counter = _gMetrics.Counter("annaes_tcp_received_bytes_total", "Bytes received on all TCP connections");
+	return counter;
+}
+
+static MetricCounter* metric_sent() {
+	static MetricCounter* counter = _gMetrics.Counter("annaes_tcp_sent_bytes_total", "Bytes sent on all TCP connections");
+	return counter;
+}
+
+static MetricCounter* metric_dropped() {
+	static MetricCounter* counter = _gMetrics.Counter("annaes_tcp_dropped_bytes_total", "Bytes discarded because send buffer was full");
+	return counter;
+}
+
+static MetricCounter* metric_accepted() {
+	static MetricCounter* counter = _gMetrics.Counter("annaes_tcp_accepted_total", "TCP connections accepted");
+	return counter;
+}
 //////////////////////////////////////////////////////////////////////////////
 /*---------------- TCPClient: 客户端 ----------------*/
 TcpCPtr maketcp_client() {// 工厂函数, 创建TcpCPtr
@@ -19,6 +40,14 @@ TCPClient::TCPClient()
 	bufrcv_.reset(new char[TCP_PACK_SIZE]);
 	usebuf_ = false;
 	pause_rcv_ = false;
+	nrcvd_  = 0;
+	nsent_  = 0;
+	nqueued_ = 0;
+	writing_ = false;
+	atline_  = true;
+	nurgqueued_ = 0;
+	nurgsent_   = 0;
+	tmidle_.tag = (long) this;
 }
 
 TCPClient::~TCPClient() {
@@ -107,6 +136,12 @@ void TCPClient::RegisterWrite(const CBSlot& slot) {
 	cbsnd_.connect(slot);
 }
 
+void TCPClient::RegisterWritten(const CBSlot& slot) {
+	mutex_lock lck(mtxsnd_);
+	if (!cbmark_.empty()) cbmark_.disconnect_all_slots();
+	cbmark_.connect(slot);
+}
+
 int TCPClient::Lookup(char* first) {
 	int n = usebuf_ ? crcrcv_.size() : bytercv_;
 	if (!(first && n)) return -1;
@@ -165,20 +200,104 @@ int TCPClient::Read(char* buff, const int len, const int from) {
 int TCPClient::Write(const char* buff, const int len) {
 	if (!buff || len <= 0) return 0;
 
+	mutex_lock lck(mtxsnd_);
+	return write_buffer(buff, len);
+}
+
+int TCPClient::Write(const char* buff, const int len, const long tag) {
+	if (!buff || len <= 0) return 0;
+
+	mutex_lock lck(mtxsnd_);
+	int n = write_buffer(buff, len);
+	if (n == len) {
+		write_mark mark;
+		mark.end = nqueued_;
+		mark.tag = tag;
+		marks_.push_back(mark);
+		check_marks();
+	}
+	return n;
+}
+
+int TCPClient::write_buffer(const char* buff, const int len) {
+	int n;
+	if (usebuf_) {
+		// 缓冲区不足时整体丢弃, 避免缓冲区中残留不完整的行而阻塞紧急通道
+		n = int(crcsnd_.capacity() - crcsnd_.size()) < len ? 0 : len;
+		for (int i = 0; i < n; ++i) crcsnd_.push_back(buff[i]);
+		nqueued_ += n;
+		if (n) start_write();
+	}
+	else {
+		n = sock_.write_some(buffer(buff, len));
+		nqueued_ += n;
+		nsent_ += n;
+		metric_sent()->Add(n);
+	}
+	if (n < len) metric_dropped()->Add(len - n);
+	return n;
+}
+
+int TCPClient::WriteUrgent(const char* buff, const int len, const long tag) {
+	if (!buff || len <= 0) return 0;
+
 	mutex_lock lck(mtxsnd_);
 	int n;
 	if (usebuf_) {
-		int n0(crcsnd_.size()), i;
-		if ((n = crcsnd_.capacity() - n0) > len) n = len;
-		for (i = 0; i < n; ++i) crcsnd_.push_back(buff[i]);
-		if (!n0 && n) start_write();
+		if (urgent_.size() + urgflight_.size() + len > TCP_URGENT_SIZE) {
+			metric_dropped()->Add(len);
+			return 0;
+		}
+		urgent_.append(buff, len);
+		n = len;
 	}
 	else {
 		n = sock_.write_some(buffer(buff, len));
+		nurgsent_ += n;
+		metric_sent()->Add(n);
+		if (n < len) metric_dropped()->Add(len - n);
 	}
+	nurgqueued_ += n;
+	if (n == len) {
+		write_mark mark;
+		mark.end = nurgqueued_;
+		mark.tag = tag;
+		urgmarks_.push_back(mark);
+	}
+	if (usebuf_) start_write();
+	else check_marks();
 	return n;
 }
 
+void TCPClient::check_marks() {
+	uint64_t sent = nsent_.load(boost::memory_order_relaxed);
+	while (!marks_.empty() && marks_.front().end <= sent) {
+		long tag = marks_.front().tag;
+		marks_.pop_front();
+		if (!cbmark_.empty()) cbmark_((long) this, tag);
+	}
+	sent = nurgsent_.load(boost::memory_order_relaxed);
+	while (!urgmarks_.empty() && urgmarks_.front().end <= sent) {
+		long tag = urgmarks_.front().tag;
+		urgmarks_.pop_front();
+		if (!cbmark_.empty()) cbmark_((long) this, tag);
+	}
+}
+
+void TCPClient::GetBytes(uint64_t& rcvd, uint64_t& sent) {
+	rcvd = nrcvd_.load(boost::memory_order_relaxed);
+	sent = nsent_.load(boost::memory_order_relaxed) + nurgsent_.load(boost::memory_order_relaxed);
+}
+
+int TCPClient::Pending() {
+	mutex_lock lck(mtxsnd_);
+	return usebuf_ ? int(crcsnd_.size()) : 0;
+}
+
+TimerNode* TCPClient::IdleTimer() {
+	return &tmidle_;
+}
+
 void TCPClient::handle_connect(const boost::system::error_code& ec) {
 	if (!cbconn_.empty()) cbconn_((const long) this, ec.value());
 	if (!ec) {
@@ -189,6 +308,8 @@ void TCPClient::handle_connect(const boost::system::error_code& ec) {
 
 void TCPClient::handle_read(const boost::system::error_code& ec, int n) {
 	if (!ec){
+		nrcvd_ += n;
+		metric_received()->Add(n);
 		mutex_lock lock(mtxrcv_);
 		if (usebuf_) {
 			for(int i = 0; i < n; ++i) crcrcv_.push_back(bufrcv_[i]);
@@ -203,7 +324,12 @@ void TCPClient::handle_read(const boost::system::error_code& ec, int n) {
 void TCPClient::handle_write(const boost::system::error_code& ec, int n) {
 	if (!ec) {
 		mutex_lock lock(mtxsnd_);
+		writing_ = false;
+		if (n) atline_ = crcsnd_[n - 1] == '\n';
 		crcsnd_.erase_begin(n);
+		nsent_ += n;
+		metric_sent()->Add(n);
+		check_marks();
 		if (!cbsnd_.empty()) cbsnd_((const long) this, n);
 		start_write();
 	}
@@ -217,10 +343,41 @@ void TCPClient::start_read() {
 	}
 }
 
+void TCPClient::handle_write_urgent(const boost::system::error_code& ec, int n) {
+	if (!ec) {
+		mutex_lock lock(mtxsnd_);
+		writing_ = false;
+		urgflight_.erase(0, n);
+		if (!urgflight_.empty()) {// 未发送部分放回通道前端
+			urgent_.insert(0, urgflight_);
+			urgflight_.clear();
+		}
+		nurgsent_ += n;
+		metric_sent()->Add(n);
+		check_marks();
+		start_write();
+	}
+}
+
 void TCPClient::start_write() {
+	if (writing_) return;
+
 	int n(crcsnd_.size());
-	if (n) {
-		sock_.async_write_some(buffer(crcsnd_.linearize(), n),
+	if (!urgent_.empty() && (atline_ || !n)) {// 紧急数据. 正常数据未以换行符结束时, 发送完毕后不再等待行尾
+		writing_ = true;
+		urgflight_.swap(urgent_);
+		sock_.async_write_some(buffer(urgflight_.data(), urgflight_.size()),
+				boost::bind(&TCPClient::handle_write_urgent, this,
+						placeholders::error, placeholders::bytes_transferred));
+	}
+	else if (n) {
+		char *data = crcsnd_.linearize();
+		if (!urgent_.empty()) {// 有紧急数据等待时仅发送至行尾
+			char *eol = (char*) memchr(data, '\n', n);
+			if (eol) n = int(eol - data) + 1;
+		}
+		writing_ = true;
+		sock_.async_write_some(buffer(data, n),
 				boost::bind(&TCPClient::handle_write, this,
 						placeholders::error, placeholders::bytes_transferred));
 	}
@@ -267,6 +424,10 @@ int TCPServer::CreateServer(const uint16_t port) {
 	return rslt;
 }
 
+void TCPServer::Stop() {
+	keep_.stop();
+}
+
 void TCPServer::start_accept() {
 	if (acceptor_.is_open()) {
 		TcpCPtr client = maketcp_client();
@@ -277,6 +438,7 @@ void TCPServer::start_accept() {
 
 void TCPServer::handle_accept(const TcpCPtr& client, const boost::system::error_code& ec) {
 	if (!ec) {
+		metric_accepted()->Add();
 		if (!cbaccept_.empty()) cbaccept_(client, (const long) this);
 		client->start();
 	}
@@ -18,13 +18,17 @@
 #include <boost/signals2.hpp>
 #include <boost/circular_buffer.hpp>
 #include <string>
+#include <deque>
 #include "IOServiceKeep.h"
+#include "Metrics.h"
+#include "TimerWheel.h"
 
 using boost::asio::ip::tcp;
 
 //////////////////////////////////////////////////////////////////////////////
 /*---------------- TCPClient: 客户端 ----------------*/
 #define TCP_PACK_SIZE	1500		//< TCP包容量, 量纲: 字节
+#define TCP_URGENT_SIZE	TCP_PACK_SIZE	//< 紧急发送通道容量, 量纲: 字节
 
 class TCPClient {
 public:
@@ -41,6 +45,12 @@ public:
 	typedef boost::circular_buffer<char> crcbuff;	//< 循环缓冲区
 	typedef boost::shared_array<char> charray;	//< 字符型数组
 
+	struct write_mark {// 发送完成标记
+		uint64_t end;	//< 被标记数据在发送字节流中的结束位置
+		long tag;		//< 调用者定义的标记
+	};
+	typedef std::deque<write_mark> markque;	//< 发送完成标记队列
+
 	friend class TCPServer;
 
 protected:
@@ -60,6 +70,20 @@ protected:
 	CallbackFunc  cbconn_;	//< connect回调函数
 	CallbackFunc  cbrcv_;	//< receive回调函数
 	CallbackFunc  cbsnd_;	//< send回调函数
+	CallbackFunc  cbmark_;	//< 被标记数据发送完成回调函数
+	boost::atomic<uint64_t> nrcvd_;	//< 累计接收字节数
+	boost::atomic<uint64_t> nsent_;	//< 累计发送字节数
+	uint64_t nqueued_;	//< 累计写入发送缓冲区的字节数
+	markque  marks_;	//< 发送完成标记
+	/* 紧急发送通道: 在正常数据的行边界处优先发送 */
+	bool writing_;		//< 正在异步发送
+	bool atline_;		//< 已发送的正常数据止于行尾
+	std::string urgent_;	//< 等待发送的紧急数据
+	std::string urgflight_;	//< 正在发送的紧急数据
+	uint64_t nurgqueued_;	//< 累计写入紧急通道的字节数
+	boost::atomic<uint64_t> nurgsent_;	//< 累计发送的紧急数据字节数
+	markque  urgmarks_;	//< 紧急数据发送完成标记
+	TimerNode tmidle_;	//< 空闲定时器节点, 标记为对象地址
 
 public:
 	// 接口
@@ -117,6 +141,11 @@ public:
 	 * @param slot 函数插槽
 	 */
 	void RegisterWrite(const CBSlot& slot);
+	/*!
+	 * @brief 注册被标记数据发送完成的回调函数
+	 * @param slot 函数插槽. 参数为TCPClient地址和标记
+	 */
+	void RegisterWritten(const CBSlot& slot);
 	/*!
 	 * @brief 查找已接收信息中第一个字符
 	 * @param flag 标识符
@@ -148,8 +177,49 @@ public:
 	 * @param len  待发送数据长度
 	 * @return
 	 * 实际发送数据长度
+	 * @note
+	 * 启用循环缓冲区时, 缓冲区剩余空间不足则整体丢弃并返回0
 	 */
 	int Write(const char* buff, const int len);
+	/*!
+	 * @brief 发送指定数据, 并在数据全部交给操作系统后以tag回调
+	 * @param buff 待发送数据存储区指针
+	 * @param len  待发送数据长度
+	 * @param tag  调用者定义的标记
+	 * @return
+	 * 实际发送数据长度. 小于len时不回调
+	 */
+	int Write(const char* buff, const int len, const long tag);
+	/*!
+	 * @brief 经紧急通道发送完整的一行或多行数据, 并在数据全部交给操作系统后以tag回调
+	 * @param buff 待发送数据存储区指针, 须以换行符结束
+	 * @param len  待发送数据长度
+	 * @param tag  调用者定义的标记
+	 * @return
+	 * 实际发送数据长度. 通道已满时返回0
+	 * @note
+	 * 紧急数据不排在发送缓冲区的积压之后: 正在发送的正常数据到达行尾后即发送紧急数据,
+	 * 因此不会截断正常数据中的信息
+	 */
+	int WriteUrgent(const char* buff, const int len, const long tag);
+	/*!
+	 * @brief 查看累计收发字节数
+	 * @param rcvd 接收字节数
+	 * @param sent 发送字节数
+	 */
+	void GetBytes(uint64_t& rcvd, uint64_t& sent);
+	/*!
+	 * @brief 查看发送缓冲区中尚未交给操作系统的数据长度
+	 * @return
+	 * 待发送字节数. 不使用缓冲区时为0
+	 */
+	int Pending();
+	/*!
+	 * @brief 查看空闲定时器节点
+	 * @note
+	 * 由调用者在时间轮中启动. 对象析构时自动取消
+	 */
+	TimerNode* IdleTimer();
 
 protected:
 	// 功能
@@ -171,14 +241,32 @@ protected:
 	 * @param n  发送数据长度, 量纲: 字节
 	 */
 	void handle_write(const boost::system::error_code& ec, int n);
+	/*!
+	 * @brief 处理紧急数据发送结果
+	 */
+	void handle_write_urgent(const boost::system::error_code& ec, int n);
 	/*!
 	 * @brief 尝试接收网络信息
 	 */
 	void start_read();
 	/*!
-	 * @brief 尝试发送缓冲区数据
+	 * @brief 尝试发送紧急数据或缓冲区数据
+	 * @note
+	 * 调用者持有mtxsnd_
 	 */
 	void start_write();
+	/*!
+	 * @brief 将数据写入发送缓冲区或直接发送
+	 * @note
+	 * 调用者持有mtxsnd_
+	 */
+	int write_buffer(const char* buff, const int len);
+	/*!
+	 * @brief 检查已发送数据, 回调已完成的标记
+	 * @note
+	 * 调用者持有mtxsnd_
+	 */
+	void check_marks();
 	/*!
 	 * @brief 服务器端建立网络连接后调用, 启动接收流程
 	 */
@@ -228,6 +316,12 @@ public:
 	 * 其它 -- 错误代码
 	 */
 	int CreateServer(const uint16_t port);
+	/*!
+	 * @brief 停止网络服务
+	 * @note
+	 * 停止后不再回调
+	 */
+	void Stop();
 
 protected:
 	// 功能